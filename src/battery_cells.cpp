@@ -0,0 +1,124 @@
+#include "battery_cells.h"
+#include <math.h>
+#include <string.h>
+
+BatteryCellStore::BatteryCellStore() {
+    clear();
+}
+
+void BatteryCellStore::clear() {
+    memset(cell_mv, 0, sizeof(cell_mv));
+    memset(module_temp_c, 0, sizeof(module_temp_c));
+    valid_parts = 0;
+    updated_parts = 0;
+    last_update_ms = 0;
+}
+
+bool BatteryCellStore::decodeResponse(const uint8_t* data, uint16_t len, uint32_t now_ms) {
+    if (len < 2 || data[0] != 0x61) return false;
+
+    uint8_t part;
+    bool ok;
+    switch (data[1]) {
+        case BATTERY_LID_CELLS_1:
+            part = BATTERY_PART_CELLS_1;
+            ok = decodeCells(data, len, 0, BATTERY_CELLS_PART1);
+            break;
+        case BATTERY_LID_CELLS_2:
+            part = BATTERY_PART_CELLS_2;
+            ok = decodeCells(data, len, BATTERY_CELLS_PART1,
+                             BATTERY_CELL_COUNT - BATTERY_CELLS_PART1);
+            break;
+        case BATTERY_LID_TEMPS:
+            part = BATTERY_PART_TEMPS;
+            ok = decodeTemps(data, len);
+            break;
+        default:
+            return false;
+    }
+    if (!ok) return false;
+
+    valid_parts |= part;
+    updated_parts |= part;
+    last_update_ms = now_ms;
+    return true;
+}
+
+bool BatteryCellStore::decodeCells(const uint8_t* data, uint16_t len,
+                                   uint8_t first_cell, uint8_t count) {
+    // Big-endian mV per cell after the two header bytes
+    if (len < 2 + (uint16_t)count * 2) return false;
+    const uint8_t* p = data + 2;
+    for (uint8_t i = 0; i < count; i++, p += 2) {
+        cell_mv[first_cell + i] = (uint16_t)((p[0] << 8) | p[1]);
+    }
+    return true;
+}
+
+bool BatteryCellStore::decodeTemps(const uint8_t* data, uint16_t len) {
+    // One byte every three, starting at byte 4
+    if (len < 4 + (BATTERY_MODULE_COUNT - 1) * 3 + 1) return false;
+    for (uint8_t i = 0; i < BATTERY_MODULE_COUNT; i++) {
+        module_temp_c[i] = (int8_t)((int16_t)data[4 + i * 3] - BATTERY_TEMP_OFFSET);
+    }
+    return true;
+}
+
+void BatteryCellStore::computeVoltageStats(CellVoltageStats_t& stats) const {
+    // Four independent lanes, merged at the end
+    uint16_t lo[4], hi[4];
+    uint8_t lo_i[4], hi_i[4];
+    uint32_t sum[4] = {0, 0, 0, 0};
+    uint64_t sum_sq[4] = {0, 0, 0, 0};
+    for (uint8_t l = 0; l < 4; l++) {
+        lo[l] = hi[l] = cell_mv[l];
+        lo_i[l] = hi_i[l] = l;
+    }
+
+    for (uint8_t i = 0; i < BATTERY_CELL_COUNT; i += 4) {
+        for (uint8_t l = 0; l < 4; l++) {
+            uint16_t v = cell_mv[i + l];
+            if (v < lo[l]) { lo[l] = v; lo_i[l] = i + l; }
+            if (v > hi[l]) { hi[l] = v; hi_i[l] = i + l; }
+            sum[l] += v;
+            sum_sq[l] += (uint32_t)v * v;
+        }
+    }
+
+    uint8_t min_i = lo_i[0], max_i = hi_i[0];
+    uint32_t total = sum[0];
+    uint64_t total_sq = sum_sq[0];
+    for (uint8_t l = 1; l < 4; l++) {
+        if (lo[l] < cell_mv[min_i] || (lo[l] == cell_mv[min_i] && lo_i[l] < min_i)) min_i = lo_i[l];
+        if (hi[l] > cell_mv[max_i] || (hi[l] == cell_mv[max_i] && hi_i[l] < max_i)) max_i = hi_i[l];
+        total += sum[l];
+        total_sq += sum_sq[l];
+    }
+
+    // Variance from exact integer sums: (n * sum(x^2) - sum(x)^2) / n^2
+    uint64_t n = BATTERY_CELL_COUNT;
+    uint64_t spread = n * total_sq - (uint64_t)total * total;
+
+    stats.min_mv = cell_mv[min_i];
+    stats.max_mv = cell_mv[max_i];
+    stats.min_cell = min_i + 1;
+    stats.max_cell = max_i + 1;
+    stats.mean_mv = (float)total / BATTERY_CELL_COUNT;
+    stats.stddev_mv = sqrtf((float)spread) / BATTERY_CELL_COUNT;
+    stats.imbalance_mv = stats.max_mv - stats.min_mv;
+}
+
+void BatteryCellStore::computeTempStats(ModuleTempStats_t& stats) const {
+    int8_t lo = module_temp_c[0];
+    int8_t hi = module_temp_c[0];
+    int16_t sum = 0;
+    for (uint8_t i = 0; i < BATTERY_MODULE_COUNT; i++) {
+        int8_t t = module_temp_c[i];
+        if (t < lo) lo = t;
+        if (t > hi) hi = t;
+        sum += t;
+    }
+    stats.min_c = lo;
+    stats.max_c = hi;
+    stats.mean_c = (float)sum / BATTERY_MODULE_COUNT;
+}
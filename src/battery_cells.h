@@ -0,0 +1,82 @@
+#ifndef BATTERY_CELLS_H
+#define BATTERY_CELLS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// BATTERY CELL STORE
+// Per-cell voltages and per-module temperatures read from the LBC, kept as
+// fixed-point arrays (mV, °C) rather than one ManagedSignal_t per cell.
+// Statistics are computed over the whole array in one pass with integer
+// accumulators; the loop is unrolled by four so the compiler can keep the
+// running min/max/sum in registers.
+// ============================================================================
+
+#define BATTERY_CELL_COUNT 96
+#define BATTERY_MODULE_COUNT 12
+#define BATTERY_CELLS_PART1 62        // Cells in the 0x2141 response
+
+// LBC responses (positive response SID 0x61 + local identifier)
+#define BATTERY_LID_CELLS_1 0x41
+#define BATTERY_LID_CELLS_2 0x42
+#define BATTERY_LID_TEMPS 0x04
+#define BATTERY_TEMP_OFFSET 40        // Raw byte - 40 = °C
+
+// Parts of a complete set (see getUpdatedParts)
+#define BATTERY_PART_CELLS_1 0x01
+#define BATTERY_PART_CELLS_2 0x02
+#define BATTERY_PART_TEMPS 0x04
+#define BATTERY_PART_CELLS (BATTERY_PART_CELLS_1 | BATTERY_PART_CELLS_2)
+
+typedef struct {
+    uint16_t min_mv;
+    uint16_t max_mv;
+    uint8_t min_cell;        // 1-based cell numbers
+    uint8_t max_cell;
+    float mean_mv;
+    float stddev_mv;
+    uint16_t imbalance_mv;   // max - min
+} CellVoltageStats_t;
+
+typedef struct {
+    int8_t min_c;
+    int8_t max_c;
+    float mean_c;
+} ModuleTempStats_t;
+
+class BatteryCellStore {
+public:
+    BatteryCellStore();
+
+    void clear();
+
+    // Decode a positive LBC response (0x61 <lid> ...); false if not a cell response
+    bool decodeResponse(const uint8_t* data, uint16_t len, uint32_t now_ms);
+
+    // Parts decoded since the last markPublished()
+    uint8_t getUpdatedParts() const { return updated_parts; }
+    bool hasCompleteVoltages() const { return (valid_parts & BATTERY_PART_CELLS) == BATTERY_PART_CELLS; }
+    bool hasTemperatures() const { return (valid_parts & BATTERY_PART_TEMPS) != 0; }
+    void markPublished() { updated_parts = 0; }
+
+    // Batch statistics (valid once hasCompleteVoltages / hasTemperatures)
+    void computeVoltageStats(CellVoltageStats_t& stats) const;
+    void computeTempStats(ModuleTempStats_t& stats) const;
+
+    const uint16_t* getCellVoltages() const { return cell_mv; }
+    const int8_t* getModuleTemps() const { return module_temp_c; }
+    uint32_t getLastUpdate() const { return last_update_ms; }
+
+private:
+    uint16_t cell_mv[BATTERY_CELL_COUNT];
+    int8_t module_temp_c[BATTERY_MODULE_COUNT];
+    uint8_t valid_parts;
+    uint8_t updated_parts;
+    uint32_t last_update_ms;
+
+    bool decodeCells(const uint8_t* data, uint16_t len, uint8_t first_cell, uint8_t count);
+    bool decodeTemps(const uint8_t* data, uint16_t len);
+};
+
+#endif // BATTERY_CELLS_H
@@ -0,0 +1,104 @@
+#include "can_bus_monitor.h"
+#include <cmath>
+
+static_assert((CAN_MONITOR_MAX_IDS & (CAN_MONITOR_MAX_IDS - 1)) == 0,
+              "CAN_MONITOR_MAX_IDS must be a power of two");
+
+CANBusMonitor::CANBusMonitor()
+    : bitrate(CAN_SPEED_HIGH),
+      window_start_us(0),
+      window_bits(0),
+      window_frames(0),
+      recent_start_us(0),
+      recent_bits(0),
+      recent_load_percent(0),
+      total_frames(0),
+      untracked_frames(0),
+      bus_load_percent(0),
+      frame_rate(0) {
+    memset(ids, 0, sizeof(ids));
+}
+
+void CANBusMonitor::begin(uint32_t bus_bitrate) {
+    bitrate = bus_bitrate;
+    window_start_us = monotonicMicros();
+    window_bits = 0;
+    window_frames = 0;
+    recent_start_us = window_start_us;
+    recent_bits = 0;
+    recent_load_percent = 0;
+}
+
+void CANBusMonitor::onFrame(const CANMessage_t& msg) {
+    // Nominal frame length plus an average bit-stuffing allowance (~10 %)
+    uint32_t bits = ((msg.id > 0x7FF) ? 67 : 47) + 8U * msg.dlc;
+    bits += bits / 10;
+    window_bits += bits;
+    recent_bits += bits;
+    window_frames++;
+    total_frames++;
+    
+    CANIdStats_t* stats = findOrInsert(msg.id);
+    if (stats == nullptr) {
+        untracked_frames++;
+        return;
+    }
+    
+    if (stats->total_frames > 0 && msg.timestamp_us > stats->last_us) {
+        float interval = (float)(msg.timestamp_us - stats->last_us);
+        if (stats->mean_interval_us == 0) {
+            stats->mean_interval_us = interval;
+        }
+        // EWMA with alpha = 1/16
+        stats->mean_interval_us += (interval - stats->mean_interval_us) / 16.0f;
+        stats->jitter_us += (fabsf(interval - stats->mean_interval_us) - stats->jitter_us) / 16.0f;
+    }
+    stats->last_us = msg.timestamp_us;
+    stats->window_frames++;
+    stats->total_frames++;
+}
+
+void CANBusMonitor::endWindow(uint64_t now_us) {
+    float window_s = (float)(now_us - window_start_us) / 1000000.0f;
+    if (window_s <= 0) return;
+    
+    frame_rate = window_frames / window_s;
+    bus_load_percent = (bitrate > 0) ? (100.0f * window_bits / (bitrate * window_s)) : 0;
+    
+    for (size_t i = 0; i < CAN_MONITOR_MAX_IDS; i++) {
+        if (!ids[i].used) continue;
+        ids[i].rate_hz = ids[i].window_frames / window_s;
+        ids[i].window_frames = 0;
+    }
+    
+    window_start_us = now_us;
+    window_bits = 0;
+    window_frames = 0;
+}
+
+float CANBusMonitor::getRecentLoadPercent(uint64_t now_us) {
+    if (now_us - recent_start_us >= CAN_MONITOR_LOAD_WINDOW_US && bitrate > 0) {
+        float window_s = (float)(now_us - recent_start_us) / 1000000.0f;
+        recent_load_percent = 100.0f * recent_bits / (bitrate * window_s);
+        recent_start_us = now_us;
+        recent_bits = 0;
+    }
+    return recent_load_percent;
+}
+
+CANIdStats_t* CANBusMonitor::findOrInsert(uint32_t id) {
+    // Linear probing; the table never shrinks, so a miss on a full table is final
+    size_t slot = (id * 2654435761UL) & (CAN_MONITOR_MAX_IDS - 1);
+    for (size_t probe = 0; probe < CAN_MONITOR_MAX_IDS; probe++) {
+        CANIdStats_t& entry = ids[(slot + probe) & (CAN_MONITOR_MAX_IDS - 1)];
+        if (entry.used) {
+            if (entry.id == id) return &entry;
+            continue;
+        }
+        memset(&entry, 0, sizeof(entry));
+        entry.id = id;
+        entry.used = true;
+        return &entry;
+    }
+    return nullptr;
+}
@@ -0,0 +1,65 @@
+#ifndef CAN_BUS_MONITOR_H
+#define CAN_BUS_MONITOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "can_messages.h"
+
+// Per-ID reception statistics
+typedef struct {
+    uint32_t id;
+    bool used;
+    uint32_t window_frames;     // Frames in the current window
+    uint32_t total_frames;
+    uint64_t last_us;           // Timestamp of the previous frame
+    float mean_interval_us;     // EWMA of the inter-arrival time
+    float jitter_us;            // EWMA of |interval - mean|
+    float rate_hz;              // Frame rate over the last completed window
+} CANIdStats_t;
+
+// Frame rate, inter-arrival jitter and estimated bus load for one bus.
+// Fed from the consumer side (readCAN1Batch/readCAN2), so frames rejected
+// by the acceptance filter are not seen: the load is a lower bound.
+class CANBusMonitor {
+public:
+    CANBusMonitor();
+    
+    void begin(uint32_t bitrate);
+    void onFrame(const CANMessage_t& msg);
+    
+    // Close the current window: computes rates and load from its counters
+    void endWindow(uint64_t now_us);
+    
+    // Load over the last completed CAN_MONITOR_LOAD_WINDOW_US, separate from
+    // the report window so pollers see a burst within a second. Closes the
+    // short window once it has run out; call it regularly.
+    float getRecentLoadPercent(uint64_t now_us);
+    
+    // Results of the last completed window
+    float getBusLoadPercent() const { return bus_load_percent; }
+    float getFrameRate() const { return frame_rate; }
+    uint32_t getTotalFrames() const { return total_frames; }
+    uint32_t getUntrackedFrames() const { return untracked_frames; }
+    
+    // Tracked IDs (entries with used == false are empty slots)
+    const CANIdStats_t* getIdStats() const { return ids; }
+    static size_t getIdCapacity() { return CAN_MONITOR_MAX_IDS; }
+    
+private:
+    CANIdStats_t* findOrInsert(uint32_t id);
+    
+    CANIdStats_t ids[CAN_MONITOR_MAX_IDS];  // Open addressing on the CAN ID
+    uint32_t bitrate;
+    uint64_t window_start_us;
+    uint64_t window_bits;
+    uint32_t window_frames;
+    uint64_t recent_start_us;    // Short load window
+    uint64_t recent_bits;
+    float recent_load_percent;
+    uint32_t total_frames;
+    uint32_t untracked_frames;   // Frames of IDs that did not fit the table
+    float bus_load_percent;
+    float frame_rate;
+};
+
+#endif // CAN_BUS_MONITOR_H
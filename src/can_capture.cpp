@@ -0,0 +1,369 @@
+#include "can_capture.h"
+#include <LittleFS.h>
+
+static_assert(CAPTURE_BLOCK_MAX_IDS < CAPTURE_KEY_LITERAL,
+              "Dictionary indices must not collide with the literal key");
+
+// Largest record: 5 byte varint + key + literal ID + DLC + 8 data bytes
+static const uint16_t CAPTURE_MAX_RECORD = 5 + 1 + 4 + 1 + 8;
+
+static inline void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void putU32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void putU64(uint8_t* p, uint64_t v) {
+    for (uint8_t i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t getU32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+static inline uint64_t getU64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+CaptureBlockReader::CaptureBlockReader()
+    : block(nullptr), pos(0), used(0), remaining(0), sequence(0), ts_us(0),
+      dictionary_count(0) {}
+
+bool CaptureBlockReader::begin(const uint8_t* data) {
+    block = data;
+    remaining = 0;
+    if (getU16(block) != CAPTURE_MAGIC || block[2] != CAPTURE_VERSION) return false;
+    
+    used = getU16(block + 6);
+    if (used < CAPTURE_HEADER_SIZE || used > CAPTURE_BLOCK_SIZE) return false;
+    
+    remaining = getU16(block + 4);
+    sequence = getU32(block + 8);
+    ts_us = getU64(block + 12);
+    pos = CAPTURE_HEADER_SIZE;
+    dictionary_count = 0;
+    return true;
+}
+
+bool CaptureBlockReader::next(CANMessage_t& msg, uint8_t& bus) {
+    if (remaining == 0 || pos >= used) return false;
+    
+    uint32_t delta = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do {
+        byte = block[pos++];
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && pos < used && shift < 35);
+    ts_us += delta;
+    
+    // Key, optional literal ID and DLC must lie inside the used area
+    uint32_t key_id;
+    uint8_t key = (pos < used) ? block[pos++] : 0;
+    if (key == CAPTURE_KEY_LITERAL && pos + 4 < used) {
+        key_id = getU32(block + pos);
+        pos += 4;
+        if (dictionary_count < CAPTURE_BLOCK_MAX_IDS) {
+            dictionary[dictionary_count++] = key_id;
+        }
+    } else if (key < dictionary_count && pos < used) {
+        key_id = dictionary[key];
+    } else {
+        remaining = 0;  // Corrupt block, stop here
+        return false;
+    }
+    
+    uint8_t dlc = block[pos++];
+    if (dlc > 8 || pos + dlc > used) {
+        remaining = 0;
+        return false;
+    }
+    
+    msg.id = key_id & ~(CAPTURE_ID_EXTENDED | CAPTURE_ID_BUS2);
+    msg.dlc = dlc;
+    memcpy(msg.data, block + pos, dlc);
+    msg.timestamp_us = ts_us;
+    bus = (key_id & CAPTURE_ID_BUS2) ? 2 : 1;
+    pos += dlc;
+    remaining--;
+    return true;
+}
+
+CANCapture::CANCapture()
+    : current(-1), write_pos(0), record_count(0), last_ts_us(0), block_seq(0),
+      dictionary_count(0), segment_fill(0), segment_bytes(0), max_segments(0),
+      oldest_segment(0), next_segment(0), writer_handle(nullptr),
+      writer_running(false), active(false), frames_captured(0), frames_dropped(0),
+      blocks_written(0), bytes_written(0), write_errors(0) {}
+
+CANCapture::~CANCapture() {
+    end();
+}
+
+bool CANCapture::begin(uint32_t budget_bytes, uint32_t segment_size) {
+    if (active) return true;
+
+    if (segment_size < CAPTURE_BLOCK_SIZE) segment_size = CAPTURE_BLOCK_SIZE;
+    segment_bytes = segment_size - (segment_size % CAPTURE_BLOCK_SIZE);
+    max_segments = budget_bytes / segment_bytes;
+    if (max_segments < 2) max_segments = 2;
+
+    if (!LittleFS.exists(CAPTURE_DIR) && !LittleFS.mkdir(CAPTURE_DIR)) {
+        DEBUG_PRINTLN("[Capture] Failed to create " CAPTURE_DIR);
+        return false;
+    }
+    // Continue numbering after the newest segment left by an earlier run
+    findSegments(CAPTURE_DIR, oldest_segment, next_segment);
+
+    // All blocks start out free
+    full_blocks.reset();
+    free_blocks.reset();
+    for (uint8_t i = 0; i < CAPTURE_BUFFER_BLOCKS; i++) {
+        free_blocks.push(i);
+    }
+    current = -1;
+
+    writer_running = true;
+    if (xTaskCreate(writerTask, "can_capture", CAPTURE_TASK_STACK, this,
+                    CAPTURE_TASK_PRIORITY, &writer_handle) != pdPASS) {
+        writer_running = false;
+        writer_handle = nullptr;
+        DEBUG_PRINTLN("[Capture] Writer task start failed");
+        return false;
+    }
+
+    active = true;
+    DEBUG_PRINTF("[Capture] Started: %lu segments x %lu bytes, next segment %lu\n",
+                max_segments, segment_bytes, next_segment);
+    return true;
+}
+
+void CANCapture::end() {
+    if (!active) return;
+
+    active = false;
+    flush();
+
+    // The writer drains the remaining blocks, closes the segment and exits
+    writer_running = false;
+    while (writer_handle != nullptr) {
+        xTaskNotifyGive(writer_handle);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    DEBUG_PRINTF("[Capture] Stopped: %lu frames, %lu dropped, %lu blocks\n",
+                frames_captured, frames_dropped, blocks_written);
+}
+
+void CANCapture::record(const CANMessage_t& msg, uint8_t bus) {
+    if (!active) return;
+
+    if (current >= 0) {
+        // Start a new block when the record might not fit or the gap
+        // does not fit a 32-bit delta (an out-of-order frame is stored
+        // with delta 0 below)
+        if (write_pos + CAPTURE_MAX_RECORD > CAPTURE_BLOCK_SIZE ||
+            (msg.timestamp_us > last_ts_us && msg.timestamp_us - last_ts_us > 0xFFFFFFFFULL)) {
+            closeBlock();
+        }
+    }
+    if (current < 0) {
+        last_ts_us = msg.timestamp_us;
+        if (!openBlock()) {
+            frames_dropped++;  // Writer is behind, all blocks are full
+            return;
+        }
+    }
+
+    uint8_t* p = blocks[current].bytes + write_pos;
+
+    // Timestamp delta as LEB128 varint (frames arrive in order)
+    uint32_t delta = (msg.timestamp_us > last_ts_us)
+                         ? (uint32_t)(msg.timestamp_us - last_ts_us) : 0;
+    last_ts_us += delta;
+    while (delta >= 0x80) {
+        *p++ = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    *p++ = (uint8_t)delta;
+
+    // ID through the block dictionary
+    uint32_t key_id = msg.id;
+    if (msg.id > CAN_STD_ID_MAX) key_id |= CAPTURE_ID_EXTENDED;
+    if (bus == 2) key_id |= CAPTURE_ID_BUS2;
+
+    int16_t key = lookupId(key_id);
+    if (key >= 0) {
+        *p++ = (uint8_t)key;
+    } else {
+        *p++ = CAPTURE_KEY_LITERAL;
+        putU32(p, key_id);
+        p += 4;
+        if (dictionary_count < CAPTURE_BLOCK_MAX_IDS) {
+            dictionary[dictionary_count++] = key_id;
+        }
+    }
+
+    uint8_t dlc = (msg.dlc <= 8) ? msg.dlc : 8;
+    *p++ = dlc;
+    memcpy(p, msg.data, dlc);
+    p += dlc;
+
+    write_pos = (uint16_t)(p - blocks[current].bytes);
+    record_count++;
+    frames_captured++;
+}
+
+void CANCapture::recordBatch(const CANMessage_t* msgs, size_t count, uint8_t bus) {
+    for (size_t i = 0; i < count; i++) {
+        record(msgs[i], bus);
+    }
+}
+
+void CANCapture::flush() {
+    if (current >= 0 && record_count > 0) {
+        closeBlock();
+    }
+}
+
+bool CANCapture::openBlock() {
+    uint8_t index;
+    if (!free_blocks.pop(index)) return false;
+
+    current = index;
+    write_pos = CAPTURE_HEADER_SIZE;
+    record_count = 0;
+    dictionary_count = 0;
+
+    uint8_t* header = blocks[current].bytes;
+    putU16(header, CAPTURE_MAGIC);
+    header[2] = CAPTURE_VERSION;
+    putU32(header + 8, block_seq++);
+    putU64(header + 12, last_ts_us);
+    return true;
+}
+
+void CANCapture::closeBlock() {
+    uint8_t* header = blocks[current].bytes;
+    header[3] = dictionary_count;
+    putU16(header + 4, record_count);
+    putU16(header + 6, write_pos);
+    memset(header + write_pos, 0, CAPTURE_BLOCK_SIZE - write_pos);
+
+    full_blocks.push((uint8_t)current);
+    current = -1;
+    if (writer_handle != nullptr) {
+        xTaskNotifyGive(writer_handle);
+    }
+}
+
+int16_t CANCapture::lookupId(uint32_t key_id) const {
+    // Linear scan: a block rarely holds more than a few dozen IDs
+    for (uint8_t i = 0; i < dictionary_count; i++) {
+        if (dictionary[i] == key_id) return i;
+    }
+    return -1;
+}
+
+void CANCapture::segmentPath(const char* dir, uint32_t index, char* path, size_t path_size) {
+    snprintf(path, path_size, "%s/%08lu.bin", dir, (unsigned long)index);
+}
+
+bool CANCapture::findSegments(const char* dir_path, uint32_t& oldest, uint32_t& next) {
+    bool found = false;
+    oldest = 0;
+    next = 0;
+
+    File dir = LittleFS.open(dir_path);
+    if (!dir) return false;
+
+    File file = dir.openNextFile();
+    while (file) {
+        const char* name = file.name();
+        const char* slash = strrchr(name, '/');
+        if (slash) name = slash + 1;
+
+        char* end = nullptr;
+        uint32_t index = strtoul(name, &end, 10);
+        if (end != name && strcmp(end, ".bin") == 0) {
+            if (!found || index < oldest) oldest = index;
+            if (!found || index >= next) next = index + 1;
+            found = true;
+        }
+        file = dir.openNextFile();
+    }
+    return found;
+}
+
+bool CANCapture::openSegment() {
+    char path[32];
+
+    // Stay inside the byte budget by dropping the oldest segments
+    while (next_segment - oldest_segment >= max_segments) {
+        segmentPath(CAPTURE_DIR, oldest_segment++, path, sizeof(path));
+        LittleFS.remove(path);
+    }
+
+    segmentPath(CAPTURE_DIR, next_segment, path, sizeof(path));
+    segment = LittleFS.open(path, "w");
+    if (!segment) {
+        DEBUG_PRINTF("[Capture] Failed to open %s\n", path);
+        return false;
+    }
+    next_segment++;
+    segment_fill = 0;
+    return true;
+}
+
+void CANCapture::writeBlock(const CaptureBlock_t& block) {
+    if (!segment && !openSegment()) {
+        write_errors++;
+        return;
+    }
+
+    if (segment.write(block.bytes, CAPTURE_BLOCK_SIZE) != CAPTURE_BLOCK_SIZE) {
+        write_errors++;
+    } else {
+        blocks_written++;
+        bytes_written += CAPTURE_BLOCK_SIZE;
+    }
+    segment_fill += CAPTURE_BLOCK_SIZE;
+
+    if (segment_fill >= segment_bytes) {
+        segment.close();
+    } else if ((segment_fill / CAPTURE_BLOCK_SIZE) % CAPTURE_SYNC_BLOCKS == 0) {
+        segment.flush();  // Bound the data lost on power failure
+    }
+}
+
+void CANCapture::writerTask(void* ctx) {
+    CANCapture* self = static_cast<CANCapture*>(ctx);
+    uint8_t index;
+
+    while (self->writer_running || !self->full_blocks.empty()) {
+        if (self->full_blocks.pop(index)) {
+            self->writeBlock(self->blocks[index]);
+            self->free_blocks.push(index);
+            continue;
+        }
+        // Sleep until the producer hands over a block
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CAPTURE_WRITER_WAIT_MS));
+    }
+
+    if (self->segment) {
+        self->segment.close();
+    }
+    self->writer_handle = nullptr;
+    vTaskDelete(nullptr);
+}
@@ -0,0 +1,136 @@
+#ifndef CAN_CAPTURE_H
+#define CAN_CAPTURE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+#include "can_messages.h"
+#include "spsc_ring.h"
+
+// ============================================================================
+// BINARY CAN CAPTURE
+// Raw frames are packed into fixed-size blocks and written to LittleFS by a
+// low-priority writer task, so the decode loop never waits for flash.
+//
+// Block layout (CAPTURE_BLOCK_SIZE bytes, little-endian):
+//   header  magic u16 | version u8 | id_count u8 | record_count u16 |
+//           used_bytes u16 | seq u32 | base_ts_us u64
+//   records varint delta_us | key u8 | [id u32 if key == 0xFF] | dlc u8 | data
+// delta_us is relative to the previous record (base_ts_us for the first).
+// key indexes the block's ID dictionary; 0xFF introduces a new ID literal,
+// which is appended to the dictionary. ID bit 31 marks a 29-bit ID, bit 30
+// a frame from CAN2. Every block decodes on its own.
+//
+// Blocks are appended to numbered segment files in CAPTURE_DIR; the oldest
+// segment is deleted once the total exceeds the configured byte budget.
+// tools/capture_convert.py turns a capture into candump or ASC logs.
+// ============================================================================
+
+#define CAPTURE_MAGIC 0x435A           // "ZC"
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 20
+#define CAPTURE_KEY_LITERAL 0xFF
+#define CAPTURE_ID_EXTENDED 0x80000000UL
+#define CAPTURE_ID_BUS2 0x40000000UL
+
+typedef struct {
+    uint8_t bytes[CAPTURE_BLOCK_SIZE];
+} CaptureBlock_t;
+
+// Sequential decoder for one capture block (used by the trace replayer)
+class CaptureBlockReader {
+public:
+    CaptureBlockReader();
+    
+    // Returns false when the block header is not a valid capture header
+    bool begin(const uint8_t* block);
+    
+    // Next record of the block; false once all records are consumed
+    bool next(CANMessage_t& msg, uint8_t& bus);
+    
+    uint32_t getSequence() const { return sequence; }
+    
+private:
+    const uint8_t* block;
+    uint16_t pos;
+    uint16_t used;
+    uint16_t remaining;
+    uint32_t sequence;
+    uint64_t ts_us;
+    uint32_t dictionary[CAPTURE_BLOCK_MAX_IDS];
+    uint8_t dictionary_count;
+};
+
+class CANCapture {
+public:
+    CANCapture();
+    ~CANCapture();
+
+    // Start/stop capturing (stop flushes the partial block)
+    bool begin(uint32_t budget_bytes, uint32_t segment_bytes);
+    void end();
+    bool isActive() const { return active; }
+
+    // Producer side, called from the decode loop
+    void record(const CANMessage_t& msg, uint8_t bus = 1);
+    void recordBatch(const CANMessage_t* msgs, size_t count, uint8_t bus = 1);
+
+    // Hand a partially filled block to the writer (e.g. before sleep)
+    void flush();
+
+    // Segment file naming, shared with the trace replayer
+    static void segmentPath(const char* dir, uint32_t index, char* path, size_t path_size);
+    static bool findSegments(const char* dir, uint32_t& oldest, uint32_t& next);
+
+    // Statistics
+    uint32_t getFramesCaptured() const { return frames_captured; }
+    uint32_t getFramesDropped() const { return frames_dropped; }
+    uint32_t getBlocksWritten() const { return blocks_written; }
+    uint32_t getBytesWritten() const { return bytes_written; }
+    uint32_t getWriteErrors() const { return write_errors; }
+
+private:
+    // Block pool; indices travel between the two rings
+    CaptureBlock_t blocks[CAPTURE_BUFFER_BLOCKS];
+    SpscRing<uint8_t, CAPTURE_BUFFER_BLOCKS> full_blocks;  // loop -> writer
+    SpscRing<uint8_t, CAPTURE_BUFFER_BLOCKS> free_blocks;  // writer -> loop
+
+    // Block being filled (producer side only)
+    int16_t current;               // Block index, -1 when none is available
+    uint16_t write_pos;
+    uint16_t record_count;
+    uint64_t last_ts_us;
+    uint32_t block_seq;
+    uint32_t dictionary[CAPTURE_BLOCK_MAX_IDS];
+    uint8_t dictionary_count;
+
+    // Segment files (writer side only)
+    File segment;
+    uint32_t segment_fill;         // Bytes written to the open segment
+    uint32_t segment_bytes;
+    uint32_t max_segments;
+    uint32_t oldest_segment;
+    uint32_t next_segment;
+
+    // Writer task
+    TaskHandle_t writer_handle;
+    volatile bool writer_running;
+    volatile bool active;
+
+    // Statistics
+    uint32_t frames_captured;
+    uint32_t frames_dropped;
+    volatile uint32_t blocks_written;
+    volatile uint32_t bytes_written;
+    volatile uint32_t write_errors;
+
+    bool openBlock();
+    void closeBlock();
+    int16_t lookupId(uint32_t key_id) const;
+
+    bool openSegment();
+    void writeBlock(const CaptureBlock_t& block);
+    static void writerTask(void* ctx);
+};
+
+#endif // CAN_CAPTURE_H
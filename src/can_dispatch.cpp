@@ -0,0 +1,58 @@
+#include "can_dispatch.h"
+
+CANDispatchTable::CANDispatchTable() {
+    clear();
+}
+
+void CANDispatchTable::clear() {
+    memset(std_bitmap, 0, sizeof(std_bitmap));
+    memset(std_index, NO_FRAME, sizeof(std_index));
+    std_count = 0;
+    ext_count = 0;
+}
+
+bool CANDispatchTable::add(uint32_t can_id, uint8_t frame_index) {
+    if (frame_index == NO_FRAME) return false;
+    
+    if (can_id <= CAN_STD_ID_MAX) {
+        if (!(std_bitmap[can_id >> 5] & (1UL << (can_id & 31)))) {
+            std_bitmap[can_id >> 5] |= (1UL << (can_id & 31));
+            std_count++;
+        }
+        std_index[can_id] = frame_index;
+        return true;
+    }
+    
+    // Extended ID: keep ext_ids sorted (insertion only happens at registration)
+    uint8_t pos = 0;
+    while (pos < ext_count && ext_ids[pos] < can_id) pos++;
+    
+    if (pos < ext_count && ext_ids[pos] == can_id) {
+        ext_index[pos] = frame_index;
+        return true;
+    }
+    if (ext_count >= CAN_DISPATCH_MAX_EXT_IDS) return false;
+    
+    for (uint8_t i = ext_count; i > pos; i--) {
+        ext_ids[i] = ext_ids[i - 1];
+        ext_index[i] = ext_index[i - 1];
+    }
+    ext_ids[pos] = can_id;
+    ext_index[pos] = frame_index;
+    ext_count++;
+    return true;
+}
+
+uint8_t CANDispatchTable::lookupExtended(uint32_t can_id) const {
+    uint8_t low = 0;
+    uint8_t high = ext_count;
+    while (low < high) {
+        uint8_t mid = (low + high) / 2;
+        if (ext_ids[mid] < can_id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return (low < ext_count && ext_ids[low] == can_id) ? ext_index[low] : NO_FRAME;
+}
@@ -0,0 +1,52 @@
+#ifndef CAN_DISPATCH_H
+#define CAN_DISPATCH_H
+
+#include <stdint.h>
+#include <string.h>
+#include "can_messages.h"
+
+// Flat CAN ID dispatch table capacity
+#define CAN_DISPATCH_MAX_FRAMES 32     // Distinct CAN IDs with registered signals
+#define CAN_DISPATCH_MAX_EXT_IDS 16    // Of which 29-bit extended IDs
+
+// CAN ID -> frame index lookup.
+// 11-bit IDs use a 2048-bit presence bitmap plus a direct index table, so an
+// unwanted frame is rejected with a single bit test. 29-bit IDs fall back to
+// a sorted array searched with binary search.
+class CANDispatchTable {
+public:
+    static const uint8_t NO_FRAME = 0xFF;
+    
+    CANDispatchTable();
+    
+    void clear();
+    bool add(uint32_t can_id, uint8_t frame_index);
+    
+    // Hot path: returns the frame index or NO_FRAME
+    inline uint8_t lookup(uint32_t can_id) const {
+        if (can_id <= CAN_STD_ID_MAX) {
+            if (!(std_bitmap[can_id >> 5] & (1UL << (can_id & 31)))) {
+                return NO_FRAME;
+            }
+            return std_index[can_id];
+        }
+        return lookupExtended(can_id);
+    }
+    
+    uint8_t getStandardCount() const { return std_count; }
+    uint8_t getExtendedCount() const { return ext_count; }
+    
+private:
+    uint8_t lookupExtended(uint32_t can_id) const;
+    
+    uint32_t std_bitmap[(CAN_STD_ID_MAX + 1) / 32];
+    uint8_t std_index[CAN_STD_ID_MAX + 1];
+    uint8_t std_count;
+    
+    // Sorted by ID
+    uint32_t ext_ids[CAN_DISPATCH_MAX_EXT_IDS];
+    uint8_t ext_index[CAN_DISPATCH_MAX_EXT_IDS];
+    uint8_t ext_count;
+};
+
+#endif // CAN_DISPATCH_H
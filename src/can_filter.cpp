@@ -0,0 +1,148 @@
+#include "can_filter.h"
+
+#define CAN_STD_ID_BITS 11
+#define CAN_EXT_ID_BITS 29
+
+namespace {
+    uint8_t popcount32(uint32_t value) {
+        uint8_t count = 0;
+        while (value) {
+            value &= value - 1;
+            count++;
+        }
+        return count;
+    }
+    
+    uint32_t idMask(uint8_t id_bits) {
+        return (id_bits >= 32) ? 0xFFFFFFFFUL : ((1UL << id_bits) - 1UL);
+    }
+    
+    // Cover the IDs selected by a membership bitmap
+    CANIdMask_t coverGroup(const uint32_t* ids, size_t count, uint64_t members, uint8_t id_bits) {
+        CANIdMask_t result = {0, 0, 0};
+        bool first = true;
+        uint32_t differing = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!(members & (1ULL << i))) continue;
+            if (first) {
+                result.code = ids[i];
+                first = false;
+            } else {
+                differing |= result.code ^ ids[i];
+            }
+        }
+        if (first) return result;  // Empty group admits nothing
+        
+        result.mask = differing & idMask(id_bits);
+        result.code &= ~result.mask & idMask(id_bits);
+        result.admitted = 1UL << popcount32(result.mask);
+        return result;
+    }
+    
+    // Size of the union of two code/mask sets
+    uint32_t unionSize(const CANIdMask_t& a, const CANIdMask_t& b) {
+        if (a.admitted == 0) return b.admitted;
+        if (b.admitted == 0) return a.admitted;
+        uint32_t fixed_in_both = ~(a.mask | b.mask);
+        uint32_t overlap = ((a.code ^ b.code) & fixed_in_both) ? 0
+            : (1UL << popcount32(a.mask & b.mask));
+        return a.admitted + b.admitted - overlap;
+    }
+}
+
+CANIdMask_t CANFilter::cover(const uint32_t* ids, size_t count, uint8_t id_bits) {
+    if (count > CAN_FILTER_MAX_IDS) count = CAN_FILTER_MAX_IDS;
+    uint64_t all = (count >= 64) ? ~0ULL : ((1ULL << count) - 1ULL);
+    return coverGroup(ids, count, all, id_bits);
+}
+
+CANFilterConfig_t CANFilter::compute(const uint32_t* ids, size_t count) {
+    CANFilterConfig_t config = {};
+    config.accept_all = true;
+    config.single_filter = true;
+    config.acceptance_code = 0;
+    config.acceptance_mask = 0xFFFFFFFFUL;
+    config.wanted = count;
+    
+    if (count == 0 || count > CAN_FILTER_MAX_IDS) return config;
+    
+    bool has_std = false;
+    bool has_ext = false;
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] > 0x7FF) has_ext = true; else has_std = true;
+    }
+    if (has_std && has_ext) return config;  // One layout cannot serve both frame types
+    
+    config.accept_all = false;
+    config.extended = has_ext;
+    uint8_t id_bits = has_ext ? CAN_EXT_ID_BITS : CAN_STD_ID_BITS;
+    
+    CANIdMask_t single = cover(ids, count, id_bits);
+    config.filter_count = 1;
+    config.filter[0] = single;
+    config.admitted_total = single.admitted;
+    
+    // Dual filter mode only compares the full identifier for 11-bit frames
+    if (!has_ext && count > 1) {
+        uint64_t all = (count >= 64) ? ~0ULL : ((1ULL << count) - 1ULL);
+        uint64_t best_group = 0;
+        uint32_t best_total = single.admitted;
+        
+        // Candidate splits: partition on each identifier bit
+        for (uint8_t bit = 0; bit < id_bits; bit++) {
+            uint64_t group = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (ids[i] & (1UL << bit)) group |= (1ULL << i);
+            }
+            if (group == 0 || group == all) continue;
+            uint32_t total = unionSize(coverGroup(ids, count, group, id_bits),
+                                       coverGroup(ids, count, all & ~group, id_bits));
+            if (total < best_total) {
+                best_total = total;
+                best_group = group;
+            }
+        }
+        
+        // Local refinement: move single IDs across while it shrinks the union
+        bool improved = (best_group != 0);
+        while (improved) {
+            improved = false;
+            for (size_t i = 0; i < count; i++) {
+                uint64_t group = best_group ^ (1ULL << i);
+                if (group == 0 || group == all) continue;
+                uint32_t total = unionSize(coverGroup(ids, count, group, id_bits),
+                                           coverGroup(ids, count, all & ~group, id_bits));
+                if (total < best_total) {
+                    best_total = total;
+                    best_group = group;
+                    improved = true;
+                }
+            }
+        }
+        
+        if (best_group != 0) {
+            config.single_filter = false;
+            config.filter_count = 2;
+            config.filter[0] = coverGroup(ids, count, best_group, id_bits);
+            config.filter[1] = coverGroup(ids, count, all & ~best_group, id_bits);
+            config.admitted_total = best_total;
+        }
+    }
+    
+    // Translate to the TWAI register layout
+    if (config.extended) {
+        // Single filter, 29-bit: ID in bits 31:3, RTR and unused bits don't care
+        config.acceptance_code = config.filter[0].code << 3;
+        config.acceptance_mask = (config.filter[0].mask << 3) | 0x7UL;
+    } else if (config.single_filter) {
+        // Single filter, 11-bit: ID in bits 31:21, RTR and data bytes don't care
+        config.acceptance_code = config.filter[0].code << 21;
+        config.acceptance_mask = (config.filter[0].mask << 21) | 0x001FFFFFUL;
+    } else {
+        // Dual filter, 11-bit: filter 1 ID in bits 31:21, filter 2 ID in bits 15:5
+        config.acceptance_code = (config.filter[0].code << 21) | (config.filter[1].code << 5);
+        config.acceptance_mask = (config.filter[0].mask << 21) | (config.filter[1].mask << 5) |
+                                 0x001F001FUL;
+    }
+    return config;
+}
@@ -0,0 +1,45 @@
+#ifndef CAN_FILTER_H
+#define CAN_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// CAN ACCEPTANCE FILTER CALCULATOR
+// Derives the tightest TWAI (SJA1000-style) acceptance code/mask from a set
+// of wanted CAN IDs. Mask bits set to 1 are "don't care". IDs admitted by the
+// mask but not wanted are rejected in software by the dispatch table.
+// ============================================================================
+
+#define CAN_FILTER_MAX_IDS 64
+
+// One code/mask pair over the raw CAN identifier
+typedef struct {
+    uint32_t code;       // Required ID bits (where mask bit = 0)
+    uint32_t mask;       // 1 = don't care
+    uint32_t admitted;   // Number of IDs this pair admits
+} CANIdMask_t;
+
+typedef struct {
+    bool accept_all;         // No usable filter (no IDs or mixed 11/29-bit)
+    bool single_filter;      // TWAI single filter mode
+    bool extended;           // 29-bit layout
+    uint8_t filter_count;    // 1 or 2 entries of filter[] in use
+    CANIdMask_t filter[2];
+    uint32_t admitted_total; // IDs admitted by the union of all filters
+    uint32_t wanted;         // Distinct IDs requested
+    
+    // Register values for twai_filter_config_t
+    uint32_t acceptance_code;
+    uint32_t acceptance_mask;
+} CANFilterConfig_t;
+
+namespace CANFilter {
+    // Tightest single code/mask covering all ids (id_bits = 11 or 29)
+    CANIdMask_t cover(const uint32_t* ids, size_t count, uint8_t id_bits);
+    
+    // Best single or dual filter configuration for the given ID set
+    CANFilterConfig_t compute(const uint32_t* ids, size_t count);
+}
+
+#endif // CAN_FILTER_H
@@ -8,10 +8,27 @@ CANHandler::CANHandler()
       msg_count1(0),
       msg_count2(0),
       last_error(0),
-      last_can_activity(0) {}
+      can1_speed(CAN_SPEED_HIGH),
+      can2_transport(SPI, MCP2515_SCK_PIN, MCP2515_MISO_PIN, MCP2515_MOSI_PIN,
+                     MCP2515_CS_PIN, MCP2515_SPI_HZ),
+      can2_controller(&can2_transport),
+      can2_burst_count(0),
+      can2_burst_pos(0),
+      can2_irq_pending(false),
+      can2_irq_us(0),
+      can2_overflows(0),
+      filter_id_count(0),
+      rx_task_handle(nullptr),
+      rx_task_running(false),
+      bus_off_events(0),
+      bus_recoveries(0),
+      last_can_activity(0) {
+    can1_filter = CANFilter::compute(nullptr, 0);  // Accept all until signals are known
+}
 
 CANHandler::~CANHandler() {
     end();
+    endCAN2();
 }
 
 bool CANHandler::begin() {
@@ -20,13 +37,24 @@ bool CANHandler::begin() {
 
 void CANHandler::end() {
     if (can1_initialized) {
+        stopRxTask();
         twai_stop();
         twai_driver_uninstall();
         can1_initialized = false;
     }
 }
 
+void CANHandler::endCAN2() {
+    if (can2_initialized) {
+        detachInterrupt(digitalPinToInterrupt(MCP2515_INT_PIN));
+        can2_transport.end();
+        can2_initialized = false;
+    }
+}
+
 bool CANHandler::setupCAN1(uint32_t speed) {
+    can1_speed = speed;
+    
     // CAN1 Configuration - High Speed (500kbps)
     twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(
         (gpio_num_t)CAN1_TX_PIN,
@@ -59,6 +87,11 @@ bool CANHandler::setupCAN1(uint32_t speed) {
     }
     
     twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    if (!can1_filter.accept_all) {
+        f_config.acceptance_code = can1_filter.acceptance_code;
+        f_config.acceptance_mask = can1_filter.acceptance_mask;
+        f_config.single_filter = can1_filter.single_filter;
+    }
     
     // Install TWAI driver
     if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK) {
@@ -75,57 +108,258 @@ bool CANHandler::setupCAN1(uint32_t speed) {
         return false;
     }
     
-    // Configure alerts to enable RX data detection
-    uint32_t alerts_to_enable = TWAI_ALERT_RX_DATA | TWAI_ALERT_ERR_PASS | TWAI_ALERT_BUS_ERROR;
+    // Configure error alerts (read by pollAlerts)
+    uint32_t alerts_to_enable = TWAI_ALERT_ERR_PASS | TWAI_ALERT_BUS_ERROR |
+                                TWAI_ALERT_ABOVE_ERR_WARN | TWAI_ALERT_BUS_OFF |
+                                TWAI_ALERT_BUS_RECOVERED | TWAI_ALERT_RX_QUEUE_FULL;
     if (twai_reconfigure_alerts(alerts_to_enable, NULL) != ESP_OK) {
         DEBUG_PRINTLN("[CAN1] Alert configuration failed");
     }
     
     can1_initialized = true;
+    bus_monitor1.begin(speed);
     DEBUG_PRINTF("[CAN1] Initialized successfully at %lu bps\n", speed);
+    
+    if (!startRxTask()) {
+        DEBUG_PRINTLN("[CAN1] RX task start failed, falling back to polling");
+    }
     return true;
 }
 
-bool CANHandler::setupCAN2(uint32_t speed) {
-    // CAN2 Note: ESP32 has only one hardware CAN module (TWAI)
-    // For true dual CAN, external MCP2515 module would be needed on SPI
-    // This is kept as placeholder for future expansion
-    DEBUG_PRINTLN("[CAN2] Note: Dual CAN requires external MCP2515 module. Currently disabled.");
-    can2_initialized = false;
+bool CANHandler::startRxTask() {
+    if (rx_task_handle != nullptr) return true;
+    
+    can1_ring.reset();
+    rx_task_running = true;
+    if (xTaskCreate(rxTask, "can1_rx", CAN_RX_TASK_STACK, this,
+                    CAN_RX_TASK_PRIORITY, &rx_task_handle) != pdPASS) {
+        rx_task_running = false;
+        rx_task_handle = nullptr;
+        last_error = 1004;
+        return false;
+    }
     return true;
 }
 
-bool CANHandler::readCAN1(CANMessage_t& msg) {
-    if (!can1_initialized) return false;
+void CANHandler::stopRxTask() {
+    if (rx_task_handle == nullptr) return;
     
+    // The task notices within one twai_receive() timeout and clears its handle
+    rx_task_running = false;
+    while (rx_task_handle != nullptr) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+void CANHandler::rxTask(void* ctx) {
+    CANHandler* self = static_cast<CANHandler*>(ctx);
     twai_message_t rx_msg;
+    CANMessage_t msg;
     
-    // Use non-blocking read
-    if (twai_receive(&rx_msg, 0) == ESP_OK) {
+    while (self->rx_task_running) {
+        // Block until a frame arrives; the timeout only serves shutdown
+        if (twai_receive(&rx_msg, pdMS_TO_TICKS(CAN_RX_TASK_WAIT_MS)) != ESP_OK) {
+            continue;
+        }
+        
+        // Stamp immediately on wake-up, before any other work
+        msg.timestamp_us = monotonicMicros();
         msg.id = rx_msg.identifier;
-        msg.dlc = rx_msg.data_length_code;
-        msg.timestamp = millis();
+        msg.dlc = (rx_msg.data_length_code <= 8) ? rx_msg.data_length_code : 8;
+        memcpy(msg.data, rx_msg.data, msg.dlc);
         
-        // Safe copy of data
-        if (rx_msg.data_length_code <= 8) {
-            memcpy(msg.data, rx_msg.data, rx_msg.data_length_code);
+        self->can1_ring.push(msg);  // Counts a drop when the decoder falls behind
+    }
+    
+    self->rx_task_handle = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool CANHandler::setupCAN2(uint32_t speed) {
+    // CAN2 uses an external MCP2515 on SPI (the ESP32 has a single TWAI module)
+    can2_transport.begin();
+    if (!can2_controller.begin(speed, MCP2515_CLOCK_MHZ)) {
+        DEBUG_PRINTLN("[CAN2] MCP2515 not found or bitrate unsupported, CAN2 disabled");
+        can2_transport.end();
+        can2_initialized = false;
+        return true;  // CAN2 is optional
+    }
+    
+    if (filter_id_count > 0 && !can2_controller.setFilters(filter_ids, filter_id_count)) {
+        DEBUG_PRINTLN("[CAN2] Filter configuration failed");
+        last_error = 2001;
+    }
+    
+    can2_burst_count = 0;
+    can2_burst_pos = 0;
+    can2_irq_pending = false;
+    pinMode(MCP2515_INT_PIN, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(MCP2515_INT_PIN), onCAN2Receive, this, FALLING);
+    
+    can2_initialized = true;
+    bus_monitor2.begin(speed);
+    DEBUG_PRINTF("[CAN2] MCP2515 initialized at %lu bps\n", speed);
+    return true;
+}
+
+bool CANHandler::readCAN1(CANMessage_t& msg) {
+    return readCAN1Batch(&msg, 1) == 1;
+}
+
+size_t CANHandler::readCAN1Batch(CANMessage_t* out, size_t max, uint32_t budget_us) {
+    if (!can1_initialized || max == 0) return 0;
+    
+    uint32_t start_us = micros();
+    size_t count = 0;
+    
+    if (rx_task_handle != nullptr) {
+        // Frames buffered by the RX task
+        while (count < max && can1_ring.pop(out[count])) {
+            count++;
+            // Check the budget every 8 frames to keep micros() off the per-frame path
+            if (budget_us > 0 && (count & 7) == 0 && (micros() - start_us) >= budget_us) {
+                break;
+            }
         }
-        
-        msg_count1++;
+    } else {
+        // Polling fallback: non-blocking reads straight from the driver
+        twai_message_t rx_msg;
+        while (count < max && twai_receive(&rx_msg, 0) == ESP_OK) {
+            CANMessage_t& msg = out[count++];
+            msg.timestamp_us = monotonicMicros();
+            msg.id = rx_msg.identifier;
+            msg.dlc = (rx_msg.data_length_code <= 8) ? rx_msg.data_length_code : 8;
+            memcpy(msg.data, rx_msg.data, msg.dlc);
+            
+            if (budget_us > 0 && (micros() - start_us) >= budget_us) {
+                break;
+            }
+        }
+    }
+    
+    // Counters and activity are updated once per batch
+    if (count > 0) {
+        msg_count1 += count;
         last_can_activity = millis();
-        
-        return true;
+        for (size_t i = 0; i < count; i++) {
+            bus_monitor1.onFrame(out[i]);
+        }
     }
+    return count;
+}
+
+void CANHandler::pollAlerts() {
+    if (!can1_initialized) return;
     
-    return false;
+    uint32_t alerts = 0;
+    if (twai_read_alerts(&alerts, 0) != ESP_OK) return;
+    
+    if (alerts & TWAI_ALERT_ERR_PASS) {
+        DEBUG_PRINTLN("[CAN1] Controller is error passive");
+    }
+    if (alerts & TWAI_ALERT_RX_QUEUE_FULL) {
+        DEBUG_PRINTLN("[CAN1] Driver RX queue full, frames lost");
+    }
+    if (alerts & TWAI_ALERT_BUS_OFF) {
+        // Bus-off: wait for 128 x 11 recessive bits, then restart
+        bus_off_events++;
+        DEBUG_PRINTLN("[CAN1] Bus-off, initiating recovery");
+        twai_initiate_recovery();
+    }
+    if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+        bus_recoveries++;
+        DEBUG_PRINTLN("[CAN1] Bus recovered, restarting controller");
+        twai_start();
+    }
+}
+
+bool CANHandler::getControllerHealth1(CANControllerHealth_t& health) const {
+    if (!can1_initialized) return false;
+    
+    twai_status_info_t status;
+    if (twai_get_status_info(&status) != ESP_OK) return false;
+    
+    switch (status.state) {
+        case TWAI_STATE_RUNNING:    health.state = "running"; break;
+        case TWAI_STATE_BUS_OFF:    health.state = "bus-off"; break;
+        case TWAI_STATE_RECOVERING: health.state = "recovering"; break;
+        default:                    health.state = "stopped"; break;
+    }
+    health.tx_error_counter = status.tx_error_counter;
+    health.rx_error_counter = status.rx_error_counter;
+    health.bus_error_count = status.bus_error_count;
+    health.rx_missed_count = status.rx_missed_count;
+    health.rx_overrun_count = status.rx_overrun_count;
+    health.arb_lost_count = status.arb_lost_count;
+    health.bus_off_events = bus_off_events;
+    health.recoveries = bus_recoveries;
+    return true;
+}
+
+bool CANHandler::setAcceptanceFilter(const uint32_t* ids, size_t count) {
+    CANFilterConfig_t config = CANFilter::compute(ids, count);
+    
+    if (config.accept_all) {
+        DEBUG_PRINTF("[CAN1] Filter: accepting all frames (%u IDs, no common layout)\n",
+                    (unsigned)count);
+    } else {
+        DEBUG_PRINTF("[CAN1] Filter: %s, code 0x%08X mask 0x%08X admits %u IDs for %u wanted\n",
+                    config.single_filter ? "single" : "dual",
+                    config.acceptance_code, config.acceptance_mask,
+                    config.admitted_total, config.wanted);
+    }
+    
+    filter_id_count = (count < CAN_FILTER_MAX_IDS) ? count : CAN_FILTER_MAX_IDS;
+    memcpy(filter_ids, ids, filter_id_count * sizeof(uint32_t));
+    if (can2_initialized && !can2_controller.setFilters(filter_ids, filter_id_count)) {
+        DEBUG_PRINTLN("[CAN2] Filter configuration failed");
+        last_error = 2001;
+    }
+    
+    bool unchanged = (config.accept_all == can1_filter.accept_all) &&
+                     (config.single_filter == can1_filter.single_filter) &&
+                     (config.acceptance_code == can1_filter.acceptance_code) &&
+                     (config.acceptance_mask == can1_filter.acceptance_mask);
+    can1_filter = config;
+    
+    if (unchanged || !can1_initialized) {
+        return true;  // Applied on next setupCAN1()
+    }
+    
+    // TWAI filters can only be changed with the driver stopped and reinstalled
+    end();
+    return setupCAN1(can1_speed);
 }
 
 bool CANHandler::readCAN2(CANMessage_t& msg) {
-    // Placeholder for CAN2 (would use MCP2515 or similar)
-    return false;
+    if (!can2_initialized) return false;
+    
+    if (can2_burst_pos >= can2_burst_count) {
+        // INT stays low while any RX flag is set, so the pin level covers missed edges
+        if (!can2_irq_pending && digitalRead(MCP2515_INT_PIN) == HIGH) {
+            return false;
+        }
+        uint64_t stamp = can2_irq_pending ? can2_irq_us : monotonicMicros();
+        can2_irq_pending = false;
+        
+        can2_burst_count = can2_controller.readFrames(can2_burst, stamp);
+        can2_burst_pos = 0;
+        if (can2_burst_count == 0) return false;
+        
+        // Both buffers full means the bus outpaced us; check for lost frames
+        if (can2_burst_count == 2 && can2_controller.readAndClearOverflow()) {
+            can2_overflows++;
+        }
+    }
+    
+    msg = can2_burst[can2_burst_pos++];
+    bus_monitor2.onFrame(msg);
+    msg_count2++;
+    last_can_activity = millis();
+    return true;
 }
 
-bool CANHandler::sendCAN1(const CANMessage_t& msg) {
+bool CANHandler::sendCAN1(const CANMessage_t& msg, uint32_t timeout_ms) {
     if (!can1_initialized) return false;
     
     twai_message_t tx_msg = {};
@@ -139,7 +373,7 @@ bool CANHandler::sendCAN1(const CANMessage_t& msg) {
         memcpy(tx_msg.data, msg.data, msg.dlc);
     }
     
-    if (twai_transmit(&tx_msg, pdMS_TO_TICKS(1000)) == ESP_OK) {
+    if (twai_transmit(&tx_msg, pdMS_TO_TICKS(timeout_ms)) == ESP_OK) {
         DEBUG_PRINTF("[CAN1] Sent ID: 0x%03X\n", msg.id);
         return true;
     }
@@ -150,7 +384,16 @@ bool CANHandler::sendCAN1(const CANMessage_t& msg) {
 }
 
 bool CANHandler::sendCAN2(const CANMessage_t& msg) {
-    return false;  // CAN2 not implemented
+    if (!can2_initialized) return false;
+    
+    if (can2_controller.sendFrame(msg)) {
+        DEBUG_PRINTF("[CAN2] Sent ID: 0x%03X\n", msg.id);
+        return true;
+    }
+    
+    DEBUG_PRINTF("[CAN2] Transmit failed for ID: 0x%03X\n", msg.id);
+    last_error = 2003;
+    return false;
 }
 
 double CANHandler::extractSignal(const CANMessage_t& msg, const CANSignal_t& signal) {
@@ -159,35 +402,11 @@ double CANHandler::extractSignal(const CANMessage_t& msg, const CANSignal_t& sig
     
     if (msg.dlc == 0) return signal.offset;  // No data
     
-    uint64_t raw_value = 0;
-    uint8_t start_bit = signal.start_bit;
-    uint8_t bit_length = signal.bit_length;
-    
-    // Extract bits from data array (little-endian)
-    for (uint8_t i = 0; i < bit_length; i++) {
-        uint8_t byte_index = (start_bit + i) / 8;
-        uint8_t bit_in_byte = (start_bit + i) % 8;
-        
-        if (byte_index < msg.dlc && byte_index < 8) {
-            uint8_t bit_value = (msg.data[byte_index] >> bit_in_byte) & 1;
-            raw_value |= ((uint64_t)bit_value << i);
-        }
-    }
-    
-    // Handle signed values (two's complement)
-    if (bit_length < 64) {
-        uint64_t sign_bit = 1ULL << (bit_length - 1);
-        if (raw_value & sign_bit) {
-            // Sign extend
-            raw_value |= (0xFFFFFFFFFFFFFFFFULL << bit_length);
-        }
-    }
+    int64_t raw_value = SignalCodec::extractRaw(msg.data, msg.dlc, signal.start_bit,
+                                                signal.bit_length, signal.is_signed);
     
     // Apply scaling formula: physical_value = (raw_value * factor) + offset
-    int64_t signed_value = (int64_t)raw_value;
-    double physical_value = (double)signed_value * signal.factor + signal.offset;
-    
-    return physical_value;
+    return (double)raw_value * signal.factor + signal.offset;
 }
 
 void CANHandler::setupCANInterrupts1() {
@@ -195,7 +414,7 @@ void CANHandler::setupCANInterrupts1() {
 }
 
 void CANHandler::setupCANInterrupts2() {
-    // Placeholder
+    // MCP2515 INT pin is attached in setupCAN2()
 }
 
 void CANHandler::onCAN1Receive(void *ctx) {
@@ -204,5 +423,10 @@ void CANHandler::onCAN1Receive(void *ctx) {
 }
 
 void CANHandler::onCAN2Receive(void *ctx) {
-    // ISR callback for CAN2
+    // ISR callback for CAN2: only note the time, SPI access happens in readCAN2()
+    CANHandler* self = static_cast<CANHandler*>(ctx);
+    if (!self->can2_irq_pending) {
+        self->can2_irq_us = monotonicMicros();
+        self->can2_irq_pending = true;
+    }
 }
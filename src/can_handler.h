@@ -2,9 +2,26 @@
 #define CAN_HANDLER_H
 
 #include <Arduino.h>
-#include <queue>
 #include "config.h"
 #include "can_messages.h"
+#include "signal_extractor.h"
+#include "can_filter.h"
+#include "spsc_ring.h"
+#include "mcp2515_spi.h"
+#include "can_bus_monitor.h"
+
+// TWAI controller error state (CAN1)
+typedef struct {
+    const char* state;          // "running", "bus-off", "recovering", "stopped"
+    uint32_t tx_error_counter;
+    uint32_t rx_error_counter;
+    uint32_t bus_error_count;
+    uint32_t rx_missed_count;   // Frames lost because the driver RX queue was full
+    uint32_t rx_overrun_count;  // Frames lost in the controller FIFO
+    uint32_t arb_lost_count;
+    uint32_t bus_off_events;
+    uint32_t recoveries;
+} CANControllerHealth_t;
 
 class CANHandler {
 public:
@@ -14,6 +31,7 @@ public:
     // Initialization
     bool begin();
     void end();
+    void endCAN2();
     
     // CAN Bus Operations
     bool setupCAN1(uint32_t speed = CAN_SPEED_HIGH);
@@ -21,12 +39,17 @@ public:
     
     // Message receiving
     bool readCAN1(CANMessage_t& msg);
+    size_t readCAN1Batch(CANMessage_t* out, size_t max, uint32_t budget_us = 0);
     bool readCAN2(CANMessage_t& msg);
     
-    // Message sending (for diagnostic purposes)
-    bool sendCAN1(const CANMessage_t& msg);
+    // Message sending (for diagnostic purposes); timeout_ms = 0 never blocks
+    bool sendCAN1(const CANMessage_t& msg, uint32_t timeout_ms = 1000);
     bool sendCAN2(const CANMessage_t& msg);
     
+    // Hardware acceptance filtering (reinstalls the TWAI driver when running)
+    bool setAcceptanceFilter(const uint32_t* ids, size_t count);
+    const CANFilterConfig_t& getAcceptanceFilter() const { return can1_filter; }
+    
     // Signal extraction and parsing
     double extractSignal(const CANMessage_t& msg, const CANSignal_t& signal);
     
@@ -35,6 +58,19 @@ public:
     bool isConnected2() const { return can2_initialized; }
     uint32_t getMessagesReceived1() const { return msg_count1; }
     uint32_t getMessagesReceived2() const { return msg_count2; }
+    bool isRxTaskRunning1() const { return rx_task_handle != nullptr; }
+    uint32_t getRxDrops1() const { return can1_ring.getDrops(); }
+    uint32_t getRxHighWater1() const { return can1_ring.getHighWater(); }
+    uint32_t getRxPending1() const { return can1_ring.size(); }
+    uint32_t getSpiTransactions2() const { return can2_controller.getSpiTransactions(); }
+    uint32_t getRxOverflows2() const { return can2_overflows; }
+    uint32_t getLastActivity() const { return last_can_activity; }
+    
+    // Bus health
+    void pollAlerts();
+    bool getControllerHealth1(CANControllerHealth_t& health) const;
+    CANBusMonitor& getMonitor1() { return bus_monitor1; }
+    CANBusMonitor& getMonitor2() { return bus_monitor2; }
     
     // Error handling
     uint32_t getLastError() const { return last_error; }
@@ -48,14 +84,46 @@ protected:
     uint32_t msg_count2;  // Counter for CAN2 messages
     uint32_t last_error;
     
-    // Message queues
-    std::queue<CANMessage_t> can1_queue;
-    std::queue<CANMessage_t> can2_queue;
+    // CAN1 configuration (kept for driver reinstall)
+    uint32_t can1_speed;
+    CANFilterConfig_t can1_filter;
+    
+    // Message queues (CAN1: RX task -> readCAN1)
+    SpscRing<CANMessage_t, CAN_RX_QUEUE_SIZE> can1_ring;
+    
+    // CAN2: MCP2515 on SPI, both RX buffers read per interrupt
+    MCP2515SPITransport can2_transport;
+    MCP2515 can2_controller;
+    CANMessage_t can2_burst[2];
+    uint8_t can2_burst_count;
+    uint8_t can2_burst_pos;
+    volatile bool can2_irq_pending;
+    volatile uint64_t can2_irq_us;
+    uint32_t can2_overflows;
+    
+    // Wanted IDs, re-applied to CAN2 after (re)initialization
+    uint32_t filter_ids[CAN_FILTER_MAX_IDS];
+    size_t filter_id_count;
+    
+    // CAN1 RX task
+    TaskHandle_t rx_task_handle;
+    volatile bool rx_task_running;
+    
+    // Bus health
+    CANBusMonitor bus_monitor1;
+    CANBusMonitor bus_monitor2;
+    uint32_t bus_off_events;
+    uint32_t bus_recoveries;
     
     // RX activity tracking for sleep management
     uint32_t last_can_activity;
     
 private:
+    // RX task management
+    bool startRxTask();
+    void stopRxTask();
+    static void rxTask(void* ctx);
+    
     // Hardware setup helpers
     void setupCANInterrupts1();
     void setupCANInterrupts2();
@@ -0,0 +1,147 @@
+#include "charge_session.h"
+#include <string.h>
+
+static double counter(const DerivedSignalGraph& state, DerivedOutput_t output) {
+    return state.isValid(output) ? state.getValue(output) : 0.0;
+}
+
+ChargeSessionTracker::ChargeSessionTracker() : session_count(0) {
+    reset();
+}
+
+void ChargeSessionTracker::reset() {
+    memset(&session, 0, sizeof(session));
+    active = false;
+    last_frame_ms = 0;
+    base_charged = 0;
+    base_battery = 0;
+    step_sum = 0;
+    step_samples = 0;
+    step_last = 0;
+}
+
+void ChargeSessionTracker::update(uint32_t now_ms, const DerivedSignalGraph& state) {
+    last_frame_ms = now_ms;
+    if (!state.hasInput(DERIVED_IN_CHARGE_POWER)) return;
+
+    float power = (float)state.getInput(DERIVED_IN_CHARGE_POWER);
+    bool plugged = !state.hasInput(DERIVED_IN_PLUG) || state.getInput(DERIVED_IN_PLUG) >= 0.5;
+
+    if (!active) {
+        if (plugged && power >= CHARGE_START_KW) {
+            start(now_ms, state);
+        }
+        return;
+    }
+
+    if (!plugged) {
+        endSession(CHARGE_END_UNPLUGGED);
+        return;
+    }
+    session.power_kw = power;
+    addCurveSample(now_ms, power);
+    if (power >= CHARGE_START_KW) {
+        record(now_ms, state);
+    } else if ((now_ms - session.end_ms) >= CHARGE_STOP_IDLE_MS) {
+        endSession(CHARGE_END_COMPLETE);
+    }
+}
+
+void ChargeSessionTracker::tick(uint32_t now_ms) {
+    if (!active) return;
+    if ((now_ms - last_frame_ms) >= CHARGE_BUS_SILENT_MS) {
+        endSession(CHARGE_END_BUS_SILENT);
+    } else if ((now_ms - session.end_ms) >= CHARGE_STOP_IDLE_MS) {
+        endSession(CHARGE_END_COMPLETE);
+    }
+}
+
+void ChargeSessionTracker::endSession(ChargeEndReason_t reason) {
+    if (!active) return;
+    active = false;
+    session.reason = reason;
+    session.power_kw = 0;
+    finishCurve();
+}
+
+float ChargeSessionTracker::getAveragePower() const {
+    uint32_t duration_ms = session.end_ms - session.start_ms;
+    if (duration_ms == 0) return session.power_kw;
+    return (float)(session.energy_kwh * 3600000.0 / duration_ms);
+}
+
+void ChargeSessionTracker::start(uint32_t now_ms, const DerivedSignalGraph& state) {
+    memset(&session, 0, sizeof(session));
+    session.id = ++session_count;
+    session.start_ms = now_ms;
+    session.curve_step_ms = CHARGE_CURVE_STEP_MS;
+    base_charged = counter(state, DERIVED_ENERGY_CHARGED);
+    base_battery = counter(state, DERIVED_ENERGY_IN);
+    step_sum = 0;
+    step_samples = 0;
+    active = true;
+
+    session.power_kw = (float)state.getInput(DERIVED_IN_CHARGE_POWER);
+    addCurveSample(now_ms, session.power_kw);
+    record(now_ms, state);
+}
+
+void ChargeSessionTracker::record(uint32_t now_ms, const DerivedSignalGraph& state) {
+    session.end_ms = now_ms;
+    session.energy_kwh = counter(state, DERIVED_ENERGY_CHARGED) - base_charged;
+    session.battery_kwh = counter(state, DERIVED_ENERGY_IN) - base_battery;
+    if (session.power_kw > session.power_max) session.power_max = session.power_kw;
+
+    if (state.hasInput(DERIVED_IN_SOC)) {
+        float soc = (float)state.getInput(DERIVED_IN_SOC);
+        if (!session.has_soc) {
+            session.soc_start = soc;
+            session.has_soc = true;
+        }
+        session.soc_end = soc;
+    }
+}
+
+void ChargeSessionTracker::addCurveSample(uint32_t now_ms, float power) {
+    // The step being filled is always curve[curve_points]
+    uint32_t step = (now_ms - session.start_ms) / session.curve_step_ms;
+    while (step > session.curve_points) {
+        closeCurveStep();
+        step = (now_ms - session.start_ms) / session.curve_step_ms;
+    }
+    step_sum += power;
+    step_samples++;
+    step_last = power;
+}
+
+void ChargeSessionTracker::closeCurveStep() {
+    session.curve[session.curve_points++] =
+        step_samples > 0 ? (float)(step_sum / step_samples) : step_last;
+    step_sum = 0;
+    step_samples = 0;
+
+    if (session.curve_points == CHARGE_CURVE_POINTS) {
+        // Full: halve the resolution; the step being filled starts exactly
+        // at a doubled step boundary, so it simply continues
+        for (uint8_t i = 0; i < CHARGE_CURVE_POINTS / 2; i++) {
+            session.curve[i] = (session.curve[2 * i] + session.curve[2 * i + 1]) * 0.5f;
+        }
+        session.curve_points = CHARGE_CURVE_POINTS / 2;
+        session.curve_step_ms *= 2;
+    }
+}
+
+void ChargeSessionTracker::finishCurve() {
+    // Keep the steps up to the last sample with power; later ones only
+    // hold the wait on the plug
+    uint32_t last_step = (session.end_ms - session.start_ms) / session.curve_step_ms;
+    if (step_samples > 0 && session.curve_points <= last_step) {
+        closeCurveStep();
+        last_step = (session.end_ms - session.start_ms) / session.curve_step_ms;
+    }
+    if (session.curve_points > last_step + 1) {
+        session.curve_points = (uint8_t)(last_step + 1);
+    }
+    step_sum = 0;
+    step_samples = 0;
+}
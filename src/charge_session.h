@@ -0,0 +1,106 @@
+#ifndef CHARGE_SESSION_H
+#define CHARGE_SESSION_H
+
+#include <stdint.h>
+#include "derived_signals.h"
+
+// ============================================================================
+// CHARGE SESSIONS
+// Follows the plug and charger power kept by DerivedSignalGraph on frame
+// time:
+//   - a session starts when the charger delivers CHARGE_START_KW with the
+//     plug connected (power alone if the plug signal is not decoded)
+//   - it ends when the plug is pulled, when no power has flowed for
+//     CHARGE_STOP_IDLE_MS (charge complete, car still plugged in), or when
+//     the bus has been silent for CHARGE_BUS_SILENT_MS
+// Like a trip, the session ends at its last sample with power, so waiting
+// on the plug afterwards does not count. Energy is the difference of the
+// derived counters: from the charger and into the battery.
+//
+// The power curve keeps CHARGE_CURVE_POINTS averages of equal time steps,
+// starting at CHARGE_CURVE_STEP_MS. When it is full, neighbouring points are
+// merged pairwise and the step doubles, so any session length fits in
+// 16..32 points without knowing the length in advance.
+// ============================================================================
+
+#define CHARGE_START_KW 0.5             // Charger power that counts as charging
+#define CHARGE_STOP_IDLE_MS 600000UL    // No power this long ends the session
+#define CHARGE_BUS_SILENT_MS 60000UL    // No frames this long ends the session
+#define CHARGE_MIN_KWH 0.05             // Smaller sessions are not reported
+#define CHARGE_CURVE_POINTS 32          // Even: points are merged pairwise
+#define CHARGE_CURVE_STEP_MS 60000UL    // Initial curve resolution
+
+typedef enum {
+    CHARGE_END_NONE = 0,
+    CHARGE_END_UNPLUGGED,          // Plug pulled
+    CHARGE_END_COMPLETE,           // No power for CHARGE_STOP_IDLE_MS
+    CHARGE_END_BUS_SILENT,         // Car went to sleep
+    CHARGE_END_FORCED              // endSession(), e.g. end of a replay
+} ChargeEndReason_t;
+
+typedef struct {
+    uint32_t id;                   // Counts sessions since boot
+    uint32_t start_ms;             // Frame time of the first sample with power
+    uint32_t end_ms;               // Frame time of the last sample with power
+    double energy_kwh;             // Delivered by the charger
+    double battery_kwh;            // Stored in the battery
+    float power_kw;                // Latest charger power
+    float power_max;
+    float soc_start;
+    float soc_end;
+    bool has_soc;
+    ChargeEndReason_t reason;
+
+    // Average charger power per step, oldest first
+    float curve[CHARGE_CURVE_POINTS];
+    uint8_t curve_points;
+    uint32_t curve_step_ms;
+} ChargeSession_t;
+
+class ChargeSessionTracker {
+public:
+    ChargeSessionTracker();
+
+    void reset();
+
+    // New vehicle state from a frame
+    void update(uint32_t now_ms, const DerivedSignalGraph& state);
+
+    // Time passing without frames
+    void tick(uint32_t now_ms);
+
+    // End the current session now
+    void endSession(ChargeEndReason_t reason);
+
+    bool isActive() const { return active; }
+    // Current session, or the last one once it has ended; the curve is
+    // complete only after the end
+    const ChargeSession_t& getSession() const { return session; }
+    bool isReportable() const { return session.energy_kwh >= CHARGE_MIN_KWH; }
+
+    // Mean charger power while charging
+    float getAveragePower() const;
+
+private:
+    ChargeSession_t session;
+    bool active;
+    uint32_t session_count;
+    uint32_t last_frame_ms;
+
+    // Derived counters when the session started
+    double base_charged;
+    double base_battery;
+
+    // Curve step being filled
+    double step_sum;
+    uint16_t step_samples;
+    float step_last;               // Fills steps without samples
+
+    void start(uint32_t now_ms, const DerivedSignalGraph& state);
+    void record(uint32_t now_ms, const DerivedSignalGraph& state);
+    void addCurveSample(uint32_t now_ms, float power);
+    void closeCurveStep();
+    void finishCurve();
+};
+
+#endif // CHARGE_SESSION_H
@@ -25,9 +25,76 @@
 #define CAN_SPEED_HIGH 500000  // High-speed CAN (vehicle telemetry)
 #define CAN_SPEED_LOW  125000  // Low-speed CAN (comfort features)
 
-// CAN message queue size
+// MCP2515 SPI CAN controller for CAN2 (replaces the CAN2 transceiver; the
+// CAN2_RX/TX pins are not used). Every board env sets all five pins in
+// platformio.ini, see BOARD_CONFIG.md; the defaults are the ESP32 VSPI pins.
+#ifndef MCP2515_SCK_PIN
+#define MCP2515_SCK_PIN 18
+#endif
+#ifndef MCP2515_MISO_PIN
+#define MCP2515_MISO_PIN 19
+#endif
+#ifndef MCP2515_MOSI_PIN
+#define MCP2515_MOSI_PIN 23
+#endif
+#ifndef MCP2515_CS_PIN
+#define MCP2515_CS_PIN 5
+#endif
+#ifndef MCP2515_INT_PIN
+#define MCP2515_INT_PIN 32        // GPIO 34 is taken by BAT_MON_PIN
+#endif
+#define MCP2515_CLOCK_MHZ 8         // Crystal on the MCP2515 module
+#define MCP2515_SPI_HZ 8000000      // SPI clock (chip maximum is 10 MHz)
+
+// CAN message queue size (RX ring between RX task and decoder, power of two)
 #define CAN_RX_QUEUE_SIZE 256
 
+// CAN RX task
+#define CAN_RX_TASK_STACK 3072      // Bytes
+#define CAN_RX_TASK_PRIORITY 5      // Above the Arduino loop task (1)
+#define CAN_RX_TASK_WAIT_MS 100     // twai_receive() timeout, bounds task shutdown time
+#define CAN_RX_BATCH_SIZE 64        // Frames decoded per loop() iteration
+#define CAN_RX_BATCH_BUDGET_US 2000 // Time budget for draining one batch
+
+// CAN bus health monitor
+#define CAN_MONITOR_MAX_IDS 64                // Tracked CAN IDs per bus (power of two)
+#define CAN_DIAG_PUBLISH_INTERVAL 60000UL     // Diagnostics report period (ms)
+#define CAN_DIAG_MAX_IDS 24                   // Busiest CAN IDs listed in the report
+#define CAN_MONITOR_LOAD_WINDOW_US 1000000ULL // Short bus load window for the diagnostic poller
+
+// Diagnostic (ISO-TP) polling
+#define UDS_CELL_VOLTAGE_INTERVAL 300000UL    // Cell voltage refresh (ms)
+#define UDS_CELL_TEMP_INTERVAL 300000UL       // Module temperature refresh (ms)
+#define UDS_ACTIVE_WINDOW_MS 5000UL           // Only poll while the bus was active this recently
+
+// Binary CAN capture on LittleFS
+#define CAPTURE_DIR "/capture"
+#define CAPTURE_BLOCK_SIZE 512          // Bytes per block (one flash write)
+#define CAPTURE_BUFFER_BLOCKS 16        // RAM block pool (power of two)
+#define CAPTURE_BLOCK_MAX_IDS 64        // ID dictionary entries per block
+#define CAPTURE_SYNC_BLOCKS 8           // Blocks between file flushes
+#define CAPTURE_TASK_STACK 4096         // Bytes
+#define CAPTURE_TASK_PRIORITY 1         // Same as the Arduino loop task
+#define CAPTURE_WRITER_WAIT_MS 100      // Writer idle wait, bounds shutdown time
+
+// Store-and-forward MQTT outbox on LittleFS
+#define OUTBOX_DIR "/outbox"
+#define OUTBOX_CURSOR_FILE "/outbox/cursor"
+#define OUTBOX_PAGE_SIZE 2048           // RAM front buffer and flash write unit
+#define OUTBOX_SEGMENT_PAGES 8          // Pages per segment file (16 KB)
+#define OUTBOX_REPLAY_INTERVAL_MS 250UL // Replay step; messages per step follow the rate
+#define OUTBOX_FRONT_MAX_AGE_MS 300000UL // Write a partial RAM page after this long (reset loss bound)
+#define MQTT_RING_BYTES 16384           // Priority RAM queue in front of the outbox (max 65535)
+#define MQTT_RING_MAX_AGE_MS 120000UL   // Disconnected this long: move the RAM queue to flash
+
+// Trace replay from LittleFS
+#define REPLAY_OUTPUT_FILE "/replay_publish.log"  // Recorded publish stream
+#define REPLAY_LINE_MAX 128             // Longest candump/ASC line parsed
+#define REPLAY_LOOP_BUDGET_US 50000     // Replay time per loop() call
+
+// Signal registry capacity
+#define MAX_MANAGED_SIGNALS 64         // Total registered signals
+
 // ============================================================================
 // MQTT CONFIGURATION
 // ============================================================================
@@ -44,6 +111,14 @@
 #define MQTT_PUBLISH_INTERVAL_FAST 60000UL   // 60 seconds (battery, SoC, speed)
 #define MQTT_PUBLISH_INTERVAL_MID  300000UL  // 5 minutes (temperatures, voltages)
 #define MQTT_PUBLISH_INTERVAL_SLOW 3600000UL // 60 minutes (statistics, history)
+#define MQTT_BATCH_MAX_BYTES 1024          // Flush a batch before it grows past this
+#define MQTT_BATCH_DEADLINE_MS 2000UL      // Longest a value waits in a batch
+#define PUBLISH_IDLE_ADVANCE_MS 100UL      // Run publish timers from loop() after this long without frames
+#define HISTORY_FLUSH_INTERVAL 900000UL    // Publish partial history blocks at least this often
+#define HISTORY_TICK_MS 1000UL             // History timestamp resolution
+#define CHARGE_LIVE_INTERVAL 300000UL      // Live charge session summary while charging
+#define TRIP_END_FIX_TIMEOUT_MS 120000UL   // Longest a trip summary waits for its end point
+#define TRIP_END_FIX_RETRY_MS 10000UL      // GPS poll interval while that fix is wanted
 
 #define MQTT_RECONNECT_INTERVAL 10000      // Retry connection every 10s
 // Note: MQTT_KEEPALIVE is defined by PubSubClient library (default 15 seconds)
@@ -1,34 +1,206 @@
 #include "data_manager.h"
+#include "number_format.h"
+#include "msgpack_writer.h"
+
+// Indices kept in 8-bit fields: history headers, FrameDecoder_t::signal_count
+// and the UDS response callback
+static_assert(MAX_MANAGED_SIGNALS <= 256, "History blocks carry the signal index in one byte");
+static_assert(DECODE_PLAN_MAX_SIGNALS <= 255, "FrameDecoder_t::signal_count is 8 bits");
+static_assert(UDS_MAX_REQUESTS <= 256, "UDS responses carry the request index in 8 bits");
+
+static const uint16_t NO_DERIVED_SIGNAL = 0xFFFF;  // derived_signals[] entry not registered
+
+bool CAN1FrameSender::sendFrame(uint32_t id, const uint8_t* data, uint8_t len) {
+    CANMessage_t msg = {};
+    msg.id = id;
+    msg.dlc = len;
+    memcpy(msg.data, data, len);
+    return can_handler->sendCAN1(msg, 0);
+}
 
 DataManager::DataManager(CANHandler* can, MQTTHandler* mqtt, ModemHandler* modem)
     : can_handler(can), mqtt_handler(mqtt), modem_handler(modem),
-      processed_messages(0), published_messages(0) {}
+      frame_count(0), signal_count(0), filters_dirty(false), window_summaries(false),
+      batching(false), batch_max_bytes(MQTT_BATCH_MAX_BYTES),
+      batch_deadline_ms(MQTT_BATCH_DEADLINE_MS),
+      class_fast_interval(MQTT_PUBLISH_INTERVAL_FAST),
+      class_mid_interval(MQTT_PUBLISH_INTERVAL_MID), batches_published(0), batch_dropped(0),
+      binary_batches(false), dictionary_dirty(true), dictionary_epoch(0),
+      history_enabled(false), history_flushed_ms(0), history_blocks(0), history_dropped(0),
+      boot_id(0), wall_anchor_ms(0), wall_anchor_unix(0),
+      trip_pending(false), trip_pending_ms(0), has_position(false),
+      charge_live_ms(0), clock_ms(0), clock_wall_ms(0), clock_valid(false),
+      processed_messages(0), published_messages(0), suppressed_reports(0),
+      heartbeat_reports(0), last_diagnostics(0),
+      diag_sender(can) {
+    memset(batches, 0, sizeof(batches));
+    memset(&trip_ended, 0, sizeof(trip_ended));
+    for (uint8_t d = 0; d < DERIVED_COUNT; d++) {
+        derived_signals[d] = NO_DERIVED_SIGNAL;
+    }
+    topics.setBase(MQTT_BASE_TOPIC);
+    internTopics();
+}
 
 DataManager::~DataManager() {}
 
+static const char* const BATCH_TOPICS[PUBLISH_CLASS_COUNT] = {"batch/fast", "batch/mid", "batch/slow"};
+static const char* const BINARY_BATCH_TOPICS[PUBLISH_CLASS_COUNT] = {
+    "batch/fast/mp", "batch/mid/mp", "batch/slow/mp"};
+static const uint16_t BATCH_HEADER_BYTES = 24;      // {"ts":...,"v":{}}
+static const uint16_t BATCH_VALUE_BYTES = 14;       // "":-12345.67,
+static const uint16_t BATCH_SUMMARY_BYTES = 72;     // "":{"last":..,"n":..},
+static const uint16_t BINARY_VALUE_BYTES = 12;      // uint16 index + int64, worst case
+static const uint16_t BINARY_SUMMARY_BYTES = 45;    // uint16 index + [4 x int64, uint32 count]
+static const uint8_t BINARY_BATCH_VERSION = 1;
+static const uint8_t HISTORY_VERSION = 2;
+static const uint8_t HISTORY_HEADER_BYTES = 20;     // version .. tick, boot id, time anchor
+
+// Largest batch every path can carry: the payload buffer, PubSubClient's
+// packet buffer and an outbox record, each with room for the longest batch
+// topic. Bigger batches would be dropped whole during an outage.
+static uint16_t batchPayloadLimit() {
+    const size_t topic = TOPIC_BASE_MAX + sizeof("/batch/fast/mp");
+    size_t limit = MAX_MQTT_PAYLOAD;
+    size_t framing = mqttPacketSize(topic, MQTT_MAX_PACKET_SIZE) - MQTT_MAX_PACKET_SIZE;
+    if (MQTT_MAX_PACKET_SIZE - framing < limit) limit = MQTT_MAX_PACKET_SIZE - framing;
+    if (OUTBOX_MAX_RECORD - OUTBOX_RECORD_HEADER - topic < limit) {
+        limit = OUTBOX_MAX_RECORD - OUTBOX_RECORD_HEADER - topic;
+    }
+    return (uint16_t)limit;
+}
+
+// Shared by the JSON and binary publishers; only one payload is built at a time
+static char payload_buffer[MAX_MQTT_PAYLOAD];
+
 bool DataManager::begin() {
     DEBUG_PRINTLN("[DataMgr] Data manager started");
     registerAllZoeSignals();
+    registerDiagnostics();
+    applyHardwareFilters();
     return true;
 }
 
 void DataManager::loop() {
     // This would be called periodically to process messages
+    if (filters_dirty) {
+        applyHardwareFilters();
+    }
+    
+    if (can_handler->isConnected1() &&
+        (millis() - last_diagnostics) >= CAN_DIAG_PUBLISH_INTERVAL) {
+        publishDiagnostics();
+        last_diagnostics = millis();
+    }
+    
+    // Bus quiet: keep heartbeats and batch deadlines running on wall time
+    uint32_t quiet_ms = millis() - clock_wall_ms;
+    if (clock_valid && quiet_ms >= PUBLISH_IDLE_ADVANCE_MS) {
+        uint32_t now = clock_ms + quiet_ms;
+        publish_wheel.advance(now, onSignalTimer, this);
+        if (batching) {
+            flushDueBatches(now);
+        }
+        if (history_enabled && (now - history_flushed_ms) >= HISTORY_FLUSH_INTERVAL) {
+            flushHistory();
+            history_flushed_ms = now;
+        }
+        bool was_driving = trip.isActive();
+        trip.tick(now);
+        handleTripChange(was_driving);
+        bool was_charging = charge.isActive();
+        charge.tick(now);
+        handleChargeChange(was_charging, now);
+    }
+    
+    // No fix after the trip ended: publish without its end point
+    if (trip_pending && (millis() - trip_pending_ms) >= TRIP_END_FIX_TIMEOUT_MS) {
+        publishPendingTrip();
+    }
+    
+    // Poll diagnostics only while the car is awake; requests would wake it
+    if (can_handler->isConnected1() &&
+        (millis() - can_handler->getLastActivity()) < UDS_ACTIVE_WINDOW_MS) {
+        uint64_t now_us = monotonicMicros();
+        uds_scheduler.setBusLoad(can_handler->getMonitor1().getRecentLoadPercent(now_us));
+        uds_scheduler.loop(now_us);
+    }
 }
 
-void DataManager::registerSignal(const char* signal_name, uint32_t can_id,
-                                  const CANSignal_t& signal,
-                                  uint32_t publish_interval, double tolerance) {
+ManagedSignal_t DataManager::makeSignal(const char* signal_name, uint32_t can_id,
+                                        const CANSignal_t& signal, const ReportPolicy_t& policy) {
     ManagedSignal_t managed_signal = {};
     managed_signal.name = signal_name;
     managed_signal.can_id = can_id;
     managed_signal.signal = signal;
-    managed_signal.publish_interval = publish_interval;
-    managed_signal.last_published = 0;
-    managed_signal.last_value = 0;
-    managed_signal.value_tolerance = tolerance;
+    managed_signal.policy = policy;
+    reportReset(managed_signal.report);
+    windowReset(managed_signal.window);
+    managed_signal.pending = false;
+    managed_signal.pending_value = 0;
+    managed_signal.publish_class = classify(managed_signal);
+    managed_signal.topic = topics.intern(signal.mqtt_topic);
+    if (managed_signal.topic.str == nullptr) {
+        DEBUG_PRINTF("[DataMgr] Topic arena full, %s will not be published\n", signal_name);
+    }
+    managed_signal.latest_value = 0;
+    managed_signal.has_value = false;
+    managed_signal.change_armed = false;
+    managed_signal.derived_input = derivedInputFor(signal.name);
+    return managed_signal;
+}
+
+void DataManager::registerSignal(const char* signal_name, uint32_t can_id,
+                                  const CANSignal_t& signal,
+                                  const ReportPolicy_t& policy) {
+    ManagedSignal_t managed_signal = makeSignal(signal_name, can_id, signal, policy);
+    
+    uint8_t frame_index = dispatch_table.lookup(can_id);
+    if (frame_index == CANDispatchTable::NO_FRAME) {
+        if (frame_count >= CAN_DISPATCH_MAX_FRAMES ||
+            !dispatch_table.add(can_id, frame_count)) {
+            DEBUG_PRINTF("[DataMgr] Dispatch table full, cannot register %s (CAN ID: 0x%03X)\n",
+                        signal_name, can_id);
+            return;
+        }
+        frame_index = frame_count++;
+        FrameDecoder_t& new_frame = frames[frame_index];
+        new_frame.can_id = can_id;
+        new_frame.first_signal = signal_count;
+        new_frame.signal_count = 0;
+        new_frame.diagnostic = false;
+        new_frame.plan.clear();
+    }
+    
+    FrameDecoder_t& frame = frames[frame_index];
+    if (signal_count >= MAX_MANAGED_SIGNALS || !frame.plan.addSignal(signal)) {
+        DEBUG_PRINTF("[DataMgr] Signal table full, cannot register %s (CAN ID: 0x%03X)\n",
+                    signal_name, can_id);
+        return;
+    }
     
-    signal_map[can_id].push_back(managed_signal);
+    // Keep the frame's signals contiguous: open a slot at the end of its range
+    uint16_t pos = frame.first_signal + frame.signal_count;
+    for (uint16_t i = signal_count; i > pos; i--) {
+        signals[i] = signals[i - 1];
+    }
+    for (uint8_t f = 0; f < frame_count; f++) {
+        if (f != frame_index && frames[f].first_signal >= pos) {
+            frames[f].first_signal++;
+        }
+    }
+    for (uint8_t d = 0; d < DERIVED_COUNT; d++) {
+        if (derived_signals[d] != NO_DERIVED_SIGNAL && derived_signals[d] >= pos) {
+            derived_signals[d]++;
+        }
+    }
+    signals[pos] = managed_signal;
+    frame.signal_count++;
+    signal_count++;
+    filters_dirty = true;
+    resetTimers();  // Signals moved: timer nodes are re-linked on the next value
+    dictionary_dirty = true;  // Indexes shifted
+    clearHistory();
     
     DEBUG_PRINTF("[DataMgr] Registered signal: %s (CAN ID: 0x%03X, topic: %s)\n",
                 signal_name, can_id, signal.mqtt_topic);
@@ -37,88 +209,1067 @@ void DataManager::registerSignal(const char* signal_name, uint32_t can_id,
 void DataManager::registerAllZoeSignals() {
     DEBUG_PRINTLN("[DataMgr] Registering Renault Zoe PH2 signals...");
     
+    // Report policies: {abs deadband, rel deadband, min spacing ms, max silence ms, priority}
+    
     // Battery signals
     registerSignal("SoC", BatteryMessages::MSG_BATTERY_STATUS,
-                   BatteryMessages::SIG_SOC, 60000UL, 0.1);
+                   BatteryMessages::SIG_SOC, {0.5, 0.0f, 10000UL, 600000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("SoH", BatteryMessages::MSG_BATTERY_STATUS,
-                   BatteryMessages::SIG_SOH, 300000UL, 0.1);
+                   BatteryMessages::SIG_SOH, {0.1, 0.0f, 60000UL, 3600000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("Voltage", BatteryMessages::MSG_BATTERY_POWER,
-                   BatteryMessages::SIG_BATTERY_VOLTAGE, 60000UL, 0.5);
+                   BatteryMessages::SIG_BATTERY_VOLTAGE, {2.0, 0.0f, 5000UL, 600000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("Current", BatteryMessages::MSG_BATTERY_POWER,
-                   BatteryMessages::SIG_BATTERY_CURRENT, 60000UL, 0.1);
+                   BatteryMessages::SIG_BATTERY_CURRENT, {1.0, 0.05f, 5000UL, 600000UL, REPORT_PRIORITY_NORMAL});
     
-    // Charging signals
+    // Charging signals (plug state and charge start/stop go out immediately);
+    // the power curve of a session comes with its charge/summary record
     registerSignal("PlugConnected", ChargingMessages::MSG_CHARGE_STATUS,
-                   ChargingMessages::SIG_PLUG_CONNECTED, 10000UL, 0.0);
+                   ChargingMessages::SIG_PLUG_CONNECTED, {0.0, 0.0f, 0UL, 600000UL, REPORT_PRIORITY_CRITICAL});
     registerSignal("ChargePower", ChargingMessages::MSG_CHARGE_STATUS,
-                   ChargingMessages::SIG_CHARGE_POWER, 60000UL, 0.5);
+                   ChargingMessages::SIG_CHARGE_POWER, {1.0, 0.1f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
     
     // Motion signals
     registerSignal("Speed", MotionMessages::MSG_SPEED,
-                   MotionMessages::SIG_VEHICLE_SPEED, 10000UL, 0.5);
+                   MotionMessages::SIG_VEHICLE_SPEED, {2.0, 0.05f, 5000UL, 300000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("Consumption", MotionMessages::MSG_CONSUMPTION,
-                   MotionMessages::SIG_CONSUMPTION_KWH, 60000UL, 0.1);
+                   MotionMessages::SIG_CONSUMPTION_KWH, {0.1, 0.0f, 30000UL, 600000UL, REPORT_PRIORITY_NORMAL});
     
     // Climate signals
     registerSignal("InteriorTemp", ClimateMessages::MSG_INTERIOR_TEMP,
-                   ClimateMessages::SIG_INTERIOR_TEMP, 300000UL, 0.5);
+                   ClimateMessages::SIG_INTERIOR_TEMP, {0.5, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
     
     // TPMS signals
     registerSignal("TireFL_Pressure", TPMSMessages::MSG_TPMS,
-                   TPMSMessages::SIG_TIRE_FL_PRESSURE, 300000UL, 0.1);
+                   TPMSMessages::SIG_TIRE_FL_PRESSURE, {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("TireFR_Pressure", TPMSMessages::MSG_TPMS,
-                   TPMSMessages::SIG_TIRE_FR_PRESSURE, 300000UL, 0.1);
+                   TPMSMessages::SIG_TIRE_FR_PRESSURE, {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("TireRL_Pressure", TPMSMessages::MSG_TPMS,
-                   TPMSMessages::SIG_TIRE_RL_PRESSURE, 300000UL, 0.1);
+                   TPMSMessages::SIG_TIRE_RL_PRESSURE, {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
     registerSignal("TireRR_Pressure", TPMSMessages::MSG_TPMS,
-                   TPMSMessages::SIG_TIRE_RR_PRESSURE, 300000UL, 0.1);
+                   TPMSMessages::SIG_TIRE_RR_PRESSURE, {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
     
     // Power signals
     registerSignal("Voltage12V", PowerMessages::MSG_AUX_VOLTAGE,
-                   PowerMessages::SIG_12V_VOLTAGE, 300000UL, 0.1);
+                   PowerMessages::SIG_12V_VOLTAGE, {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    
+    // Derived from voltage, current, speed and charger power above
+    registerDerivedSignal(DERIVED_POWER, DerivedMessages::SIG_POWER,
+                          {0.5, 0.05f, 5000UL, 600000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_ENERGY_OUT, DerivedMessages::SIG_ENERGY_OUT,
+                          {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_ENERGY_IN, DerivedMessages::SIG_ENERGY_IN,
+                          {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_REGEN, DerivedMessages::SIG_REGEN,
+                          {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_DISTANCE, DerivedMessages::SIG_DISTANCE,
+                          {0.5, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_ENERGY_CHARGED, DerivedMessages::SIG_ENERGY_CHARGED,
+                          {0.1, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_REGEN_SHARE, DerivedMessages::SIG_REGEN_SHARE,
+                          {1.0, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    registerDerivedSignal(DERIVED_CONSUMPTION, DerivedMessages::SIG_CONSUMPTION,
+                          {0.2, 0.0f, 60000UL, 1800000UL, REPORT_PRIORITY_NORMAL});
+    
+    DEBUG_PRINTF("[DataMgr] Total CAN message types registered: %u (%u extended)\n",
+                frame_count, dispatch_table.getExtendedCount());
+}
+
+void DataManager::registerDerivedSignal(DerivedOutput_t output, const CANSignal_t& signal,
+                                        const ReportPolicy_t& policy) {
+    if (signal_count >= MAX_MANAGED_SIGNALS || derived_signals[output] != NO_DERIVED_SIGNAL) {
+        DEBUG_PRINTF("[DataMgr] Cannot register derived signal %s\n", signal.name);
+        return;
+    }
+    
+    // No frame: appended after the decoded signals, fed by updateDerived()
+    signals[signal_count] = makeSignal(signal.name, 0, signal, policy);
+    signals[signal_count].derived_input = DERIVED_INPUT_NONE;
+    derived_signals[output] = signal_count++;
+    resetTimers();
+    dictionary_dirty = true;
+    clearHistory();
     
-    DEBUG_PRINTF("[DataMgr] Total CAN message types registered: %zu\n", signal_map.size());
+    DEBUG_PRINTF("[DataMgr] Registered derived signal: %s (topic: %s)\n",
+                signal.name, signal.mqtt_topic);
+}
+
+void DataManager::registerDiagnostics() {
+    uds_scheduler.begin(&diag_sender, onDiagnosticResponse, this);
+    
+    int8_t lbc = uds_scheduler.addEcu("LBC", DiagnosticMessages::LBC_TX_ID,
+                                      DiagnosticMessages::LBC_RX_ID);
+    if (lbc < 0 || !registerDiagnosticId(DiagnosticMessages::LBC_RX_ID)) {
+        DEBUG_PRINTLN("[DataMgr] Cannot register LBC diagnostics");
+        return;
+    }
+    
+    uds_scheduler.addRequest(lbc, DiagnosticMessages::REQ_CELL_VOLTAGES_1,
+                             sizeof(DiagnosticMessages::REQ_CELL_VOLTAGES_1),
+                             UDS_CELL_VOLTAGE_INTERVAL);
+    uds_scheduler.addRequest(lbc, DiagnosticMessages::REQ_CELL_VOLTAGES_2,
+                             sizeof(DiagnosticMessages::REQ_CELL_VOLTAGES_2),
+                             UDS_CELL_VOLTAGE_INTERVAL);
+    uds_scheduler.addRequest(lbc, DiagnosticMessages::REQ_MODULE_TEMPS,
+                             sizeof(DiagnosticMessages::REQ_MODULE_TEMPS),
+                             UDS_CELL_TEMP_INTERVAL);
+    
+    DEBUG_PRINTF("[DataMgr] Diagnostic polling: %u ECUs, %u requests\n",
+                uds_scheduler.getEcuCount(), uds_scheduler.getRequestCount());
+}
+
+bool DataManager::registerDiagnosticId(uint32_t rx_id) {
+    if (dispatch_table.lookup(rx_id) != CANDispatchTable::NO_FRAME) return true;
+    if (frame_count >= CAN_DISPATCH_MAX_FRAMES || !dispatch_table.add(rx_id, frame_count)) {
+        return false;
+    }
+    FrameDecoder_t& frame = frames[frame_count++];
+    frame.can_id = rx_id;
+    frame.first_signal = signal_count;
+    frame.signal_count = 0;
+    frame.diagnostic = true;
+    frame.plan.clear();
+    filters_dirty = true;
+    return true;
+}
+
+size_t DataManager::getRegisteredIds(uint32_t* ids, size_t max_ids) const {
+    size_t count = 0;
+    for (uint8_t f = 0; f < frame_count && count < max_ids; f++) {
+        ids[count++] = frames[f].can_id;
+    }
+    return count;
+}
+
+void DataManager::resetSignalState() {
+    for (uint16_t i = 0; i < signal_count; i++) {
+        reportReset(signals[i].report);
+        windowReset(signals[i].window);
+        signals[i].pending = false;
+        signals[i].has_value = false;
+    }
+    for (uint8_t c = 0; c < PUBLISH_CLASS_COUNT; c++) {
+        batches[c].pending = 0;
+    }
+    derived.reset();
+    trip.reset();
+    trip_pending = false;
+    charge.reset();
+    clearHistory();
+    resetTimers();
+}
+
+void DataManager::setBaseTopic(const char* base) {
+    topics.setBase(base);
+    internTopics();
+    DEBUG_PRINTF("[DataMgr] Base topic: %s (%u bytes of topics)\n", base, topics.getUsed());
+}
+
+void DataManager::internTopics() {
+    for (uint16_t i = 0; i < signal_count; i++) {
+        signals[i].topic = topics.intern(signals[i].signal.mqtt_topic);
+    }
+    for (uint8_t c = 0; c < PUBLISH_CLASS_COUNT; c++) {
+        batch_topics[c] = topics.intern(BATCH_TOPICS[c]);
+        binary_batch_topics[c] = topics.intern(BINARY_BATCH_TOPICS[c]);
+    }
+    dictionary_topic = topics.intern("batch/dict");
+    history_topic = topics.intern("history");
+    diagnostics_topic = topics.intern("diagnostics/can");
+    cells_topic = topics.intern("battery/cells");
+    trip_topic = topics.intern("trip/summary");
+    trip_active_topic = topics.intern("trip/active");
+    charge_topic = topics.intern("charge/summary");
+    charge_live_topic = topics.intern("charge/live");
+    charge_active_topic = topics.intern("charge/active");
+    dictionary_dirty = true;
+}
+
+void DataManager::resetTimers() {
+    for (uint16_t i = 0; i < signal_count; i++) {
+        timerNodeInit(signals[i].timer, i);
+        signals[i].change_armed = false;
+    }
+    publish_wheel.reset(clock_ms);
+    clock_valid = false;
+}
+
+void DataManager::applyHardwareFilters() {
+    uint32_t ids[CAN_DISPATCH_MAX_FRAMES];
+    size_t count = getRegisteredIds(ids, CAN_DISPATCH_MAX_FRAMES);
+    can_handler->setAcceptanceFilter(ids, count);
+    filters_dirty = false;
 }
 
 void DataManager::processCAN1Message(const CANMessage_t& msg) {
-    if (signal_map.find(msg.id) == signal_map.end()) {
+    uint8_t frame_index = dispatch_table.lookup(msg.id);
+    if (frame_index == CANDispatchTable::NO_FRAME) {
         return;  // No signals registered for this CAN ID
     }
     
     processed_messages++;
     
-    auto& signals = signal_map[msg.id];
-    for (auto& signal : signals) {
-        double value = can_handler->extractSignal(msg, signal.signal);
-        if (shouldPublish(signal, value)) {
-            publishSignal(signal, value);
-            published_messages++;
+    const FrameDecoder_t& frame = frames[frame_index];
+    if (frame.diagnostic) {
+        uds_scheduler.onFrame(msg.id, msg.data, msg.dlc, msg.timestamp_us);
+        return;
+    }
+    
+    // Decode every signal of this frame in one pass over the payload
+    double values[DECODE_PLAN_MAX_SIGNALS];
+    uint8_t count = frame.plan.decode(msg.data, msg.dlc, values);
+    
+    // Publish timing follows the frame timestamp, so a replayed trace
+    // produces the same publish stream as the live bus did
+    uint32_t now = msg.timestampMs();
+    advanceClock(now);
+    ManagedSignal_t* frame_signals = &signals[frame.first_signal];
+    for (uint8_t i = 0; i < count; i++) {
+        updateSignal(frame_signals[i], values[i], now);
+        if (frame_signals[i].derived_input != DERIVED_INPUT_NONE) {
+            derived.setInput((DerivedInput_t)frame_signals[i].derived_input, values[i]);
         }
     }
+    if (derived.hasPendingInputs()) {
+        updateDerived(now);
+    }
+}
+
+void DataManager::updateDerived(uint32_t now) {
+    uint16_t updated = derived.update(now);
+    for (uint8_t d = 0; d < DERIVED_COUNT; d++) {
+        if ((updated & (1 << d)) == 0 || derived_signals[d] == NO_DERIVED_SIGNAL) continue;
+        updateSignal(signals[derived_signals[d]], derived.getValue((DerivedOutput_t)d), now);
+    }
+    
+    bool was_driving = trip.isActive();
+    trip.update(now, derived);
+    handleTripChange(was_driving);
+    
+    bool was_charging = charge.isActive();
+    charge.update(now, derived);
+    handleChargeChange(was_charging, now);
+}
+
+void DataManager::setPosition(float latitude, float longitude) {
+    trip.setPosition(latitude, longitude);
+    has_position = true;
+    
+    // The first fix after a trip ended is where the car stopped
+    if (trip_pending) {
+        trip_ended.end_lat = latitude;
+        trip_ended.end_lon = longitude;
+        trip_ended.has_end_gps = true;
+        publishPendingTrip();
+    }
+}
+
+void DataManager::endTrip() {
+    bool was_driving = trip.isActive();
+    trip.endTrip(TRIP_END_FORCED);
+    handleTripChange(was_driving);
+    publishPendingTrip();
+}
+
+void DataManager::handleTripChange(bool was_active) {
+    bool active = trip.isActive();
+    if (active == was_active) return;
+    
+    if (trip_active_topic.str) {
+        mqtt_handler->publish(trip_active_topic.str, active ? "1" : "0", 1, true, MQTT_CLASS_ALARM);
+    }
+    const TripSummary_t& summary = trip.getSummary();
+    if (active) {
+        DEBUG_PRINTF("[Trip] Trip %lu started\n", summary.id);
+    } else if (trip.isReportable()) {
+        // A previous trip still waiting for its fix goes out as it is
+        publishPendingTrip();
+        if (has_position && summary.reason != TRIP_END_FORCED) {
+            trip_ended = summary;
+            trip_pending = true;
+            trip_pending_ms = millis();
+            DEBUG_PRINTF("[Trip] Trip %lu ended, waiting for a GPS fix\n", summary.id);
+        } else {
+            publishTripSummary(summary);
+        }
+    } else {
+        DEBUG_PRINTF("[Trip] Trip %lu discarded (%.2f km)\n", summary.id, summary.distance_km);
+    }
+}
+
+void DataManager::endChargeSession() {
+    bool was_charging = charge.isActive();
+    charge.endSession(CHARGE_END_FORCED);
+    handleChargeChange(was_charging, clock_ms);
+}
+
+void DataManager::handleChargeChange(bool was_active, uint32_t now) {
+    bool active = charge.isActive();
+    if (active == was_active) {
+        if (active && (now - charge_live_ms) >= CHARGE_LIVE_INTERVAL) {
+            publishChargeLive();
+            charge_live_ms = now;
+        }
+        return;
+    }
+    
+    if (charge_active_topic.str) {
+        mqtt_handler->publish(charge_active_topic.str, active ? "1" : "0", 1, true, MQTT_CLASS_ALARM);
+    }
+    const ChargeSession_t& session = charge.getSession();
+    if (active) {
+        DEBUG_PRINTF("[Charge] Session %lu started at %.1f kW\n", session.id, session.power_kw);
+        charge_live_ms = now;
+    } else if (charge.isReportable()) {
+        publishChargeSummary();
+    } else {
+        DEBUG_PRINTF("[Charge] Session %lu discarded (%.3f kWh)\n", session.id, session.energy_kwh);
+    }
+}
+
+void DataManager::advanceClock(uint32_t now) {
+    if (!clock_valid) {
+        publish_wheel.reset(now);
+        clock_valid = true;
+    }
+    clock_ms = now;
+    clock_wall_ms = millis();
+    publish_wheel.advance(now, onSignalTimer, this);
+    if (batching) {
+        flushDueBatches(now);
+    }
+    if (history_enabled && (now - history_flushed_ms) >= HISTORY_FLUSH_INTERVAL) {
+        flushHistory();
+        history_flushed_ms = now;
+    }
+}
+
+void DataManager::updateSignal(ManagedSignal_t& signal, double value, uint32_t now) {
+    windowAdd(signal.window, value);
+    signal.latest_value = value;
+    signal.has_value = true;
+    
+    if (reportIsUrgent(signal.policy, signal.report, value)) {
+        emitSignal(signal, value, now);
+        signal.change_armed = false;
+        armHeartbeat(signal);
+        return;
+    }
+    
+    // First change since the last evaluation: fire once the spacing allows
+    if (!signal.change_armed && reportIsChange(signal.policy, signal.report, value)) {
+        uint32_t due = now;
+        if (signal.report.has_published) {
+            uint32_t allowed = signal.report.last_published_ms + signal.policy.min_spacing_ms;
+            if ((int32_t)(allowed - now) > 0) due = allowed;
+        }
+        if (!timerIsScheduled(signal.timer) ||
+            (int32_t)(publish_wheel.expiresMs(signal.timer) - due) > 0) {
+            publish_wheel.schedule(signal.timer, due);
+        }
+        signal.change_armed = true;
+    }
+}
+
+void DataManager::onSignalTimer(void* ctx, TimerNode_t* node, uint32_t now) {
+    DataManager* self = static_cast<DataManager*>(ctx);
+    ManagedSignal_t& signal = self->signals[node->id];
+    if (!signal.has_value) return;
+    
+    // Change or heartbeat: the policy decides with the newest value
+    signal.change_armed = false;
+    self->emitSignal(signal, signal.latest_value, now);
+    self->armHeartbeat(signal);
+}
+
+void DataManager::emitSignal(ManagedSignal_t& signal, double value, uint32_t now) {
+    if (!shouldPublish(signal, value, now)) return;
+    if (history_enabled) {
+        recordHistory(&signal - signals, now, value);
+    }
+    if (batching && signal.policy.priority != REPORT_PRIORITY_CRITICAL) {
+        enqueueSignal(signal, value, now);
+    } else {
+        publishSignal(signal, value);
+    }
+    published_messages++;
+}
+
+void DataManager::armHeartbeat(ManagedSignal_t& signal) {
+    if (signal.policy.max_silence_ms == 0 || !signal.report.has_published) return;
+    publish_wheel.schedule(signal.timer,
+                           signal.report.last_published_ms + signal.policy.max_silence_ms);
+}
+
+void DataManager::processCAN1Batch(const CANMessage_t* msgs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        processCAN1Message(msgs[i]);
+    }
 }
 
 void DataManager::processCAN2Message(const CANMessage_t& msg) {
-    // CAN2 not implemented yet
+    // Both buses share one signal table (IDs do not collide on the Zoe)
+    processCAN1Message(msg);
+}
+
+bool DataManager::shouldPublish(ManagedSignal_t& signal, double new_value, uint32_t now) {
+    ReportReason_t reason = reportEvaluate(signal.policy, signal.report, new_value, now);
+    if (reason == REPORT_SUPPRESS) {
+        suppressed_reports++;
+        return false;
+    }
+    if (reason == REPORT_HEARTBEAT) {
+        heartbeat_reports++;
+    }
+    return true;
+}
+
+// Appends a literal; the payload buffer is sized for the longest output
+static size_t appendText(char* out, size_t pos, const char* text) {
+    size_t len = strlen(text);
+    memcpy(out + pos, text, len);
+    return pos + len;
+}
+
+void DataManager::publishSignal(ManagedSignal_t& signal, double value) {
+    if (signal.topic.str == nullptr) return;
+    
+    // {"last":..,"min":..,"max":..,"mean":..,"n":..} with five numbers at most
+    char payload[48 + 5 * NUMBER_FORMAT_MAX];
+    size_t len;
+    if (window_summaries && signal.window.count > 1) {
+        const SignalWindow_t& window = signal.window;
+        len = appendText(payload, 0, "{\"last\":");
+        len += formatDecimal(payload + len, window.last, 2);
+        len = appendText(payload, len, ",\"min\":");
+        len += formatDecimal(payload + len, window.min, 2);
+        len = appendText(payload, len, ",\"max\":");
+        len += formatDecimal(payload + len, window.max, 2);
+        len = appendText(payload, len, ",\"mean\":");
+        len += formatDecimal(payload + len, windowMean(window), 2);
+        len = appendText(payload, len, ",\"n\":");
+        len += formatUnsigned(payload + len, window.count);
+        len = appendText(payload, len, "}");
+        payload[len] = '\0';
+    } else {
+        len = formatDecimal(payload, value, 2);
+    }
+    // Critical signals are state transitions: they leave first after an outage
+    MqttClass_t cls = signal.policy.priority == REPORT_PRIORITY_CRITICAL ?
+                      MQTT_CLASS_ALARM : MQTT_CLASS_TELEMETRY;
+    mqtt_handler->publish(signal.topic.str, payload, len, true, cls);
+    windowReset(signal.window);
+}
+
+void DataManager::configureBatching(bool enabled, uint16_t max_bytes, uint32_t deadline_ms,
+                                    uint32_t fast_interval, uint32_t mid_interval) {
+    flushBatches();
+    batching = enabled;
+    if (max_bytes > batchPayloadLimit()) {
+        DEBUG_PRINTF("[DataMgr] Batch cap %u bytes lowered to %u\n", max_bytes, batchPayloadLimit());
+        max_bytes = batchPayloadLimit();
+    }
+    batch_max_bytes = max_bytes;
+    batch_deadline_ms = deadline_ms;
+    class_fast_interval = fast_interval;
+    class_mid_interval = mid_interval;
+    for (uint16_t i = 0; i < signal_count; i++) {
+        signals[i].publish_class = classify(signals[i]);
+    }
+    DEBUG_PRINTF("[DataMgr] Batch publishing %s (cap %u bytes, deadline %lu ms)\n",
+                enabled ? "enabled" : "disabled", max_bytes, deadline_ms);
+}
+
+uint8_t DataManager::classify(const ManagedSignal_t& signal) const {
+    uint32_t interval = signal.signal.update_interval;
+    if (interval <= class_fast_interval) return PUBLISH_CLASS_FAST;
+    if (interval <= class_mid_interval) return PUBLISH_CLASS_MID;
+    return PUBLISH_CLASS_SLOW;
+}
+
+void DataManager::enqueueSignal(ManagedSignal_t& signal, double value, uint32_t now) {
+    PublishBatch_t& batch = batches[signal.publish_class];
+    if (signal.pending) {
+        signal.pending_value = value;  // Already queued: send the newest value
+        return;
+    }
+    
+    uint16_t entry_bytes;
+    if (binary_batches) {
+        entry_bytes = window_summaries ? BINARY_SUMMARY_BYTES : BINARY_VALUE_BYTES;
+    } else {
+        entry_bytes = strlen(signal.signal.mqtt_topic) +
+                      (window_summaries ? BATCH_SUMMARY_BYTES : BATCH_VALUE_BYTES);
+    }
+    if (batch.pending > 0 && batch.bytes + entry_bytes > batch_max_bytes) {
+        flushBatch(signal.publish_class, now);
+    }
+    if (batch.pending == 0) {
+        batch.bytes = BATCH_HEADER_BYTES;
+        batch.opened_ms = now;
+    }
+    
+    signal.pending = true;
+    signal.pending_value = value;
+    batch.pending++;
+    batch.bytes += entry_bytes;
+}
+
+void DataManager::flushDueBatches(uint32_t now) {
+    for (uint8_t c = 0; c < PUBLISH_CLASS_COUNT; c++) {
+        if (batches[c].pending > 0 && (now - batches[c].opened_ms) >= batch_deadline_ms) {
+            flushBatch(c, now);
+        }
+    }
+}
+
+void DataManager::flushBatches() {
+    for (uint8_t c = 0; c < PUBLISH_CLASS_COUNT; c++) {
+        if (batches[c].pending > 0) {
+            flushBatch(c, batches[c].opened_ms + batch_deadline_ms);
+        }
+    }
+}
+
+void DataManager::flushBatch(uint8_t publish_class, uint32_t now) {
+    PublishBatch_t& batch = batches[publish_class];
+    
+    size_t len;
+    uint16_t entries;
+    const Topic_t* topic;
+    if (binary_batches) {
+        // Indices mean nothing against a stale dictionary: hold the values
+        // and retry with the next deadline until the broker has it
+        if (dictionary_dirty && !publishDictionary()) {
+            batch.opened_ms = now;
+            return;
+        }
+        len = encodeBinaryBatch(publish_class, now, (uint8_t*)payload_buffer,
+                                sizeof(payload_buffer), entries);
+        topic = &binary_batch_topics[publish_class];
+    } else {
+        // Keys point at the constant topic strings, so the document copies nothing
+        json_document.clear();
+        json_document["ts"] = now;
+        JsonObject values = json_document.createNestedObject("v");
+        uint16_t added[MAX_MANAGED_SIGNALS];
+        entries = 0;
+        for (uint16_t i = 0; i < signal_count; i++) {
+            ManagedSignal_t& signal = signals[i];
+            if (!signal.pending || signal.publish_class != publish_class) continue;
+            
+            const char* key = signal.signal.mqtt_topic;
+            if (window_summaries && signal.window.count > 1) {
+                const SignalWindow_t& window = signal.window;
+                JsonObject summary = values.createNestedObject(key);
+                summary["last"] = round(window.last * 100.0) / 100.0;
+                summary["min"] = round(window.min * 100.0) / 100.0;
+                summary["max"] = round(window.max * 100.0) / 100.0;
+                summary["mean"] = round(windowMean(window) * 100.0) / 100.0;
+                summary["n"] = window.count;
+            } else {
+                values[key] = round(signal.pending_value * 100.0) / 100.0;
+            }
+            // Like the binary path: what does not fit stays pending
+            if (json_document.overflowed()) {
+                values.remove(key);
+                break;
+            }
+            added[entries++] = i;
+        }
+        while (entries > 0 && measureJson(json_document) >= sizeof(payload_buffer)) {
+            values.remove(signals[added[--entries]].signal.mqtt_topic);
+        }
+        for (uint16_t e = 0; e < entries; e++) {
+            windowReset(signals[added[e]].window);
+            signals[added[e]].pending = false;
+        }
+        len = entries > 0 ? serializeJson(json_document, payload_buffer, sizeof(payload_buffer)) : 0;
+        topic = &batch_topics[publish_class];
+    }
+    
+    // Each batch holds a different set of values: BULK, which never coalesces
+    if (len > 0 && topic->str &&
+        mqtt_handler->publish(topic->str, (const uint8_t*)payload_buffer, len, false,
+                              MQTT_CLASS_BULK)) {
+        batches_published++;
+    } else {
+        batch_dropped += entries;
+    }
+    
+    // Values that did not fit the payload stay pending for a follow-up message
+    batch.pending -= entries;
+    if (batch.pending > 0) {
+        if (entries == 0) {
+            DEBUG_PRINTLN("[DataMgr] Batch entry does not fit the payload buffer");
+            return;
+        }
+        flushBatch(publish_class, now);
+    }
+}
+
+void DataManager::setBinaryBatches(bool enabled) {
+    flushBatches();
+    binary_batches = enabled;
+    dictionary_dirty = true;
+    DEBUG_PRINTF("[DataMgr] Batch encoding: %s\n", enabled ? "MessagePack" : "JSON");
+}
+
+// Raw CAN units: the decoded value is raw * factor + offset, so this is exact
+static int64_t toFixedPoint(const CANSignal_t& signal, double value) {
+    double factor = signal.factor != 0.0f ? signal.factor : 1.0;
+    return llround((value - signal.offset) / factor);
 }
 
-bool DataManager::shouldPublish(ManagedSignal_t& signal, double new_value) {
-    uint32_t now = millis();
+size_t DataManager::encodeBinaryBatch(uint8_t publish_class, uint32_t now,
+                                      uint8_t* out, size_t size, uint16_t& entries) {
+    // [version, dictionary epoch, ts, {index: raw | [last, min, max, mean, n]}]
+    MsgPackWriter writer(out, size);
+    writer.writeArrayHeader(4);
+    writer.writeUint(BINARY_BATCH_VERSION);
+    writer.writeUint(dictionary_epoch);
+    writer.writeUint(now);
+    size_t map_pos = writer.beginMap16();
     
-    if ((now - signal.last_published) >= signal.publish_interval) {
-        double change = fabs(new_value - signal.last_value);
-        if (change >= signal.value_tolerance) {
-            signal.last_value = new_value;
-            signal.last_published = now;
-            return true;
+    // Stop before an entry could overflow; the rest stays pending
+    const uint16_t entry_bytes = window_summaries ? BINARY_SUMMARY_BYTES : BINARY_VALUE_BYTES;
+    entries = 0;
+    for (uint16_t i = 0; i < signal_count; i++) {
+        ManagedSignal_t& signal = signals[i];
+        if (!signal.pending || signal.publish_class != publish_class) continue;
+        if (writer.length() + entry_bytes > size) break;
+        
+        writer.writeUint(i);
+        if (window_summaries && signal.window.count > 1) {
+            const SignalWindow_t& window = signal.window;
+            writer.writeArrayHeader(5);
+            writer.writeInt(toFixedPoint(signal.signal, window.last));
+            writer.writeInt(toFixedPoint(signal.signal, window.min));
+            writer.writeInt(toFixedPoint(signal.signal, window.max));
+            writer.writeInt(toFixedPoint(signal.signal, windowMean(window)));
+            writer.writeUint(window.count);
+        } else {
+            writer.writeInt(toFixedPoint(signal.signal, signal.pending_value));
+        }
+        windowReset(signal.window);
+        signal.pending = false;
+        entries++;
+    }
+    writer.endMap16(map_pos, entries);
+    
+    if (writer.overflowed()) {
+        DEBUG_PRINTF("[DataMgr] Binary batch over %u bytes, dropped\n", (unsigned)size);
+        return 0;  // Counted as dropped by flushBatch()
+    }
+    return writer.length();
+}
+
+uint16_t DataManager::computeDictionaryEpoch() const {
+    // FNV-1a over everything a decoder depends on, folded to 16 bits
+    uint32_t hash = 2166136261UL;
+    auto mix = [&hash](const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ bytes[i]) * 16777619UL;
         }
+    };
+    mix(topics.getBase(), strlen(topics.getBase()) + 1);
+    for (uint16_t i = 0; i < signal_count; i++) {
+        const CANSignal_t& signal = signals[i].signal;
+        mix(signal.mqtt_topic, strlen(signal.mqtt_topic) + 1);
+        mix(&signal.factor, sizeof(signal.factor));
+        mix(&signal.offset, sizeof(signal.offset));
     }
-    return false;
+    return (uint16_t)((hash >> 16) ^ hash);
+}
+
+bool DataManager::publishDictionary() {
+    if (!dictionary_topic.str) return false;
+    dictionary_epoch = computeDictionaryEpoch();
+    
+    // {"epoch":E,"base":"..","signals":[[suffix, factor, offset, unit], ...]}
+    // Position in "signals" is the index used by the binary batches
+    const size_t size = sizeof(payload_buffer);
+    int len = snprintf(payload_buffer, size, "{\"epoch\":%u,\"base\":\"%s\",\"signals\":[",
+                       dictionary_epoch, topics.getBase());
+    for (uint16_t i = 0; i < signal_count && len > 0 && (size_t)len < size; i++) {
+        const CANSignal_t& signal = signals[i].signal;
+        len += snprintf(payload_buffer + len, size - len, "%s[\"%s\",%.7g,%.7g,\"%s\"]",
+                        i > 0 ? "," : "", signal.mqtt_topic, (double)signal.factor,
+                        (double)signal.offset, signal.unit ? signal.unit : "");
+    }
+    if (len > 0 && (size_t)len < size) {
+        len += snprintf(payload_buffer + len, size - len, "]}");
+    }
+    if (len <= 0 || (size_t)len >= size) {
+        DEBUG_PRINTLN("[DataMgr] Signal dictionary does not fit the payload buffer");
+        return false;
+    }
+    
+    if (!mqtt_handler->publish(dictionary_topic.str, payload_buffer, len, true, MQTT_CLASS_STATE)) {
+        return false;
+    }
+    dictionary_dirty = false;
+    DEBUG_PRINTF("[DataMgr] Published signal dictionary, epoch %u (%u signals, %d bytes)\n",
+                dictionary_epoch, signal_count, len);
+    return true;
+}
+
+void DataManager::setHistory(bool enabled) {
+    if (history_enabled && !enabled) {
+        flushHistory();
+    }
+    history_enabled = enabled;
+    history_flushed_ms = clock_ms;
+    DEBUG_PRINTF("[DataMgr] Signal history %s (%u byte blocks)\n",
+                enabled ? "enabled" : "disabled", GORILLA_BLOCK_BYTES);
+}
+
+void DataManager::clearHistory() {
+    for (uint16_t i = 0; i < MAX_MANAGED_SIGNALS; i++) {
+        history[i].clear();
+    }
+}
+
+void DataManager::recordHistory(uint16_t index, uint32_t now, double value) {
+    // Raw CAN units and coarse ticks keep the XORs and deltas short
+    GorillaBlock& block = history[index];
+    uint32_t tick = now / HISTORY_TICK_MS;
+    double raw = (double)toFixedPoint(signals[index].signal, value);
+    if (block.append(tick, raw)) return;
+    
+    // Full: send it and start a new block; keep it (and drop the point) if offline
+    if (publishHistory(index) && block.append(tick, raw)) return;
+    history_dropped++;
+}
+
+void DataManager::flushHistory() {
+    for (uint16_t i = 0; i < signal_count; i++) {
+        if (!history[i].isEmpty()) {
+            publishHistory(i);
+        }
+    }
+}
+
+static inline void putU32BE(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
 }
 
-void DataManager::publishSignal(const ManagedSignal_t& signal, double value) {
-    char topic_buffer[128];
-    snprintf(topic_buffer, sizeof(topic_buffer), "%s/%s", MQTT_BASE_TOPIC, signal.signal.mqtt_topic);
-    mqtt_handler->publish(topic_buffer, value, 2, true);
+void DataManager::setWallClock(uint32_t unix_s) {
+    // Frame timestamps share the millis() time base
+    wall_anchor_ms = millis();
+    wall_anchor_unix = unix_s;
+    DEBUG_PRINTF("[DataMgr] Wall clock %lu s at %lu ms (boot %08lx)\n",
+                 (unsigned long)unix_s, (unsigned long)wall_anchor_ms, (unsigned long)boot_id);
+}
+
+bool DataManager::publishHistory(uint16_t index) {
+    if (!history_topic.str) return false;
+    if (dictionary_dirty) {
+        publishDictionary();  // Indexes in the header refer to it
+    }
+    
+    // version, signal index, dictionary epoch, point count, tick ms, boot id,
+    // anchor frame ms, anchor unix s (BE), bitstream
+    GorillaBlock& block = history[index];
+    uint8_t* out = (uint8_t*)payload_buffer;
+    out[0] = HISTORY_VERSION;
+    out[1] = (uint8_t)index;
+    out[2] = (uint8_t)(dictionary_epoch >> 8);
+    out[3] = (uint8_t)dictionary_epoch;
+    out[4] = (uint8_t)(block.getCount() >> 8);
+    out[5] = (uint8_t)block.getCount();
+    out[6] = (uint8_t)(HISTORY_TICK_MS >> 8);
+    out[7] = (uint8_t)HISTORY_TICK_MS;
+    putU32BE(out + 8, boot_id);
+    putU32BE(out + 12, wall_anchor_ms);
+    putU32BE(out + 16, wall_anchor_unix);
+    size_t len = block.getBytes();
+    memcpy(out + HISTORY_HEADER_BYTES, block.getData(), len);
+    
+    if (!mqtt_handler->publish(history_topic.str, out, HISTORY_HEADER_BYTES + len, false,
+                               MQTT_CLASS_BULK)) {
+        return false;
+    }
+    block.clear();
+    history_blocks++;
+    return true;
+}
+
+void DataManager::publishDiagnostics() {
+    uint64_t now_us = monotonicMicros();
+    CANBusMonitor& monitor1 = can_handler->getMonitor1();
+    monitor1.endWindow(now_us);
+    
+    json_document.clear();
+    json_document["uptime_s"] = millis() / 1000;
+    json_document["load_pct"] = monitor1.getBusLoadPercent();
+    json_document["rate_fps"] = monitor1.getFrameRate();
+    json_document["frames"] = monitor1.getTotalFrames();
+    json_document["untracked"] = monitor1.getUntrackedFrames();
+    json_document["ring_drops"] = can_handler->getRxDrops1();
+    json_document["ring_high_water"] = can_handler->getRxHighWater1();
+    json_document["mqtt_bytes"] = mqtt_handler->getBytesPublished();
+    
+    CANControllerHealth_t health;
+    if (can_handler->getControllerHealth1(health)) {
+        JsonObject twai = json_document.createNestedObject("twai");
+        twai["state"] = health.state;
+        twai["tec"] = health.tx_error_counter;
+        twai["rec"] = health.rx_error_counter;
+        twai["bus_errors"] = health.bus_error_count;
+        twai["rx_missed"] = health.rx_missed_count;
+        twai["rx_overrun"] = health.rx_overrun_count;
+        twai["arb_lost"] = health.arb_lost_count;
+        twai["bus_off"] = health.bus_off_events;
+        twai["recoveries"] = health.recoveries;
+    }
+    
+    if (can_handler->isConnected2()) {
+        CANBusMonitor& monitor2 = can_handler->getMonitor2();
+        monitor2.endWindow(now_us);
+        JsonObject can2 = json_document.createNestedObject("can2");
+        can2["load_pct"] = monitor2.getBusLoadPercent();
+        can2["rate_fps"] = monitor2.getFrameRate();
+        can2["frames"] = monitor2.getTotalFrames();
+        can2["overflows"] = can_handler->getRxOverflows2();
+        can2["spi_transactions"] = can_handler->getSpiTransactions2();
+    }
+
+    const MqttOutbox& outbox = mqtt_handler->getOutbox();
+    if (outbox.isActive()) {
+        JsonObject stored = json_document.createNestedObject("outbox");
+        stored["pages"] = outbox.getStoredPages();
+        stored["front"] = outbox.getFrontCount();
+        stored["queued"] = outbox.getQueued();
+        stored["replayed"] = outbox.getReplayed();
+        stored["dropped"] = outbox.getDropped();
+        stored["dropped_pages"] = outbox.getDroppedPages();
+    }
+    const MqttRing& ring = mqtt_handler->getRing();
+    if (ring.isActive()) {
+        JsonObject queue = json_document.createNestedObject("ring");
+        queue["bytes"] = ring.getUsedBytes();
+        queue["high_water"] = ring.getHighWater();
+        queue["queued"] = ring.getQueued();
+        queue["coalesced"] = ring.getCoalesced();
+        queue["spilled"] = ring.getSpilled();
+        queue["dropped"] = ring.getDropped();
+    }
+    
+    // Per-ID rate and jitter (CAN1), busiest first: all 64 tracked IDs would
+    // not fit the JSON document. The count slot is reserved up front so it
+    // can still be set once the document is full.
+    json_document["ids_omitted"] = 0;
+    JsonObject ids = json_document.createNestedObject("ids");
+    const CANIdStats_t* stats = monitor1.getIdStats();
+    bool listed[CAN_MONITOR_MAX_IDS] = {};
+    uint16_t omitted = 0;
+    for (size_t i = 0; i < CANBusMonitor::getIdCapacity(); i++) {
+        if (stats[i].used) omitted++;
+    }
+    for (uint8_t n = 0; n < CAN_DIAG_MAX_IDS && omitted > 0; n++) {
+        int busiest = -1;
+        for (size_t i = 0; i < CANBusMonitor::getIdCapacity(); i++) {
+            if (!stats[i].used || listed[i]) continue;
+            if (busiest < 0 || stats[i].rate_hz > stats[busiest].rate_hz) busiest = (int)i;
+        }
+        listed[busiest] = true;
+        
+        char key[12];
+        snprintf(key, sizeof(key), "%03X", stats[busiest].id);
+        JsonObject entry = ids.createNestedObject(key);
+        entry["hz"] = stats[busiest].rate_hz;
+        entry["jitter_ms"] = stats[busiest].jitter_us / 1000.0f;
+        if (json_document.overflowed()) {
+            ids.remove(key);
+            break;
+        }
+        omitted--;
+    }
+    json_document["ids_omitted"] = omitted;
+    
+    size_t len = serializeJson(json_document, payload_buffer, sizeof(payload_buffer));
+    if (diagnostics_topic.str) {
+        mqtt_handler->publish(diagnostics_topic.str, payload_buffer, len, false, MQTT_CLASS_BULK);
+    }
+}
+
+void DataManager::onDiagnosticResponse(void* ctx, uint8_t request,
+                                       const uint8_t* data, uint16_t len) {
+    static_cast<DataManager*>(ctx)->handleDiagnosticResponse(request, data, len);
+}
+
+void DataManager::handleDiagnosticResponse(uint8_t request, const uint8_t* data, uint16_t len) {
+    if (!cell_store.decodeResponse(data, len, millis())) {
+        DEBUG_PRINTF("[DataMgr] Unhandled diagnostic response %02X %02X (request %u, %u bytes)\n",
+                    data[0], len > 1 ? data[1] : 0, request, len);
+        return;
+    }
+    
+    // One payload per complete voltage set
+    if ((cell_store.getUpdatedParts() & BATTERY_PART_CELLS) == BATTERY_PART_CELLS) {
+        publishCellData();
+        cell_store.markPublished();
+    }
+}
+
+void DataManager::publishCellData() {
+    CellVoltageStats_t stats;
+    cell_store.computeVoltageStats(stats);
+    
+    json_document.clear();
+    json_document["ts"] = cell_store.getLastUpdate();
+    JsonObject voltage = json_document.createNestedObject("v");
+    voltage["min"] = stats.min_mv;
+    voltage["max"] = stats.max_mv;
+    voltage["mean"] = roundf(stats.mean_mv * 10.0f) / 10.0f;
+    voltage["sd"] = roundf(stats.stddev_mv * 10.0f) / 10.0f;
+    voltage["imbalance"] = stats.imbalance_mv;
+    voltage["min_cell"] = stats.min_cell;
+    voltage["max_cell"] = stats.max_cell;
+    
+    // Cells as mV above the weakest cell: small integers keep the payload short
+    JsonArray deltas = json_document.createNestedArray("dv");
+    const uint16_t* cells = cell_store.getCellVoltages();
+    for (uint8_t i = 0; i < BATTERY_CELL_COUNT; i++) {
+        deltas.add(cells[i] - stats.min_mv);
+    }
+    
+    if (cell_store.hasTemperatures()) {
+        ModuleTempStats_t temps;
+        cell_store.computeTempStats(temps);
+        JsonObject temp = json_document.createNestedObject("t");
+        temp["min"] = temps.min_c;
+        temp["max"] = temps.max_c;
+        temp["mean"] = roundf(temps.mean_c * 10.0f) / 10.0f;
+        JsonArray modules = temp.createNestedArray("modules");
+        const int8_t* module_temps = cell_store.getModuleTemps();
+        for (uint8_t i = 0; i < BATTERY_MODULE_COUNT; i++) {
+            modules.add(module_temps[i]);
+        }
+    }
+    
+    size_t len = serializeJson(json_document, payload_buffer, sizeof(payload_buffer));
+    if (cells_topic.str &&
+        mqtt_handler->publish(cells_topic.str, payload_buffer, len, true, MQTT_CLASS_STATE)) {
+        published_messages++;
+    }
+}
+
+static const char* const TRIP_END_REASONS[] = {"none", "idle", "bus_silent", "plug", "forced"};
+
+static double roundTo(double value, double scale) {
+    return round(value * scale) / scale;
+}
+
+void DataManager::publishPendingTrip() {
+    if (!trip_pending) return;
+    trip_pending = false;
+    publishTripSummary(trip_ended);
+}
+
+void DataManager::publishTripSummary(const TripSummary_t& summary) {
+    uint32_t duration_s = (summary.end_ms - summary.start_ms) / 1000;
+    
+    json_document.clear();
+    json_document["id"] = summary.id;
+    json_document["start_s"] = summary.start_ms / 1000;  // Uptime
+    json_document["duration_s"] = duration_s;
+    json_document["distance_km"] = roundTo(summary.distance_km, 100);
+    json_document["energy_kwh"] = roundTo(summary.energy_kwh, 1000);
+    json_document["regen_kwh"] = roundTo(summary.regen_kwh, 1000);
+    json_document["consumption"] = roundTo((summary.energy_kwh - summary.regen_kwh) /
+                                           summary.distance_km * 100.0, 100);
+    json_document["speed_max"] = roundTo(summary.speed_max, 10);
+    if (duration_s > 0) {
+        json_document["speed_avg"] = roundTo(summary.distance_km * 3600.0 / duration_s, 10);
+    }
+    if (summary.has_soc) {
+        JsonObject soc = json_document.createNestedObject("soc");
+        soc["start"] = summary.soc_start;
+        soc["end"] = summary.soc_end;
+        soc["min"] = summary.soc_min;
+        soc["max"] = summary.soc_max;
+    }
+    if (summary.has_start_gps) {
+        JsonArray start = json_document.createNestedArray("start");
+        start.add(roundTo(summary.start_lat, 1000000));
+        start.add(roundTo(summary.start_lon, 1000000));
+    }
+    if (summary.has_end_gps) {
+        JsonArray end = json_document.createNestedArray("end");
+        end.add(roundTo(summary.end_lat, 1000000));
+        end.add(roundTo(summary.end_lon, 1000000));
+    }
+    json_document["end_reason"] = TRIP_END_REASONS[summary.reason];
+    
+    size_t len = serializeJson(json_document, payload_buffer, sizeof(payload_buffer));
+    if (trip_topic.str &&
+        mqtt_handler->publish(trip_topic.str, payload_buffer, len, false, MQTT_CLASS_BULK)) {
+        published_messages++;
+    }
+    DEBUG_PRINTF("[Trip] Trip %lu: %.2f km in %lu s, %.3f kWh\n",
+                summary.id, summary.distance_km, duration_s, summary.energy_kwh);
+}
+
+static const char* const CHARGE_END_REASONS[] = {"none", "unplugged", "complete", "bus_silent",
+                                                  "forced"};
+
+void DataManager::publishChargeLive() {
+    const ChargeSession_t& session = charge.getSession();
+    
+    json_document.clear();
+    json_document["id"] = session.id;
+    json_document["duration_s"] = (session.end_ms - session.start_ms) / 1000;
+    json_document["energy_kwh"] = roundTo(session.energy_kwh, 1000);
+    json_document["power_kw"] = roundTo(session.power_kw, 10);
+    json_document["power_max"] = roundTo(session.power_max, 10);
+    if (session.has_soc) {
+        json_document["soc"] = session.soc_end;
+    }
+    
+    size_t len = serializeJson(json_document, payload_buffer, sizeof(payload_buffer));
+    if (charge_live_topic.str &&
+        mqtt_handler->publish(charge_live_topic.str, payload_buffer, len, true, MQTT_CLASS_STATE)) {
+        published_messages++;
+    }
+}
+
+void DataManager::publishChargeSummary() {
+    const ChargeSession_t& session = charge.getSession();
+    uint32_t duration_s = (session.end_ms - session.start_ms) / 1000;
+    
+    json_document.clear();
+    json_document["id"] = session.id;
+    json_document["start_s"] = session.start_ms / 1000;  // Uptime
+    json_document["duration_s"] = duration_s;
+    json_document["energy_kwh"] = roundTo(session.energy_kwh, 1000);
+    json_document["battery_kwh"] = roundTo(session.battery_kwh, 1000);
+    json_document["power_max"] = roundTo(session.power_max, 10);
+    json_document["power_avg"] = roundTo(charge.getAveragePower(), 10);
+    if (session.has_soc) {
+        JsonObject soc = json_document.createNestedObject("soc");
+        soc["start"] = session.soc_start;
+        soc["end"] = session.soc_end;
+    }
+    JsonObject curve = json_document.createNestedObject("curve");
+    curve["step_s"] = session.curve_step_ms / 1000;
+    JsonArray points = curve.createNestedArray("kw");
+    for (uint8_t i = 0; i < session.curve_points; i++) {
+        points.add(roundTo(session.curve[i], 10));
+    }
+    json_document["end_reason"] = CHARGE_END_REASONS[session.reason];
+    
+    size_t len = serializeJson(json_document, payload_buffer, sizeof(payload_buffer));
+    if (charge_topic.str &&
+        mqtt_handler->publish(charge_topic.str, payload_buffer, len, false, MQTT_CLASS_BULK)) {
+        published_messages++;
+    }
+    DEBUG_PRINTF("[Charge] Session %lu: %.3f kWh in %lu s, peak %.1f kW\n",
+                session.id, session.energy_kwh, duration_s, session.power_max);
 }
 
 void DataManager::publishAllData() {
@@ -127,6 +1278,7 @@ void DataManager::publishAllData() {
 }
 
 void DataManager::printStatus() {
-    DEBUG_PRINTF("[DataMgr] Processed: %lu, Published: %lu, Registered signals: %zu\n",
-                processed_messages, published_messages, signal_map.size());
+    DEBUG_PRINTF("[DataMgr] Processed: %lu, Published: %lu (%lu heartbeats), Suppressed: %lu, Registered signals: %u (%u CAN IDs)\n",
+                processed_messages, published_messages, heartbeat_reports, suppressed_reports,
+                signal_count, frame_count);
 }
@@ -2,13 +2,24 @@
 #define DATA_MANAGER_H
 
 #include <Arduino.h>
-#include <map>
 #include <ArduinoJson.h>
 #include "config.h"
 #include "can_messages.h"
 #include "can_handler.h"
+#include "decode_plan.h"
+#include "can_dispatch.h"
 #include "mqtt_handler.h"
 #include "modem_handler.h"
+#include "uds_scheduler.h"
+#include "battery_cells.h"
+#include "report_policy.h"
+#include "signal_window.h"
+#include "timer_wheel.h"
+#include "topic_arena.h"
+#include "gorilla_block.h"
+#include "derived_signals.h"
+#include "trip_tracker.h"
+#include "charge_session.h"
 
 // Vehicle telemetry data structure
 // Used for both real CAN data and simulated data
@@ -43,16 +54,61 @@ typedef struct {
     bool doors_locked;                  // Are doors locked
 } VehicleData;
 
+// Signals are coalesced into one batch message per interval class
+typedef enum {
+    PUBLISH_CLASS_FAST = 0,
+    PUBLISH_CLASS_MID,
+    PUBLISH_CLASS_SLOW,
+    PUBLISH_CLASS_COUNT
+} PublishClass_t;
+
+typedef struct {
+    uint16_t pending;       // Signals waiting in this batch
+    uint16_t bytes;         // Estimated payload size
+    uint32_t opened_ms;     // Frame time of the first pending value
+} PublishBatch_t;
+
 typedef struct {
     const char* name;
     uint32_t can_id;
     CANSignal_t signal;  // Removed const to allow initialization
-    uint32_t publish_interval;  // ms
-    uint32_t last_published;
-    double last_value;
-    double value_tolerance;  // Skip publish if change < tolerance
+    Topic_t topic;       // Full MQTT topic, interned at registration
+    ReportPolicy_t policy;
+    ReportState_t report;
+    SignalWindow_t window;  // Values decoded since the last publish
+    uint8_t publish_class;  // PublishClass_t
+    bool pending;           // Waiting in its class batch
+    double pending_value;
+    
+    // Publish scheduling: decode only stores the value and, for a change,
+    // arms the timer for the earliest time the policy allows a publish
+    TimerNode_t timer;
+    double latest_value;
+    bool has_value;
+    bool change_armed;      // Timer is set for a change, not a heartbeat
+    
+    uint8_t derived_input;  // DerivedInput_t this signal feeds, or DERIVED_INPUT_NONE
 } ManagedSignal_t;
 
+// One CAN ID: its signals are the contiguous range
+// signals[first_signal .. first_signal + signal_count), in decode plan order
+typedef struct {
+    uint32_t can_id;
+    uint16_t first_signal;
+    uint8_t signal_count;
+    bool diagnostic;     // ISO-TP response ID, routed to the UDS scheduler
+    DecodePlan plan;
+} FrameDecoder_t;
+
+// Non-blocking CAN1 frame output for the ISO-TP links
+class CAN1FrameSender : public IsoTpSender {
+public:
+    explicit CAN1FrameSender(CANHandler* can) : can_handler(can) {}
+    bool sendFrame(uint32_t id, const uint8_t* data, uint8_t len) override;
+private:
+    CANHandler* can_handler;
+};
+
 class DataManager {
 public:
     DataManager(CANHandler* can, MQTTHandler* mqtt, ModemHandler* modem);
@@ -64,11 +120,60 @@ public:
     
     // Signal management
     void registerSignal(const char* signal_name, uint32_t can_id, const CANSignal_t& signal,
-                        uint32_t publish_interval, double tolerance = 0.0);
+                        const ReportPolicy_t& policy);
     void registerAllZoeSignals();  // Pre-configured Zoe signals
+    // A derived value (power, energy, ...) published like a decoded signal
+    void registerDerivedSignal(DerivedOutput_t output, const CANSignal_t& signal,
+                               const ReportPolicy_t& policy);
+    void registerDiagnostics();    // ISO-TP requests polled by the UDS scheduler
+    size_t getRegisteredIds(uint32_t* ids, size_t max_ids) const;
+    void resetSignalState();  // Forget last published values and times
+    void setBaseTopic(const char* base);  // Re-resolves every topic
+    
+    // Publish min/max/mean/last/count of the window instead of the last sample
+    void setWindowSummaries(bool enabled) { window_summaries = enabled; }
+    
+    // Coalesce due signals into one message per interval class; critical
+    // signals are always published on their own topic straight away
+    void configureBatching(bool enabled, uint16_t max_bytes, uint32_t deadline_ms,
+                           uint32_t fast_interval, uint32_t mid_interval);
+    void flushBatches();
+    
+    // Batches as MessagePack with fixed-point values, keyed by the signal
+    // index of a retained dictionary (see docs/MQTT_TOPICS.md)
+    void setBinaryBatches(bool enabled);
+    
+    // Record every reported value in a per-signal Gorilla block, published
+    // on "history" when full and every HISTORY_FLUSH_INTERVAL
+    void setHistory(bool enabled);
+    void flushHistory();
+    
+    // Absolute time for history blocks. The boot id (random per boot) tells
+    // boots apart; the wall clock pairs unix_s with the current frame time,
+    // so a decoder can turn block timestamps into dates. Until it is set,
+    // blocks carry a zero anchor and only relative times.
+    void setBootId(uint32_t id) { boot_id = id; }
+    void setWallClock(uint32_t unix_s);
+    bool hasWallClock() const { return wall_anchor_unix != 0; }
+    
+    // Trips are detected from speed, plug and bus activity; a summary is
+    // published on "trip/summary" when one ends. Once GPS fixes arrive, the
+    // summary waits for the first fix after the end (its end point), or
+    // TRIP_END_FIX_TIMEOUT_MS; wantsPosition() asks for that fix early.
+    void setPosition(float latitude, float longitude);  // Latest GPS fix
+    bool wantsPosition() const { return trip_pending; }
+    void endTrip();
+    const TripTracker& getTripTracker() const { return trip; }
+    
+    // Charge sessions are detected from plug and charger power; a live
+    // summary goes to "charge/live" every CHARGE_LIVE_INTERVAL and a record
+    // with the power curve to "charge/summary" when one ends
+    void endChargeSession();
+    const ChargeSessionTracker& getChargeTracker() const { return charge; }
     
     // Process CAN messages
     void processCAN1Message(const CANMessage_t& msg);
+    void processCAN1Batch(const CANMessage_t* msgs, size_t count);
     void processCAN2Message(const CANMessage_t& msg);
     
     // Force publish all data
@@ -77,6 +182,12 @@ public:
     // Statistics
     uint32_t getProcessedMessageCount() const { return processed_messages; }
     uint32_t getPublishedMessageCount() const { return published_messages; }
+    uint32_t getSuppressedCount() const { return suppressed_reports; }
+    uint32_t getHeartbeatCount() const { return heartbeat_reports; }
+    uint32_t getBatchCount() const { return batches_published; }
+    uint32_t getBatchDropCount() const { return batch_dropped; }
+    uint32_t getHistoryBlockCount() const { return history_blocks; }
+    uint32_t getHistoryDropCount() const { return history_dropped; }
     
     // Status
     void printStatus();
@@ -86,19 +197,121 @@ protected:
     MQTTHandler* mqtt_handler;
     ModemHandler* modem_handler;
     
-    std::map<uint32_t, std::vector<ManagedSignal_t>> signal_map;  // CAN ID -> Signals
+    // Flat signal state, indexed through the CAN ID dispatch table
+    CANDispatchTable dispatch_table;
+    FrameDecoder_t frames[CAN_DISPATCH_MAX_FRAMES];
+    ManagedSignal_t signals[MAX_MANAGED_SIGNALS];
+    uint8_t frame_count;
+    uint16_t signal_count;
+    bool filters_dirty;  // Signal set changed since the CAN filter was applied
+    bool window_summaries;
+    
+    // Batch publishing
+    bool batching;
+    uint16_t batch_max_bytes;
+    uint32_t batch_deadline_ms;
+    uint32_t class_fast_interval;
+    uint32_t class_mid_interval;
+    PublishBatch_t batches[PUBLISH_CLASS_COUNT];
+    uint32_t batches_published;
+    uint32_t batch_dropped;        // Values lost with a batch that could not be sent
+    bool binary_batches;
+    bool dictionary_dirty;         // Signal set or topics changed since it was published
+    uint16_t dictionary_epoch;
+    
+    // Interned topics (signal topics live in ManagedSignal_t)
+    TopicArena topics;
+    Topic_t batch_topics[PUBLISH_CLASS_COUNT];
+    Topic_t binary_batch_topics[PUBLISH_CLASS_COUNT];
+    Topic_t dictionary_topic;
+    Topic_t history_topic;
+    Topic_t diagnostics_topic;
+    Topic_t cells_topic;
+    Topic_t trip_topic;
+    Topic_t trip_active_topic;
+    Topic_t charge_topic;
+    Topic_t charge_live_topic;
+    Topic_t charge_active_topic;
+    
+    // Compressed history, indexed like signals[]
+    bool history_enabled;
+    GorillaBlock history[MAX_MANAGED_SIGNALS];
+    uint32_t history_flushed_ms;   // Frame time of the last periodic flush
+    uint32_t history_blocks;
+    uint32_t history_dropped;      // Points lost while a full block could not be sent
+    uint32_t boot_id;
+    uint32_t wall_anchor_ms;       // Frame time at which...
+    uint32_t wall_anchor_unix;     // ...the unix time was this (0 = unknown)
+    
+    // Derived signals; derived_signals[] holds their index in signals[]
+    DerivedSignalGraph derived;
+    uint16_t derived_signals[DERIVED_COUNT];
+    TripTracker trip;
+    TripSummary_t trip_ended;      // Ended trip waiting for its end fix
+    bool trip_pending;
+    uint32_t trip_pending_ms;      // millis() when it ended
+    bool has_position;             // GPS fixes arrive (none in a replay)
+    ChargeSessionTracker charge;
+    uint32_t charge_live_ms;       // Frame time of the last live summary
+    
+    // Publish timers, run on frame time (wall time while the bus is quiet)
+    TimerWheel publish_wheel;
+    uint32_t clock_ms;             // Timestamp of the latest frame
+    uint32_t clock_wall_ms;        // millis() when it was processed
+    bool clock_valid;
     
     uint32_t processed_messages;
     uint32_t published_messages;
+    uint32_t suppressed_reports;   // Values held back by the report policy
+    uint32_t heartbeat_reports;    // Unchanged values re-sent after max silence
+    uint32_t last_diagnostics;
+    
+    // Diagnostic polling
+    CAN1FrameSender diag_sender;
+    UdsScheduler uds_scheduler;
+    BatteryCellStore cell_store;
     
     // JSON document for batching
     StaticJsonDocument<4096> json_document;
     
 private:
     // Helper methods
-    bool shouldPublish(ManagedSignal_t& signal, double new_value);
-    void publishSignal(const ManagedSignal_t& signal, double value);
+    ManagedSignal_t makeSignal(const char* signal_name, uint32_t can_id,
+                               const CANSignal_t& signal, const ReportPolicy_t& policy);
+    void updateDerived(uint32_t now);
+    void handleTripChange(bool was_active);
+    void publishTripSummary(const TripSummary_t& summary);
+    void publishPendingTrip();
+    void handleChargeChange(bool was_active, uint32_t now);
+    void publishChargeLive();
+    void publishChargeSummary();
+    bool shouldPublish(ManagedSignal_t& signal, double new_value, uint32_t now);
+    void updateSignal(ManagedSignal_t& signal, double value, uint32_t now);
+    void emitSignal(ManagedSignal_t& signal, double value, uint32_t now);
+    void armHeartbeat(ManagedSignal_t& signal);
+    void advanceClock(uint32_t now);
+    void resetTimers();
+    static void onSignalTimer(void* ctx, TimerNode_t* node, uint32_t now);
+    void publishSignal(ManagedSignal_t& signal, double value);
+    void internTopics();
+    uint8_t classify(const ManagedSignal_t& signal) const;
+    void enqueueSignal(ManagedSignal_t& signal, double value, uint32_t now);
+    void flushDueBatches(uint32_t now);
+    void flushBatch(uint8_t publish_class, uint32_t now);
+    size_t encodeBinaryBatch(uint8_t publish_class, uint32_t now, uint8_t* out, size_t size,
+                             uint16_t& entries);
+    bool publishDictionary();
+    uint16_t computeDictionaryEpoch() const;
+    void recordHistory(uint16_t index, uint32_t now, double value);
+    bool publishHistory(uint16_t index);
+    void clearHistory();
     void publishSignalWithUnit(const char* mqtt_topic, double value, const char* unit);
+    void applyHardwareFilters();
+    void publishDiagnostics();
+    bool registerDiagnosticId(uint32_t rx_id);
+    static void onDiagnosticResponse(void* ctx, uint8_t request, const uint8_t* data, uint16_t len);
+    void handleDiagnosticResponse(uint8_t request, const uint8_t* data, uint16_t len);
+    void publishCellData();
 };
 
 #endif // DATA_MANAGER_H
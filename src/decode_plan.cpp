@@ -0,0 +1,31 @@
+#include "decode_plan.h"
+
+DecodePlan::DecodePlan() : step_count(0) {}
+
+bool DecodePlan::addSignal(const CANSignal_t& signal) {
+    if (step_count >= DECODE_PLAN_MAX_SIGNALS) return false;
+    if (signal.bit_length == 0 || signal.start_bit + signal.bit_length > 64) return false;
+    
+    DecodeStep_t& step = steps[step_count++];
+    step.mask = SignalCodec::bitMask(signal.bit_length);
+    step.sign_bit = (signal.is_signed && signal.bit_length < 64)
+        ? (1ULL << (signal.bit_length - 1)) : 0;
+    step.shift = signal.start_bit;
+    step.factor = signal.factor;
+    step.offset = signal.offset;
+    return true;
+}
+
+uint8_t DecodePlan::decode(const uint8_t* data, uint8_t dlc, double* out) const {
+    // Single payload load shared by every signal of this frame
+    const uint64_t payload = SignalCodec::loadPayload(data, dlc);
+    
+    for (uint8_t i = 0; i < step_count; i++) {
+        const DecodeStep_t& step = steps[i];
+        uint64_t raw = (payload >> step.shift) & step.mask;
+        // Branch-free sign extension (sign_bit = 0 leaves unsigned values untouched)
+        int64_t value = (int64_t)((raw ^ step.sign_bit) - step.sign_bit);
+        out[i] = (double)value * step.factor + step.offset;
+    }
+    return step_count;
+}
@@ -0,0 +1,40 @@
+#ifndef DECODE_PLAN_H
+#define DECODE_PLAN_H
+
+#include <stdint.h>
+#include "can_messages.h"
+#include "signal_extractor.h"
+
+#define DECODE_PLAN_MAX_SIGNALS 8       // Signals decoded from a single CAN ID
+
+// One precomputed extraction step (shift, mask, sign and scaling)
+typedef struct {
+    uint64_t mask;         // Mask applied after the shift
+    uint64_t sign_bit;     // Sign bit of the raw value (0 = unsigned)
+    uint8_t shift;         // Start bit of the signal
+    float factor;          // Scaling factor
+    float offset;          // Offset value
+} DecodeStep_t;
+
+// Decode plan for a single CAN ID: the payload is loaded once as a 64-bit
+// word and every registered signal is emitted into a contiguous array,
+// in registration order.
+class DecodePlan {
+public:
+    DecodePlan();
+    
+    // Plan construction (at registration time)
+    bool addSignal(const CANSignal_t& signal);
+    void clear() { step_count = 0; }
+    
+    // Decode all signals; returns number of values written to out
+    uint8_t decode(const uint8_t* data, uint8_t dlc, double* out) const;
+    
+    uint8_t size() const { return step_count; }
+    
+private:
+    DecodeStep_t steps[DECODE_PLAN_MAX_SIGNALS];
+    uint8_t step_count;
+};
+
+#endif // DECODE_PLAN_H
@@ -0,0 +1,128 @@
+#include "derived_signals.h"
+#include <string.h>
+
+#define IN(x) (1 << DERIVED_IN_##x)
+#define NODE(x) (1 << DERIVED_##x)
+
+// What each node is recomputed from
+typedef struct {
+    uint8_t inputs;
+    uint16_t nodes;
+} DerivedNode_t;
+
+static const DerivedNode_t GRAPH[DERIVED_COUNT] = {
+    {IN(VOLTAGE) | IN(CURRENT), 0},                            // POWER
+    {0, NODE(POWER)},                                          // ENERGY_OUT
+    {0, NODE(POWER)},                                          // ENERGY_IN
+    {IN(SPEED), NODE(POWER)},                                  // REGEN
+    {IN(SPEED), 0},                                            // DISTANCE
+    {IN(CHARGE_POWER), 0},                                     // ENERGY_CHARGED
+    {0, NODE(ENERGY_OUT) | NODE(REGEN)},                       // REGEN_SHARE
+    {0, NODE(ENERGY_OUT) | NODE(REGEN) | NODE(DISTANCE)},      // CONSUMPTION
+};
+
+static const struct {
+    const char* signal;
+    DerivedInput_t input;
+} INPUT_BINDINGS[] = {
+    {"BatteryVolt", DERIVED_IN_VOLTAGE},
+    {"BatteryCurrent", DERIVED_IN_CURRENT},
+    {"Speed", DERIVED_IN_SPEED},
+    {"SoC", DERIVED_IN_SOC},
+    {"PlugConnected", DERIVED_IN_PLUG},
+    {"ChargePower", DERIVED_IN_CHARGE_POWER},
+};
+
+DerivedInput_t derivedInputFor(const char* signal_name) {
+    for (size_t i = 0; i < sizeof(INPUT_BINDINGS) / sizeof(INPUT_BINDINGS[0]); i++) {
+        if (strcmp(INPUT_BINDINGS[i].signal, signal_name) == 0) return INPUT_BINDINGS[i].input;
+    }
+    return DERIVED_INPUT_NONE;
+}
+
+DerivedSignalGraph::DerivedSignalGraph() {
+    reset();
+}
+
+void DerivedSignalGraph::reset() {
+    memset(inputs, 0, sizeof(inputs));
+    memset(values, 0, sizeof(values));
+    memset(integrators, 0, sizeof(integrators));
+    known_inputs = 0;
+    dirty_inputs = 0;
+    valid = 0;
+}
+
+void DerivedSignalGraph::setInput(DerivedInput_t input, double value) {
+    inputs[input] = value;
+    known_inputs |= 1 << input;
+    dirty_inputs |= 1 << input;
+}
+
+uint16_t DerivedSignalGraph::update(uint32_t now_ms) {
+    uint16_t updated = 0;
+    for (uint8_t k = 0; k < DERIVED_COUNT; k++) {
+        const DerivedNode_t& node = GRAPH[k];
+        if ((node.inputs & dirty_inputs) == 0 && (node.nodes & updated) == 0) continue;
+        if (evaluate((DerivedOutput_t)k, now_ms)) {
+            updated |= 1 << k;
+        }
+    }
+    dirty_inputs = 0;
+    return updated;
+}
+
+bool DerivedSignalGraph::evaluate(DerivedOutput_t output, uint32_t now_ms) {
+    double power = values[DERIVED_POWER];
+    switch (output) {
+        case DERIVED_POWER:
+            if (!hasInputs(IN(VOLTAGE) | IN(CURRENT))) return false;
+            values[output] = inputs[DERIVED_IN_VOLTAGE] * inputs[DERIVED_IN_CURRENT] / 1000.0;
+            break;
+        case DERIVED_ENERGY_OUT:
+            return integrate(output, power > 0 ? power : 0, now_ms);
+        case DERIVED_ENERGY_IN:
+            return integrate(output, power < 0 ? -power : 0, now_ms);
+        case DERIVED_REGEN:
+            if (!isValid(DERIVED_POWER) || !hasInputs(IN(SPEED))) return false;
+            return integrate(output, (power < 0 && inputs[DERIVED_IN_SPEED] >= DERIVED_MOVING_KMH) ?
+                                     -power : 0, now_ms);
+        case DERIVED_DISTANCE:
+            return integrate(output, inputs[DERIVED_IN_SPEED], now_ms);
+        case DERIVED_ENERGY_CHARGED:
+            return integrate(output, inputs[DERIVED_IN_CHARGE_POWER], now_ms);
+        case DERIVED_REGEN_SHARE:
+            if (!isValid(DERIVED_REGEN) || values[DERIVED_ENERGY_OUT] <= 0) return false;
+            values[output] = values[DERIVED_REGEN] / values[DERIVED_ENERGY_OUT] * 100.0;
+            break;
+        case DERIVED_CONSUMPTION:
+            if (!isValid(DERIVED_REGEN) || values[DERIVED_DISTANCE] < DERIVED_MIN_DISTANCE_KM) {
+                return false;
+            }
+            values[output] = (values[DERIVED_ENERGY_OUT] - values[DERIVED_REGEN]) /
+                             values[DERIVED_DISTANCE] * 100.0;
+            break;
+        default:
+            return false;
+    }
+    valid |= 1 << output;
+    return true;
+}
+
+bool DerivedSignalGraph::integrate(DerivedOutput_t output, double rate_per_hour, uint32_t now_ms) {
+    Integrator_t& integrator = integrators[output];
+    if (integrator.started) {
+        // Wrapped or too long: restart the integral at this sample
+        uint32_t elapsed = now_ms - integrator.last_ms;
+        if (elapsed <= DERIVED_MAX_GAP_MS) {
+            integrator.total += (integrator.last_rate + rate_per_hour) * 0.5 * elapsed / 3600000.0;
+        }
+    }
+    integrator.last_rate = rate_per_hour;
+    integrator.last_ms = now_ms;
+    integrator.started = true;
+
+    values[output] = integrator.total;
+    valid |= 1 << output;
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef DERIVED_SIGNALS_H
+#define DERIVED_SIGNALS_H
+
+#include <stdint.h>
+#include "can_messages.h"
+
+// ============================================================================
+// DERIVED SIGNALS
+// Values computed on the device from decoded CAN signals: battery power,
+// energy counters, regen share and consumption. The nodes form a small
+// dependency graph; setInput() only marks what changed and update()
+// re-evaluates the nodes that depend on it, in topological order.
+//
+// Energy and distance are integrated with the trapezoidal rule on the
+// frame timestamps. An interval longer than DERIVED_MAX_GAP_MS (car asleep,
+// frames lost) is not integrated: the integrator restarts at the next
+// sample. Counters run from begin()/reset() and only ever grow; consumers
+// take differences.
+//
+// Sign convention as published: battery current and power are positive
+// while discharging.
+// ============================================================================
+
+#define DERIVED_MAX_GAP_MS 2000         // Longest interval integrated
+#define DERIVED_MOVING_KMH 1.0          // Above this, energy into the battery is regen
+#define DERIVED_MIN_DISTANCE_KM 1.0     // Consumption is published from here on
+
+typedef enum {
+    DERIVED_IN_VOLTAGE = 0,        // Battery voltage, V
+    DERIVED_IN_CURRENT,            // Battery current, A
+    DERIVED_IN_SPEED,              // Vehicle speed, km/h
+    DERIVED_IN_SOC,                // State of charge, % (read by the trackers)
+    DERIVED_IN_PLUG,               // Charge plug connected, 0/1 (read by the trackers)
+    DERIVED_IN_CHARGE_POWER,       // Charger power, kW
+    DERIVED_INPUT_COUNT,
+    DERIVED_INPUT_NONE = 0xFF
+} DerivedInput_t;
+
+// Topological order: a node only depends on inputs and earlier nodes
+typedef enum {
+    DERIVED_POWER = 0,             // kW = V * A / 1000
+    DERIVED_ENERGY_OUT,            // kWh drawn from the battery
+    DERIVED_ENERGY_IN,             // kWh put into the battery (charge and regen)
+    DERIVED_REGEN,                 // kWh put into the battery while moving
+    DERIVED_DISTANCE,              // km from integrated speed
+    DERIVED_ENERGY_CHARGED,        // kWh delivered by the charger
+    DERIVED_REGEN_SHARE,           // Regen as % of energy drawn
+    DERIVED_CONSUMPTION,           // (out - regen) per distance, kWh/100 km
+    DERIVED_COUNT
+} DerivedOutput_t;
+
+// Published like decoded signals; the factor is the fixed-point resolution
+// used by binary batches and history (no frame: bit_length 0)
+namespace DerivedMessages {
+    constexpr CANSignal_t SIG_POWER = {
+        "Power", 0, 0, 0.01, 0, "kW", "battery/power", 10000UL
+    };
+    constexpr CANSignal_t SIG_ENERGY_OUT = {
+        "EnergyOut", 0, 0, 0.001, 0, "kWh", "energy/out", 60000UL
+    };
+    constexpr CANSignal_t SIG_ENERGY_IN = {
+        "EnergyIn", 0, 0, 0.001, 0, "kWh", "energy/in", 60000UL
+    };
+    constexpr CANSignal_t SIG_REGEN = {
+        "EnergyRegen", 0, 0, 0.001, 0, "kWh", "energy/regen", 60000UL
+    };
+    constexpr CANSignal_t SIG_DISTANCE = {
+        "Distance", 0, 0, 0.001, 0, "km", "energy/distance", 60000UL
+    };
+    constexpr CANSignal_t SIG_ENERGY_CHARGED = {
+        "EnergyCharged", 0, 0, 0.001, 0, "kWh", "energy/charged", 60000UL
+    };
+    constexpr CANSignal_t SIG_REGEN_SHARE = {
+        "RegenShare", 0, 0, 0.1, 0, "%", "energy/regen_share", 300000UL
+    };
+    constexpr CANSignal_t SIG_CONSUMPTION = {
+        "AvgConsumption", 0, 0, 0.01, 0, "kWh/100km", "energy/consumption", 300000UL
+    };
+}
+
+// Input bound to a decoded signal name, DERIVED_INPUT_NONE if none
+DerivedInput_t derivedInputFor(const char* signal_name);
+
+class DerivedSignalGraph {
+public:
+    DerivedSignalGraph();
+
+    // Forget inputs and restart the counters
+    void reset();
+
+    void setInput(DerivedInput_t input, double value);
+    bool hasPendingInputs() const { return dirty_inputs != 0; }
+
+    // Re-evaluate what depends on the inputs set since the last call;
+    // returns a bit per output that got a new value
+    uint16_t update(uint32_t now_ms);
+
+    bool isValid(DerivedOutput_t output) const { return (valid & (1 << output)) != 0; }
+    double getValue(DerivedOutput_t output) const { return values[output]; }
+    
+    // Latest input values, for consumers of the same vehicle state
+    bool hasInput(DerivedInput_t input) const { return (known_inputs & (1 << input)) != 0; }
+    double getInput(DerivedInput_t input) const { return inputs[input]; }
+
+private:
+    // Trapezoidal integral of a rate over frame time
+    typedef struct {
+        double total;
+        double last_rate;
+        uint32_t last_ms;
+        bool started;
+    } Integrator_t;
+
+    double inputs[DERIVED_INPUT_COUNT];
+    uint8_t known_inputs;          // Bit per input received at least once
+    uint8_t dirty_inputs;          // Bit per input set since the last update
+    double values[DERIVED_COUNT];
+    uint16_t valid;                // Bit per output
+    Integrator_t integrators[DERIVED_COUNT];
+
+    bool evaluate(DerivedOutput_t output, uint32_t now_ms);
+    bool integrate(DerivedOutput_t output, double rate_per_hour, uint32_t now_ms);
+    bool hasInputs(uint8_t mask) const { return (known_inputs & mask) == mask; }
+};
+
+#endif // DERIVED_SIGNALS_H
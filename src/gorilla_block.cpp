@@ -0,0 +1,108 @@
+#include "gorilla_block.h"
+#include <string.h>
+
+GorillaBlock::GorillaBlock() {
+    clear();
+}
+
+void GorillaBlock::clear() {
+    memset(data, 0, sizeof(data));
+    bit_pos = 0;
+    count = 0;
+    first_ts = 0;
+    prev_ts = 0;
+    prev_delta = 0;
+    prev_bits = 0;
+    prev_leading = 0xFF;  // No window yet
+    prev_trailing = 0;
+}
+
+void GorillaBlock::writeBits(uint64_t value, uint8_t bits) {
+    // data[] starts zeroed, so only the one bits need setting
+    while (bits > 0) {
+        bits--;
+        if ((value >> bits) & 1) {
+            data[bit_pos >> 3] |= (uint8_t)(0x80 >> (bit_pos & 7));
+        }
+        bit_pos++;
+    }
+}
+
+static int leadingZeros(uint64_t x) {
+    return __builtin_clzll(x);
+}
+
+static int trailingZeros(uint64_t x) {
+    return __builtin_ctzll(x);
+}
+
+bool GorillaBlock::append(uint32_t ts, double value) {
+    if (bit_pos + GORILLA_MAX_POINT_BITS > GORILLA_BLOCK_BYTES * 8) {
+        return false;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (count == 0) {
+        writeBits(ts, 32);
+        writeBits(bits, 64);
+        first_ts = ts;
+    } else {
+        appendTimestamp(ts);
+        appendValue(bits);
+    }
+    prev_ts = ts;
+    prev_bits = bits;
+    count++;
+    return true;
+}
+
+void GorillaBlock::appendTimestamp(uint32_t ts) {
+    int32_t delta = (int32_t)(ts - prev_ts);
+    int32_t dod = delta - prev_delta;
+    prev_delta = delta;
+
+    if (dod == 0) {
+        writeBits(0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        writeBits(0x2, 2);
+        writeBits((uint32_t)dod, 7);
+    } else if (dod >= -2048 && dod <= 2047) {
+        writeBits(0x6, 3);
+        writeBits((uint32_t)dod, 12);
+    } else if (dod >= -524288 && dod <= 524287) {
+        writeBits(0xE, 4);
+        writeBits((uint32_t)dod, 20);
+    } else {
+        writeBits(0xF, 4);
+        writeBits((uint32_t)dod, 32);
+    }
+}
+
+void GorillaBlock::appendValue(uint64_t bits) {
+    uint64_t x = bits ^ prev_bits;
+    if (x == 0) {
+        writeBits(0, 1);
+        return;
+    }
+
+    int leading = leadingZeros(x);
+    int trailing = trailingZeros(x);
+    if (leading > 31) leading = 31;  // 5-bit field
+
+    if (prev_leading != 0xFF && leading >= prev_leading && trailing >= prev_trailing) {
+        uint8_t length = 64 - prev_leading - prev_trailing;
+        writeBits(0x2, 2);
+        writeBits(x >> prev_trailing, length);
+        return;
+    }
+
+    uint8_t length = 64 - leading - trailing;
+    writeBits(0x3, 2);
+    writeBits(leading, 5);
+    writeBits(length - 1, 6);
+    writeBits(x >> trailing, length);
+    prev_leading = leading;
+    prev_trailing = trailing;
+}
@@ -0,0 +1,66 @@
+#ifndef GORILLA_BLOCK_H
+#define GORILLA_BLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// GORILLA TIME-SERIES BLOCK
+// One signal's (timestamp, value) series packed into a fixed buffer, after
+// Facebook's Gorilla: timestamps as delta-of-delta in variable-width
+// buckets, values as the XOR with the previous double, storing only the
+// bits between its leading and trailing zeros. A repeated timestamp
+// spacing costs 1 bit, a repeated value 1 bit, so slowly changing signals
+// need a few bits per point. Timestamps are in caller-defined ticks;
+// integer-valued doubles (e.g. raw CAN values) XOR down to few bits.
+//
+// Bitstream (MSB first):
+//   first point:  ts (32) value (64)
+//   then per point:
+//     dod = (ts - prev_ts) - prev_delta        (prev_delta is 0 at first)
+//       0                 '0'
+//       [-64, 63]         '10'   + 7 bits (two's complement)
+//       [-2048, 2047]     '110'  + 12 bits
+//       [-524288, 524287] '1110' + 20 bits
+//       otherwise         '1111' + 32 bits
+//     xor = bits(value) ^ bits(prev)
+//       0                 '0'
+//       in prev window    '10'   + the previous window's meaningful bits
+//       otherwise         '11'   + leading (5) + length - 1 (6) + bits
+// ============================================================================
+
+#define GORILLA_BLOCK_BYTES 128
+#define GORILLA_MAX_POINT_BITS (4 + 32 + 2 + 5 + 6 + 64)
+
+class GorillaBlock {
+public:
+    GorillaBlock();
+
+    void clear();
+
+    // False when the point might not fit; the block is left unchanged
+    bool append(uint32_t ts, double value);
+
+    const uint8_t* getData() const { return data; }
+    size_t getBytes() const { return (bit_pos + 7) / 8; }
+    uint16_t getCount() const { return count; }
+    uint32_t getFirstTimestamp() const { return first_ts; }
+    bool isEmpty() const { return count == 0; }
+
+private:
+    uint8_t data[GORILLA_BLOCK_BYTES];
+    uint16_t bit_pos;
+    uint16_t count;
+    uint32_t first_ts;
+    uint32_t prev_ts;
+    int32_t prev_delta;
+    uint64_t prev_bits;
+    uint8_t prev_leading;
+    uint8_t prev_trailing;
+
+    void writeBits(uint64_t value, uint8_t bits);
+    void appendTimestamp(uint32_t ts);
+    void appendValue(uint64_t bits);
+};
+
+#endif // GORILLA_BLOCK_H
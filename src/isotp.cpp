@@ -0,0 +1,229 @@
+#include "isotp.h"
+#include <string.h>
+
+IsoTpLink::IsoTpLink()
+    : sender(nullptr), tx_id(0), rx_id(0), state(ISOTP_IDLE), error(ISOTP_ERR_NONE),
+      length(0), offset(0), sequence(0), block_size(0), block_count(0),
+      stmin_us(0), last_us(0) {}
+
+void IsoTpLink::begin(IsoTpSender* frame_sender, uint32_t tx, uint32_t rx) {
+    sender = frame_sender;
+    tx_id = tx;
+    rx_id = rx;
+    reset();
+}
+
+void IsoTpLink::reset() {
+    state = ISOTP_IDLE;
+    error = ISOTP_ERR_NONE;
+    length = 0;
+    offset = 0;
+}
+
+bool IsoTpLink::send(const uint8_t* data, uint16_t len, uint32_t now_us) {
+    if (state != ISOTP_IDLE && state != ISOTP_ERROR) return false;
+    if (len == 0 || len > ISOTP_MAX_PAYLOAD || sender == nullptr) return false;
+
+    error = ISOTP_ERR_NONE;
+    memcpy(buffer, data, len);
+    length = len;
+
+    if (len <= 7) {
+        // Single frame; the link is free again for the response
+        uint8_t frame[8];
+        frame[0] = ISOTP_PCI_SINGLE | (uint8_t)len;
+        memcpy(frame + 1, data, len);
+        state = ISOTP_IDLE;
+        if (!sendPadded(frame, len + 1)) {
+            fail(ISOTP_ERR_SEND);
+            return false;
+        }
+        return true;
+    }
+
+    // First frame, then wait for the receiver's flow control
+    uint8_t frame[8];
+    frame[0] = ISOTP_PCI_FIRST | (uint8_t)((len >> 8) & 0x0F);
+    frame[1] = (uint8_t)len;
+    memcpy(frame + 2, data, 6);
+    if (!sendPadded(frame, 8)) {
+        fail(ISOTP_ERR_SEND);
+        return false;
+    }
+    offset = 6;
+    sequence = 1;
+    state = ISOTP_TX_WAIT_FC;
+    last_us = now_us;
+    return true;
+}
+
+void IsoTpLink::onFrame(const uint8_t* data, uint8_t dlc, uint32_t now_us) {
+    if (dlc == 0) return;
+
+    switch (data[0] & 0xF0) {
+        case ISOTP_PCI_FLOW_CONTROL: {
+            if (state != ISOTP_TX_WAIT_FC || dlc < 3) return;
+            uint8_t flow_status = data[0] & 0x0F;
+            if (flow_status == ISOTP_FS_CTS) {
+                block_size = data[1];
+                block_count = 0;
+                stmin_us = decodeStMin(data[2]);
+                last_us = now_us - stmin_us;  // First CF may go out immediately
+                state = ISOTP_TX_SENDING;
+                poll(now_us);
+            } else if (flow_status == ISOTP_FS_WAIT) {
+                last_us = now_us;  // Restart N_Bs
+            } else {
+                fail(ISOTP_ERR_OVERFLOW);
+            }
+            break;
+        }
+
+        case ISOTP_PCI_SINGLE: {
+            // A new single frame also aborts an unfinished reception
+            if (state == ISOTP_TX_WAIT_FC || state == ISOTP_TX_SENDING ||
+                state == ISOTP_RX_DONE) return;
+            uint8_t len = data[0] & 0x0F;
+            if (len == 0 || len > dlc - 1) return;
+            memcpy(buffer, data + 1, len);
+            length = len;
+            error = ISOTP_ERR_NONE;
+            state = ISOTP_RX_DONE;
+            break;
+        }
+
+        case ISOTP_PCI_FIRST: {
+            if (state == ISOTP_TX_WAIT_FC || state == ISOTP_TX_SENDING ||
+                state == ISOTP_RX_DONE || dlc < 8) return;
+            uint16_t len = ((uint16_t)(data[0] & 0x0F) << 8) | data[1];
+            if (len < 8) return;
+            if (len > ISOTP_MAX_PAYLOAD) {
+                sendFlowControl(ISOTP_FS_OVERFLOW);
+                fail(ISOTP_ERR_OVERFLOW);
+                return;
+            }
+            memcpy(buffer, data + 2, 6);
+            length = len;
+            offset = 6;
+            sequence = 1;
+            block_count = 0;
+            error = ISOTP_ERR_NONE;
+            state = ISOTP_RX_RECEIVING;
+            last_us = now_us;
+            sendFlowControl(ISOTP_FS_CTS);
+            break;
+        }
+
+        case ISOTP_PCI_CONSECUTIVE: {
+            if (state != ISOTP_RX_RECEIVING) return;
+            if ((data[0] & 0x0F) != sequence) {
+                fail(ISOTP_ERR_SEQUENCE);
+                return;
+            }
+            uint16_t chunk = length - offset;
+            if (chunk > 7) chunk = 7;
+            if (chunk > dlc - 1) chunk = dlc - 1;
+            memcpy(buffer + offset, data + 1, chunk);
+            offset += chunk;
+            sequence = (sequence + 1) & 0x0F;
+            last_us = now_us;
+
+            if (offset >= length) {
+                state = ISOTP_RX_DONE;
+                break;
+            }
+#if ISOTP_RX_BLOCK_SIZE > 0
+            if (++block_count >= ISOTP_RX_BLOCK_SIZE) {
+                block_count = 0;
+                sendFlowControl(ISOTP_FS_CTS);
+            }
+#endif
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void IsoTpLink::poll(uint32_t now_us) {
+    switch (state) {
+        case ISOTP_TX_WAIT_FC:
+        case ISOTP_RX_RECEIVING:
+            if (now_us - last_us > ISOTP_TIMEOUT_US) {
+                fail(ISOTP_ERR_TIMEOUT);
+            }
+            break;
+
+        case ISOTP_TX_SENDING:
+            // Burst while STmin allows; a full TX queue is retried next poll
+            while (state == ISOTP_TX_SENDING && now_us - last_us >= stmin_us) {
+                if (!sendConsecutive(now_us)) {
+                    if (now_us - last_us > ISOTP_TIMEOUT_US) {
+                        fail(ISOTP_ERR_SEND);
+                    }
+                    break;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool IsoTpLink::receive(const uint8_t*& data, uint16_t& len) {
+    if (state != ISOTP_RX_DONE) return false;
+    data = buffer;
+    len = length;
+    state = ISOTP_IDLE;
+    return true;
+}
+
+bool IsoTpLink::sendPadded(const uint8_t* data, uint8_t len) {
+    uint8_t frame[8];
+    memset(frame, ISOTP_PADDING, sizeof(frame));
+    memcpy(frame, data, len);
+    return sender->sendFrame(tx_id, frame, sizeof(frame));
+}
+
+bool IsoTpLink::sendFlowControl(uint8_t flow_status) {
+    uint8_t frame[3] = {
+        (uint8_t)(ISOTP_PCI_FLOW_CONTROL | flow_status),
+        ISOTP_RX_BLOCK_SIZE,
+        ISOTP_RX_STMIN
+    };
+    return sendPadded(frame, sizeof(frame));
+}
+
+bool IsoTpLink::sendConsecutive(uint32_t now_us) {
+    uint8_t frame[8];
+    uint16_t chunk = length - offset;
+    if (chunk > 7) chunk = 7;
+    frame[0] = ISOTP_PCI_CONSECUTIVE | sequence;
+    memcpy(frame + 1, buffer + offset, chunk);
+    if (!sendPadded(frame, (uint8_t)(chunk + 1))) return false;
+
+    offset += chunk;
+    sequence = (sequence + 1) & 0x0F;
+    last_us = now_us;
+
+    if (offset >= length) {
+        state = ISOTP_IDLE;
+    } else if (block_size > 0 && ++block_count >= block_size) {
+        block_count = 0;
+        state = ISOTP_TX_WAIT_FC;
+    }
+    return true;
+}
+
+void IsoTpLink::fail(IsoTpError_t err) {
+    error = err;
+    state = ISOTP_ERROR;
+}
+
+uint32_t IsoTpLink::decodeStMin(uint8_t raw) {
+    if (raw <= 0x7F) return (uint32_t)raw * 1000UL;
+    if (raw >= 0xF1 && raw <= 0xF9) return (uint32_t)(raw - 0xF0) * 100UL;
+    return 127000UL;  // Reserved values: use the maximum
+}
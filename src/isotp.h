@@ -0,0 +1,107 @@
+#ifndef ISOTP_H
+#define ISOTP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// ISO-TP (ISO 15765-2) TRANSPORT
+// Normal addressing on classic CAN, 8-byte padded frames. One IsoTpLink per
+// ECU request/response ID pair; a request and its response share the link
+// (half duplex). The link never blocks: consecutive frames and timeouts are
+// driven by poll(), frames are sent through IsoTpSender so the same code
+// runs against the TWAI driver or a simulated ECU on a host.
+// ============================================================================
+
+#ifndef ISOTP_MAX_PAYLOAD
+#define ISOTP_MAX_PAYLOAD 256      // Largest message sent or received
+#endif
+#define ISOTP_PADDING 0xAA         // Filler for unused frame bytes
+#define ISOTP_RX_BLOCK_SIZE 0      // BS we grant: 0 = no further flow control
+#define ISOTP_RX_STMIN 0           // STmin we request from the sender (ms)
+#define ISOTP_TIMEOUT_US 1000000UL // N_Bs / N_Cr: wait for FC or next CF
+
+// Protocol control information (high nibble of byte 0)
+#define ISOTP_PCI_SINGLE 0x00
+#define ISOTP_PCI_FIRST 0x10
+#define ISOTP_PCI_CONSECUTIVE 0x20
+#define ISOTP_PCI_FLOW_CONTROL 0x30
+
+// Flow status (low nibble of a flow control frame)
+#define ISOTP_FS_CTS 0x0
+#define ISOTP_FS_WAIT 0x1
+#define ISOTP_FS_OVERFLOW 0x2
+
+// Frame output used by the link
+class IsoTpSender {
+public:
+    virtual ~IsoTpSender() {}
+    virtual bool sendFrame(uint32_t id, const uint8_t* data, uint8_t len) = 0;
+};
+
+typedef enum {
+    ISOTP_IDLE = 0,
+    ISOTP_TX_WAIT_FC,      // First frame sent, waiting for flow control
+    ISOTP_TX_SENDING,      // Sending consecutive frames
+    ISOTP_RX_RECEIVING,    // Receiving consecutive frames
+    ISOTP_RX_DONE,         // Complete message ready in receive()
+    ISOTP_ERROR            // Timeout, overflow or sequence error
+} IsoTpState_t;
+
+typedef enum {
+    ISOTP_ERR_NONE = 0,
+    ISOTP_ERR_TIMEOUT,
+    ISOTP_ERR_SEQUENCE,
+    ISOTP_ERR_OVERFLOW,    // Peer's message exceeds ISOTP_MAX_PAYLOAD, or peer refused ours
+    ISOTP_ERR_SEND         // Frame could not be queued for transmission
+} IsoTpError_t;
+
+class IsoTpLink {
+public:
+    IsoTpLink();
+
+    void begin(IsoTpSender* sender, uint32_t tx_id, uint32_t rx_id);
+    void reset();
+
+    // Start sending a message; false if busy, too long or the first frame failed
+    bool send(const uint8_t* data, uint16_t len, uint32_t now_us);
+
+    // Feed a received frame addressed to rx_id
+    void onFrame(const uint8_t* data, uint8_t dlc, uint32_t now_us);
+
+    // Send due consecutive frames and check timeouts
+    void poll(uint32_t now_us);
+
+    // Completed message (valid in ISOTP_RX_DONE); releases the link
+    bool receive(const uint8_t*& data, uint16_t& len);
+
+    IsoTpState_t getState() const { return state; }
+    IsoTpError_t getError() const { return error; }
+    bool isIdle() const { return state == ISOTP_IDLE; }
+    uint32_t getTxId() const { return tx_id; }
+    uint32_t getRxId() const { return rx_id; }
+
+private:
+    IsoTpSender* sender;
+    uint32_t tx_id;
+    uint32_t rx_id;
+    IsoTpState_t state;
+    IsoTpError_t error;
+
+    uint8_t buffer[ISOTP_MAX_PAYLOAD];
+    uint16_t length;          // Total message length
+    uint16_t offset;          // Bytes sent / received so far
+    uint8_t sequence;         // Next consecutive frame sequence number
+    uint8_t block_size;       // TX: BS granted by the peer; RX: frames until next FC
+    uint8_t block_count;      // Consecutive frames in the current block
+    uint32_t stmin_us;        // TX: minimum gap between consecutive frames
+    uint32_t last_us;         // Time of the last frame sent or received
+
+    bool sendPadded(const uint8_t* data, uint8_t len);
+    bool sendFlowControl(uint8_t flow_status);
+    bool sendConsecutive(uint32_t now_us);
+    void fail(IsoTpError_t err);
+    static uint32_t decodeStMin(uint8_t raw);
+};
+
+#endif // ISOTP_H
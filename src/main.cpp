@@ -7,6 +7,8 @@
 #include "power_manager.h"
 #include "data_manager.h"
 #include "data_simulator.h"
+#include "can_capture.h"
+#include "trace_replayer.h"
 
 // Global instances
 CANHandler can_handler;
@@ -15,6 +17,8 @@ ModemHandler modem_handler;
 PowerManager power_manager;
 DataManager data_manager(&can_handler, &mqtt_handler, &modem_handler);
 DataSimulator& simulator = DataSimulator::getInstance();
+CANCapture can_capture;
+TraceReplayer replayer(&data_manager, &mqtt_handler);
 
 // Function prototypes
 void handleMQTTConnection();
@@ -66,9 +70,25 @@ void setup() {
     }
     
     // Initialize all components with settings
-    if (!g_settings.getSettings().simulator.enabled) {
+    const auto& replay_config = g_settings.getSettings().replay;
+    bool replaying = !sim_config.enabled && replay_config.enabled;
+    if (replaying) {
+        DEBUG_PRINTLN("[System] TRACE REPLAY MODE (no live CAN)");
+    } else if (!g_settings.getSettings().simulator.enabled) {
         DEBUG_PRINTLN("[System] Initializing CAN Handler...");
         can_handler.begin();
+        
+        const auto& capture_config = g_settings.getSettings().capture;
+        if (capture_config.enabled) {
+            DEBUG_PRINTLN("[System] Starting CAN capture...");
+            can_capture.begin(capture_config.budget_bytes, capture_config.segment_bytes);
+        }
+        
+        // Live publishing only: a replay must not fill the outbox
+        const auto& outbox_config = g_settings.getSettings().outbox;
+        if (outbox_config.enabled) {
+            mqtt_handler.beginOutbox(outbox_config.budget_bytes, outbox_config.replay_rate);
+        }
     }
     
     DEBUG_PRINTLN("[System] Initializing Modem Handler...");
@@ -78,7 +98,22 @@ void setup() {
     power_manager.begin();
     
     DEBUG_PRINTLN("[System] Initializing Data Manager...");
+    data_manager.setBaseTopic(g_settings.getSettings().mqtt.base_topic);
     data_manager.begin();
+    const auto& mqtt_config = g_settings.getSettings().mqtt;
+    data_manager.setWindowSummaries(mqtt_config.window_summaries);
+    data_manager.setBinaryBatches(mqtt_config.binary_batches);
+    data_manager.setHistory(mqtt_config.history_enabled);
+    data_manager.setBootId(esp_random());
+    data_manager.configureBatching(mqtt_config.batch_enabled, mqtt_config.batch_max_bytes,
+                                   mqtt_config.batch_deadline_ms,
+                                   mqtt_config.publish_interval_fast,
+                                   mqtt_config.publish_interval_mid);
+    
+    // Replay starts after the signal table is registered
+    if (replaying) {
+        replayer.begin(replay_config.path, replay_config.realtime, replay_config.record_output);
+    }
     
     // List files on LittleFS (debug)
     g_settings.listFiles();
@@ -103,17 +138,47 @@ void loop() {
                         sim_data.soc_percent, sim_data.battery_temp_c, sim_data.speed_kmh);
             // Data would be processed here for MQTT publishing
         }
+    } else if (g_settings.getSettings().replay.enabled) {
+        // Recorded trace instead of the live bus (idle once it has finished)
+        replayer.loop();
     } else {
-        // Normal CAN processing
-        CANMessage_t msg;
-        if (can_handler.readCAN1(msg)) {
+        // Normal CAN processing: drain what the RX task buffered since the last loop
+        static CANMessage_t rx_batch[CAN_RX_BATCH_SIZE];
+        size_t received = can_handler.readCAN1Batch(rx_batch, CAN_RX_BATCH_SIZE,
+                                                    CAN_RX_BATCH_BUDGET_US);
+        if (received > 0) {
             power_manager.notifyActivity();
-            data_manager.processCAN1Message(msg);
+            if (can_capture.isActive()) {
+                can_capture.recordBatch(rx_batch, received);
+            }
+            data_manager.processCAN1Batch(rx_batch, received);
+        }
+        
+        // Error alerts and bus-off recovery
+        can_handler.pollAlerts();
+        
+        // CAN2 (MCP2515): each interrupt yields up to two frames
+        if (can_handler.isConnected2()) {
+            CANMessage_t msg;
+            uint16_t drained = 0;
+            while (drained < CAN_RX_BATCH_SIZE && can_handler.readCAN2(msg)) {
+                if (can_capture.isActive()) {
+                    can_capture.record(msg, 2);
+                }
+                data_manager.processCAN2Message(msg);
+                drained++;
+            }
+            if (drained > 0) {
+                power_manager.notifyActivity();
+            }
         }
     }
     
-    // MQTT handling - SKIP in simulator mode
-    if (!g_settings.getSettings().simulator.enabled) {
+    // MQTT handling - SKIP in simulator and replay mode (a replay records
+    // its publish stream instead of sending it)
+    bool live = !g_settings.getSettings().simulator.enabled &&
+                !g_settings.getSettings().replay.enabled;
+    if (live) {
         handleMQTTConnection();
         mqtt_handler.loop();
     }
@@ -121,16 +186,21 @@ void loop() {
     // Power management
     data_manager.loop();
     
-    // GPS update interval from settings (also skip in simulator)
-    if (!g_settings.getSettings().simulator.enabled) {
+    // GPS update interval from settings (also skip in simulator and replay:
+    // live positions would end up in the replayed trips)
+    if (live) {
         static uint32_t last_gps_update = 0;
         uint32_t gps_interval = g_settings.getSettings().modem.gps_interval;
+        if (data_manager.wantsPosition()) {
+            gps_interval = TRIP_END_FIX_RETRY_MS;   // A trip ended: fetch its end point now
+        }
         
         if ((millis() - last_gps_update) > gps_interval && modem_handler.isNetworkConnected()) {
             GPSData_t gps;
             if (modem_handler.getGPS(gps)) {
                 DEBUG_PRINTF("[GPS] Lat: %.6f, Lon: %.6f, Sats: %d\n", 
                             gps.latitude, gps.longitude, gps.satellites);
+                data_manager.setPosition(gps.latitude, gps.longitude);  // Trip start/end points
                 
                 // Get base topic from settings
                 const char* base_topic = g_settings.getSettings().mqtt.base_topic;
@@ -146,6 +216,18 @@ void loop() {
         }
     }
     
+    // Anchor history timestamps to network time once the modem has it
+    if (live && !data_manager.hasWallClock() && modem_handler.isNetworkConnected()) {
+        static uint32_t last_clock_check = 0;
+        if (last_clock_check == 0 || (millis() - last_clock_check) > 60000UL) {
+            uint32_t unix_s;
+            if (modem_handler.getNetworkTime(unix_s)) {
+                data_manager.setWallClock(unix_s);
+            }
+            last_clock_check = millis();
+        }
+    }
+    
     // Check for sleep conditions
     checkSleepConditions();
     
@@ -174,14 +256,24 @@ void handleMQTTConnection() {
 }
 
 void checkSleepConditions() {
+    // Queued publishes are persisted once per idle period, not on every
+    // pass: each flush closes a flash page however little it holds
+    static bool outbox_flushed = false;
+    
     // Check if we should enter sleep
     if (power_manager.shouldEnterSleep()) {
         uint32_t sleep_timeout = g_settings.getSettings().power.sleep_timeout_idle;
         if (power_manager.getIdleTime() > sleep_timeout) {
-            // Would enter sleep here
+            // Would enter sleep here; persist queued publishes first
+            if (!outbox_flushed) {
+                mqtt_handler.flushOutbox();
+                outbox_flushed = true;
+            }
             // power_manager.goToLightSleep(5000);
+            return;
         }
     }
+    outbox_flushed = false;
 }
 
 void initializeFromSettings() {
@@ -237,6 +329,15 @@ void printSystemStatus() {
         DEBUG_PRINTF("Battery: %.2f V (%u%%)\n", power_manager.getBatteryVoltage(),
                     power_manager.estimateBatteryPercent());
         DEBUG_PRINTF("CAN Messages: %lu\n", data_manager.getProcessedMessageCount());
+        DEBUG_PRINTF("CAN RX Ring: %lu dropped, high-water %lu/%u\n",
+                    can_handler.getRxDrops1(), can_handler.getRxHighWater1(), CAN_RX_QUEUE_SIZE);
+        DEBUG_PRINTF("CAN Bus Load: %.1f%% (last diagnostics window)\n",
+                    can_handler.getMonitor1().getBusLoadPercent());
+        if (can_capture.isActive()) {
+            DEBUG_PRINTF("CAN Capture: %lu frames, %lu dropped, %lu bytes written\n",
+                        can_capture.getFramesCaptured(), can_capture.getFramesDropped(),
+                        can_capture.getBytesWritten());
+        }
     }
     
     DEBUG_PRINTF("MQTT Published: %lu\n", data_manager.getPublishedMessageCount());
@@ -0,0 +1,252 @@
+#include "mcp2515.h"
+#include <string.h>
+
+// Bit timing (CNF1, CNF2, CNF3) for the common crystal/bitrate combinations
+typedef struct {
+    uint8_t clock_mhz;
+    uint32_t bitrate;
+    uint8_t cnf1;
+    uint8_t cnf2;
+    uint8_t cnf3;
+} MCP2515Timing_t;
+
+static const MCP2515Timing_t MCP2515_TIMINGS[] = {
+    { 8,  125000, 0x01, 0xB1, 0x85 },
+    { 8,  250000, 0x00, 0xB1, 0x85 },
+    { 8,  500000, 0x00, 0x90, 0x82 },
+    { 16, 125000, 0x03, 0xF0, 0x86 },
+    { 16, 250000, 0x41, 0xF1, 0x85 },
+    { 16, 500000, 0x00, 0xF0, 0x86 },
+};
+
+MCP2515::MCP2515(MCP2515Transport* transport)
+    : transport(transport),
+      spi_transactions(0),
+      frames_read(0) {}
+
+bool MCP2515::begin(uint32_t bitrate, uint8_t clock_mhz) {
+    const MCP2515Timing_t* timing = nullptr;
+    for (size_t i = 0; i < sizeof(MCP2515_TIMINGS) / sizeof(MCP2515_TIMINGS[0]); i++) {
+        if (MCP2515_TIMINGS[i].clock_mhz == clock_mhz && MCP2515_TIMINGS[i].bitrate == bitrate) {
+            timing = &MCP2515_TIMINGS[i];
+            break;
+        }
+    }
+    if (timing == nullptr) return false;
+    
+    // Reset puts the chip in configuration mode; use that to detect its presence
+    uint8_t reset = MCP_INSTR_RESET;
+    transfer(&reset, nullptr, 1);
+    transport->delayMicros(10000);
+    if ((readRegister(MCP_REG_CANSTAT) & MCP_MODE_MASK) != MCP_MODE_CONFIG) {
+        return false;
+    }
+    
+    // CNF3, CNF2, CNF1 are consecutive registers
+    uint8_t cnf[3] = { timing->cnf3, timing->cnf2, timing->cnf1 };
+    writeRegisters(MCP_REG_CNF3, cnf, 3);
+    
+    // Interrupt on both RX buffers; accept everything until filters are set
+    writeRegister(MCP_REG_CANINTE, MCP_RX0IF | MCP_RX1IF);
+    writeRegister(MCP_REG_RXB0CTRL, MCP_RXB_RXM_OFF | MCP_RXB0_BUKT);
+    writeRegister(MCP_REG_RXB1CTRL, MCP_RXB_RXM_OFF);
+    
+    return setMode(MCP_MODE_NORMAL);
+}
+
+bool MCP2515::setFilters(const uint32_t* ids, size_t count) {
+    if (!setMode(MCP_MODE_CONFIG)) return false;
+    
+    CANFilterConfig_t config = CANFilter::compute(ids, count);
+    
+    if (config.accept_all) {
+        writeRegister(MCP_REG_RXB0CTRL, MCP_RXB_RXM_OFF | MCP_RXB0_BUKT);
+        writeRegister(MCP_REG_RXB1CTRL, MCP_RXB_RXM_OFF);
+        return setMode(MCP_MODE_NORMAL);
+    }
+    
+    // MCP2515 mask bits are "must match" (inverse of the TWAI convention)
+    uint32_t full = config.extended ? 0x1FFFFFFFUL : 0x7FFUL;
+    uint32_t mask0, mask1;
+    uint32_t filters[6];
+    
+    if (count <= 6) {
+        // Few enough IDs for exact matching: RXF0-1 on RXB0, RXF2-5 on RXB1
+        mask0 = full;
+        mask1 = full;
+        for (size_t i = 0; i < 6; i++) {
+            filters[i] = ids[(i < count) ? i : count - 1];
+        }
+    } else {
+        // One calculated code/mask pair per RX buffer
+        const CANIdMask_t& first = config.filter[0];
+        const CANIdMask_t& second = (config.filter_count > 1) ? config.filter[1] : config.filter[0];
+        mask0 = ~first.mask & full;
+        mask1 = ~second.mask & full;
+        filters[0] = filters[1] = first.code;
+        filters[2] = filters[3] = filters[4] = filters[5] = second.code;
+    }
+    
+    static const uint8_t filter_regs[6] = {
+        MCP_REG_RXF0SIDH, MCP_REG_RXF1SIDH, MCP_REG_RXF2SIDH,
+        MCP_REG_RXF3SIDH, MCP_REG_RXF4SIDH, MCP_REG_RXF5SIDH
+    };
+    uint8_t regs[4];
+    
+    encodeId(mask0, config.extended, regs);
+    writeRegisters(MCP_REG_RXM0SIDH, regs, 4);
+    encodeId(mask1, config.extended, regs);
+    writeRegisters(MCP_REG_RXM1SIDH, regs, 4);
+    for (uint8_t i = 0; i < 6; i++) {
+        encodeId(filters[i], config.extended, regs);
+        writeRegisters(filter_regs[i], regs, 4);
+    }
+    
+    writeRegister(MCP_REG_RXB0CTRL, MCP_RXB0_BUKT);  // Filters on, rollover enabled
+    writeRegister(MCP_REG_RXB1CTRL, 0x00);
+    return setMode(MCP_MODE_NORMAL);
+}
+
+uint8_t MCP2515::readFrames(CANMessage_t* out, uint64_t timestamp_us) {
+    uint8_t status = readStatus();
+    bool rx0 = (status & MCP_RX0IF) != 0;
+    bool rx1 = (status & MCP_RX1IF) != 0;
+    
+    if (rx0 && rx1) {
+        // Both full: one READ burst covers RXB0SIDH..RXB1D7 (0x61-0x7D)
+        const uint8_t span = (MCP_REG_RXB1SIDH + MCP_BUFFER_BYTES) - MCP_REG_RXB0SIDH;
+        uint8_t tx[2 + span];
+        uint8_t rx[2 + span];
+        memset(tx, 0, sizeof(tx));
+        tx[0] = MCP_INSTR_READ;
+        tx[1] = MCP_REG_RXB0SIDH;
+        transfer(tx, rx, sizeof(tx));
+        
+        decodeBuffer(&rx[2], out[0]);
+        decodeBuffer(&rx[2 + (MCP_REG_RXB1SIDH - MCP_REG_RXB0SIDH)], out[1]);
+        out[0].timestamp_us = timestamp_us;
+        out[1].timestamp_us = timestamp_us;
+        
+        // Plain READ does not clear the flags
+        bitModify(MCP_REG_CANINTF, MCP_RX0IF | MCP_RX1IF, 0x00);
+        frames_read += 2;
+        return 2;
+    }
+    
+    if (rx0 || rx1) {
+        // READ RX BUFFER clears the buffer's interrupt flag when CS is released
+        uint8_t tx[1 + MCP_BUFFER_BYTES];
+        uint8_t rx[1 + MCP_BUFFER_BYTES];
+        memset(tx, 0, sizeof(tx));
+        tx[0] = rx0 ? MCP_INSTR_READ_RXB0 : MCP_INSTR_READ_RXB1;
+        transfer(tx, rx, sizeof(tx));
+        
+        decodeBuffer(&rx[1], out[0]);
+        out[0].timestamp_us = timestamp_us;
+        frames_read++;
+        return 1;
+    }
+    
+    return 0;
+}
+
+bool MCP2515::sendFrame(const CANMessage_t& msg) {
+    if (readRegister(MCP_REG_TXB0CTRL) & MCP_TXREQ) {
+        return false;  // Previous frame still pending
+    }
+    
+    uint8_t dlc = (msg.dlc <= 8) ? msg.dlc : 8;
+    uint8_t tx[1 + MCP_BUFFER_BYTES];
+    memset(tx, 0, sizeof(tx));
+    tx[0] = MCP_INSTR_LOAD_TXB0;
+    encodeId(msg.id, msg.id > 0x7FF, &tx[1]);
+    tx[5] = dlc;
+    memcpy(&tx[6], msg.data, dlc);
+    transfer(tx, nullptr, 1 + 5 + dlc);
+    
+    uint8_t rts = MCP_INSTR_RTS_TXB0;
+    transfer(&rts, nullptr, 1);
+    return true;
+}
+
+uint8_t MCP2515::readAndClearOverflow() {
+    uint8_t overflow = readRegister(MCP_REG_EFLG) & (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR);
+    if (overflow) {
+        bitModify(MCP_REG_EFLG, overflow, 0x00);
+    }
+    return overflow;
+}
+
+bool MCP2515::setMode(uint8_t mode) {
+    bitModify(MCP_REG_CANCTRL, MCP_MODE_MASK, mode);
+    for (uint8_t attempt = 0; attempt < 10; attempt++) {
+        if ((readRegister(MCP_REG_CANSTAT) & MCP_MODE_MASK) == mode) {
+            return true;
+        }
+        transport->delayMicros(100);
+    }
+    return false;
+}
+
+uint8_t MCP2515::readRegister(uint8_t reg) {
+    uint8_t tx[3] = { MCP_INSTR_READ, reg, 0x00 };
+    uint8_t rx[3];
+    transfer(tx, rx, 3);
+    return rx[2];
+}
+
+void MCP2515::writeRegister(uint8_t reg, uint8_t value) {
+    writeRegisters(reg, &value, 1);
+}
+
+void MCP2515::writeRegisters(uint8_t reg, const uint8_t* values, uint8_t count) {
+    uint8_t tx[2 + 16];
+    if (count > 16) count = 16;
+    tx[0] = MCP_INSTR_WRITE;
+    tx[1] = reg;
+    memcpy(&tx[2], values, count);
+    transfer(tx, nullptr, 2 + count);
+}
+
+void MCP2515::bitModify(uint8_t reg, uint8_t mask, uint8_t value) {
+    uint8_t tx[4] = { MCP_INSTR_BIT_MODIFY, reg, mask, value };
+    transfer(tx, nullptr, 4);
+}
+
+uint8_t MCP2515::readStatus() {
+    uint8_t tx[2] = { MCP_INSTR_READ_STATUS, 0x00 };
+    uint8_t rx[2];
+    transfer(tx, rx, 2);
+    return rx[1];
+}
+
+void MCP2515::transfer(const uint8_t* tx, uint8_t* rx, size_t len) {
+    spi_transactions++;
+    transport->transfer(tx, rx, len);
+}
+
+void MCP2515::encodeId(uint32_t id, bool extended, uint8_t* regs) {
+    if (extended) {
+        regs[0] = (uint8_t)(id >> 21);
+        regs[1] = (uint8_t)(((id >> 13) & 0xE0) | MCP_SIDL_IDE | ((id >> 16) & 0x03));
+        regs[2] = (uint8_t)(id >> 8);
+        regs[3] = (uint8_t)id;
+    } else {
+        regs[0] = (uint8_t)(id >> 3);
+        regs[1] = (uint8_t)((id & 0x07) << 5);
+        regs[2] = 0;
+        regs[3] = 0;
+    }
+}
+
+void MCP2515::decodeBuffer(const uint8_t* regs, CANMessage_t& msg) {
+    uint32_t id = ((uint32_t)regs[0] << 3) | (regs[1] >> 5);
+    if (regs[1] & MCP_SIDL_IDE) {
+        id = (id << 18) | ((uint32_t)(regs[1] & 0x03) << 16) |
+             ((uint32_t)regs[2] << 8) | regs[3];
+    }
+    msg.id = id;
+    msg.dlc = regs[4] & 0x0F;
+    if (msg.dlc > 8) msg.dlc = 8;
+    memcpy(msg.data, &regs[5], msg.dlc);
+}
@@ -0,0 +1,113 @@
+#ifndef MCP2515_H
+#define MCP2515_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "can_messages.h"
+#include "can_filter.h"
+
+// ============================================================================
+// MCP2515 STAND-ALONE CAN CONTROLLER (SPI)
+// Used for the second (comfort, 125 kbps) CAN bus. All register access goes
+// through MCP2515Transport so the driver can run against real SPI hardware
+// (mcp2515_spi.h) or a register-level model on a host (test/mcp2515_model.h).
+// ============================================================================
+
+// SPI instructions
+#define MCP_INSTR_RESET       0xC0
+#define MCP_INSTR_READ        0x03
+#define MCP_INSTR_WRITE       0x02
+#define MCP_INSTR_BIT_MODIFY  0x05
+#define MCP_INSTR_READ_STATUS 0xA0
+#define MCP_INSTR_READ_RXB0   0x90  // READ RX BUFFER, RXB0 from SIDH
+#define MCP_INSTR_READ_RXB1   0x94  // READ RX BUFFER, RXB1 from SIDH
+#define MCP_INSTR_LOAD_TXB0   0x40  // LOAD TX BUFFER, TXB0 from SIDH
+#define MCP_INSTR_RTS_TXB0    0x81
+
+// Registers
+#define MCP_REG_RXF0SIDH  0x00
+#define MCP_REG_RXF1SIDH  0x04
+#define MCP_REG_RXF2SIDH  0x08
+#define MCP_REG_RXF3SIDH  0x10
+#define MCP_REG_RXF4SIDH  0x14
+#define MCP_REG_RXF5SIDH  0x18
+#define MCP_REG_RXM0SIDH  0x20
+#define MCP_REG_RXM1SIDH  0x24
+#define MCP_REG_CNF3      0x28
+#define MCP_REG_CNF2      0x29
+#define MCP_REG_CNF1      0x2A
+#define MCP_REG_CANINTE   0x2B
+#define MCP_REG_CANINTF   0x2C
+#define MCP_REG_EFLG      0x2D
+#define MCP_REG_CANSTAT   0x0E
+#define MCP_REG_CANCTRL   0x0F
+#define MCP_REG_TXB0CTRL  0x30
+#define MCP_REG_RXB0CTRL  0x60
+#define MCP_REG_RXB0SIDH  0x61
+#define MCP_REG_RXB1CTRL  0x70
+#define MCP_REG_RXB1SIDH  0x71
+
+// Bits
+#define MCP_MODE_MASK     0xE0
+#define MCP_MODE_NORMAL   0x00
+#define MCP_MODE_CONFIG   0x80
+#define MCP_RX0IF         0x01
+#define MCP_RX1IF         0x02
+#define MCP_TXREQ         0x08
+#define MCP_SIDL_IDE      0x08
+#define MCP_RXB_RXM_OFF   0x60  // Receive any message, filters off
+#define MCP_RXB0_BUKT     0x04  // RXB0 rolls over into RXB1 when full
+#define MCP_EFLG_RX0OVR   0x40
+#define MCP_EFLG_RX1OVR   0x80
+
+// Bytes per RX/TX buffer image: SIDH, SIDL, EID8, EID0, DLC, D0..D7
+#define MCP_BUFFER_BYTES  13
+
+// Register access: one chip-select framed transaction per transfer()
+class MCP2515Transport {
+public:
+    virtual ~MCP2515Transport() {}
+    virtual void transfer(const uint8_t* tx, uint8_t* rx, size_t len) = 0;
+    virtual void delayMicros(uint32_t us) = 0;
+};
+
+class MCP2515 {
+public:
+    explicit MCP2515(MCP2515Transport* transport);
+    
+    // Reset, bit timing, interrupts; leaves the chip in normal mode
+    bool begin(uint32_t bitrate, uint8_t clock_mhz);
+    
+    // Program RXM0/RXM1 and RXF0-5 from the wanted IDs (config mode round trip)
+    bool setFilters(const uint32_t* ids, size_t count);
+    
+    // Read every pending RX buffer (0-2 frames) with a single burst
+    uint8_t readFrames(CANMessage_t* out, uint64_t timestamp_us);
+    
+    bool sendFrame(const CANMessage_t& msg);
+    
+    // RX overflow flags (EFLG), cleared after reading
+    uint8_t readAndClearOverflow();
+    
+    // Statistics
+    uint32_t getSpiTransactions() const { return spi_transactions; }
+    uint32_t getFramesRead() const { return frames_read; }
+    
+private:
+    bool setMode(uint8_t mode);
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+    void writeRegisters(uint8_t reg, const uint8_t* values, uint8_t count);
+    void bitModify(uint8_t reg, uint8_t mask, uint8_t value);
+    uint8_t readStatus();
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t len);
+    
+    static void encodeId(uint32_t id, bool extended, uint8_t* regs);
+    static void decodeBuffer(const uint8_t* regs, CANMessage_t& msg);
+    
+    MCP2515Transport* transport;
+    uint32_t spi_transactions;
+    uint32_t frames_read;
+};
+
+#endif // MCP2515_H
@@ -0,0 +1,34 @@
+#include "mcp2515_spi.h"
+
+MCP2515SPITransport::MCP2515SPITransport(SPIClass& spi, int8_t sck_pin, int8_t miso_pin,
+                                         int8_t mosi_pin, uint8_t cs_pin, uint32_t clock_hz)
+    : spi(spi), sck_pin(sck_pin), miso_pin(miso_pin), mosi_pin(mosi_pin), cs_pin(cs_pin),
+      settings(clock_hz, MSBFIRST, SPI_MODE0) {}
+
+void MCP2515SPITransport::begin() {
+    pinMode(cs_pin, OUTPUT);
+    digitalWrite(cs_pin, HIGH);
+    // Never the core's default pins: on some boards they are wired to the modem
+    spi.begin(sck_pin, miso_pin, mosi_pin, cs_pin);
+}
+
+void MCP2515SPITransport::end() {
+    spi.end();
+    pinMode(cs_pin, INPUT);
+}
+
+void MCP2515SPITransport::transfer(const uint8_t* tx, uint8_t* rx, size_t len) {
+    spi.beginTransaction(settings);
+    digitalWrite(cs_pin, LOW);
+    spi.transferBytes(tx, rx, len);
+    digitalWrite(cs_pin, HIGH);
+    spi.endTransaction();
+}
+
+void MCP2515SPITransport::delayMicros(uint32_t us) {
+    if (us >= 1000) {
+        delay(us / 1000);
+    } else {
+        delayMicroseconds(us);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef MCP2515_SPI_H
+#define MCP2515_SPI_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "mcp2515.h"
+
+// Arduino SPI bus transport on explicit pins with a dedicated chip-select
+class MCP2515SPITransport : public MCP2515Transport {
+public:
+    MCP2515SPITransport(SPIClass& spi, int8_t sck_pin, int8_t miso_pin, int8_t mosi_pin,
+                        uint8_t cs_pin, uint32_t clock_hz);
+    void begin();
+    void end();  // Release the bus and its pins (chip absent or CAN2 stopped)
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t len) override;
+    void delayMicros(uint32_t us) override;
+    
+private:
+    SPIClass& spi;
+    int8_t sck_pin;
+    int8_t miso_pin;
+    int8_t mosi_pin;
+    uint8_t cs_pin;
+    SPISettings settings;
+};
+
+#endif // MCP2515_SPI_H
@@ -62,6 +62,35 @@ NetworkStatus_t ModemHandler::getNetworkStatus() {
     return cached_network_status;
 }
 
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+bool ModemHandler::getNetworkTime(uint32_t& unix_s) {
+    // +CCLK: "yy/MM/dd,hh:mm:ss+zz", local time with the offset in quarter hours
+    char response[64];
+    if (!sendATCommand("AT+CCLK?", response, sizeof(response), 1000)) return false;
+    const char* quote = strchr(response, '"');
+    if (!quote) return false;
+    int yy, mo, dd, hh, mi, ss, tz;
+    char sign;
+    if (sscanf(quote + 1, "%d/%d/%d,%d:%d:%d%c%d",
+               &yy, &mo, &dd, &hh, &mi, &ss, &sign, &tz) != 8) return false;
+    // Before the network has set it, the clock counts from "80/01/06"
+    if (yy < 24 || yy >= 80 || mo < 1 || mo > 12 || dd < 1 || dd > 31) return false;
+    int32_t offset_s = tz * 15 * 60;
+    if (sign == '-') offset_s = -offset_s;
+    int64_t local = (int64_t)daysFromCivil(2000 + yy, mo, dd) * 86400 + hh * 3600 + mi * 60 + ss;
+    unix_s = (uint32_t)(local - offset_s);
+    return true;
+}
+
 bool ModemHandler::enableGPS() {
     DEBUG_PRINTLN("[Modem] Enabling GPS...");
     gps_enabled = true;
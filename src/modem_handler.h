@@ -36,6 +36,7 @@ public:
     bool disconnect();
     bool isNetworkConnected() const;
     NetworkStatus_t getNetworkStatus();
+    bool getNetworkTime(uint32_t& unix_s);  // UTC from AT+CCLK?, false until synced
     
     // GPS operations
     bool enableGPS();
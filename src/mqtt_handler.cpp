@@ -1,4 +1,5 @@
 #include "mqtt_handler.h"
+#include "number_format.h"
 
 MQTTHandler* MQTTHandler::instance = nullptr;
 
@@ -7,8 +8,10 @@ MQTTHandler::MQTTHandler()
       last_connection_attempt(0),
       connection_attempts(0),
       messages_published(0),
+      bytes_published(0),
       last_error(0),
-      batch_mode(false) {
+      replay_rate(0),
+      last_replay(0) {
     instance = this;
 }
 
@@ -77,17 +80,121 @@ void MQTTHandler::loop() {
         handleReconnection();
     }
     client.loop();
+    
+    if (!ring.isActive()) {
+        return;
+    }
+    bool backlog = !ring.isEmpty() || !outbox.isEmpty();
+    if (backlog && client.connected() && (millis() - last_replay) >= OUTBOX_REPLAY_INTERVAL_MS) {
+        replayOutbox();
+        last_replay = millis();
+    }
+    
+    // A long outage moves the RAM queue to flash, bounding what a reset
+    // loses. Alarms are few and small: they stay so they can still go first.
+    if (!client.connected() && ring.getCount(MQTT_CLASS_ALARM) < ring.getCount() &&
+        (millis() - ring.getOldestMs()) >= MQTT_RING_MAX_AGE_MS) {
+        DEBUG_PRINTF("[MQTT] Offline for %lus, moving %u queued bytes to flash\n",
+                    MQTT_RING_MAX_AGE_MS / 1000, ring.getUsedBytes());
+        ring.spillAll(MQTT_CLASS_STATE);
+    }
+    outbox.loop();
+}
+
+bool MQTTHandler::beginOutbox(uint32_t budget_bytes, uint16_t rate) {
+    replay_rate = rate > 0 ? rate : 1;
+    ring.setSpill(spillToOutbox, this);
+    ring.begin();
+    bool stored = outbox.begin(budget_bytes);
+    if (!outbox.isEmpty()) {
+        ring.markAllSpilled();  // Left by the previous run: send that first
+    }
+    return stored;
+}
+
+void MQTTHandler::flushOutbox() {
+    // Alarms stay in RAM, ahead of the flash backlog
+    ring.spillAll(MQTT_CLASS_STATE);
+    outbox.flush();
+}
+
+void MQTTHandler::replayOutbox() {
+    uint32_t burst = (uint32_t)replay_rate * OUTBOX_REPLAY_INTERVAL_MS / 1000;
+    if (burst == 0) burst = 1;
+    if (burst > 0xFFFF) burst = 0xFFFF;
+    
+    // Highest class first. A class that has spilled waits for the flash
+    // backlog, which holds its older messages.
+    uint16_t sent = 0;
+    bool had_backlog = !outbox.isEmpty();
+    if (!had_backlog) ring.clearSpilled();
+    for (int k = MQTT_CLASS_ALARM; k < MQTT_CLASS_COUNT && sent < burst; k++) {
+        MqttClass_t cls = (MqttClass_t)k;
+        if (ring.getCount(cls) == 0) continue;
+        if (ring.isSpilled(cls) && !outbox.isEmpty()) {
+            sent += outbox.replay((uint16_t)(burst - sent), sendReplayed, this);
+            if (!outbox.isEmpty()) break;
+            ring.clearSpilled();
+        }
+        sent += ring.drain((uint16_t)(burst - sent), cls, sendReplayed, this);
+        if (ring.getCount(cls) > 0) break;  // Send failed or burst used up
+    }
+    if (sent < burst && ring.isEmpty() && !outbox.isEmpty()) {
+        sent += outbox.replay((uint16_t)(burst - sent), sendReplayed, this);
+    }
+    
+    if (had_backlog && outbox.isEmpty()) {
+        DEBUG_PRINTF("[MQTT] Outbox drained (%lu messages replayed)\n", outbox.getReplayed());
+    }
+}
+
+bool MQTTHandler::spillToOutbox(void* ctx, const char* topic, const uint8_t* payload,
+                                size_t length, bool retain) {
+    MqttOutbox& outbox = static_cast<MQTTHandler*>(ctx)->outbox;
+    return outbox.isActive() && outbox.push(topic, payload, length, retain);
+}
+
+bool MQTTHandler::sendReplayed(void* ctx, const char* topic, const uint8_t* payload,
+                               size_t length, bool retain) {
+    return static_cast<MQTTHandler*>(ctx)->transmit(topic, payload, length, retain);
 }
 
 bool MQTTHandler::publish(const char* topic, const char* payload, bool retain) {
+    return publish(topic, payload, strlen(payload), retain);
+}
+
+bool MQTTHandler::publish(const char* topic, const char* payload, size_t length, bool retain,
+                          MqttClass_t cls) {
+    return publish(topic, (const uint8_t*)payload, length, retain, cls);
+}
+
+bool MQTTHandler::publish(const char* topic, const uint8_t* payload, size_t length, bool retain,
+                          MqttClass_t cls) {
+    if (publish_observer) {
+        publish_observer(topic, payload, length, retain);
+        return true;  // A replayed trace must not reach the live broker
+    }
+    
+    // Queue behind the backlog; replayOutbox() decides what may overtake
+    if (ring.isActive() && (!client.connected() || !ring.isEmpty() || !outbox.isEmpty())) {
+        return ring.push(topic, payload, length, retain, cls);
+    }
+    
     if (!client.connected()) {
         DEBUG_PRINTF("[MQTT] Not connected, cannot publish to %s\n", topic);
         return false;
     }
-    
-    if (client.publish(topic, payload, retain)) {
+    if (transmit(topic, payload, length, retain)) {
+        return true;
+    }
+    return ring.isActive() && ring.push(topic, payload, length, retain, cls);
+}
+
+bool MQTTHandler::transmit(const char* topic, const uint8_t* payload, size_t length, bool retain) {
+    if (client.publish(topic, payload, length, retain)) {
         messages_published++;
-        DEBUG_PRINTF("[MQTT] Published to %s: %s\n", topic, payload);
+        bytes_published += mqttPacketSize(strlen(topic), length);
+        DEBUG_PRINTF("[MQTT] Published %u bytes to %s\n", (unsigned)length, topic);
         return true;
     }
     
@@ -96,21 +203,24 @@ bool MQTTHandler::publish(const char* topic, const char* payload, bool retain) {
 }
 
 bool MQTTHandler::publish(const char* topic, float value, uint8_t precision, bool retain) {
-    char buffer[32];
-    snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
-    return publish(topic, buffer, retain);
+    char buffer[NUMBER_FORMAT_MAX];
+    size_t length = formatDecimal(buffer, value, precision);
+    return publish(topic, buffer, length, retain);
 }
 
 bool MQTTHandler::publish(const char* topic, int32_t value, bool retain) {
-    char buffer[16];
-    snprintf(buffer, sizeof(buffer), "%ld", value);
-    return publish(topic, buffer, retain);
+    char buffer[NUMBER_FORMAT_MAX];
+    size_t length = 0;
+    if (value < 0) buffer[length++] = '-';
+    uint32_t magnitude = value < 0 ? (uint32_t)0 - (uint32_t)value : (uint32_t)value;
+    length += formatUnsigned(buffer + length, magnitude);
+    return publish(topic, buffer, length, retain);
 }
 
 bool MQTTHandler::publish(const char* topic, uint32_t value, bool retain) {
-    char buffer[16];
-    snprintf(buffer, sizeof(buffer), "%lu", value);
-    return publish(topic, buffer, retain);
+    char buffer[NUMBER_FORMAT_MAX];
+    size_t length = formatUnsigned(buffer, value);
+    return publish(topic, buffer, length, retain);
 }
 
 bool MQTTHandler::publishJSON(const char* topic, const char* json_payload, bool retain) {
@@ -128,21 +238,6 @@ bool MQTTHandler::subscribe(const char* topic) {
     return false;
 }
 
-void MQTTHandler::startBatch() {
-    batch_mode = true;
-    batch_data = "";
-    DEBUG_PRINTLN("[MQTT] Batch mode started");
-}
-
-void MQTTHandler::endBatch() {
-    batch_mode = false;
-    if (batch_data.length() > 0) {
-        publishJSON(MQTT_BASE_TOPIC "/batch", batch_data.c_str(), false);
-    }
-    batch_data = "";
-    DEBUG_PRINTLN("[MQTT] Batch mode ended");
-}
-
 void MQTTHandler::handleReconnection() {
     if (connection_attempts < 5) {
         connect(MQTT_USERNAME, MQTT_PASSWORD);
@@ -156,3 +251,11 @@ void MQTTHandler::messageCallback(char* topic, byte* payload, unsigned int lengt
         DEBUG_PRINTF("[MQTT] Message received on %s\n", topic);
     }
 }
+
+size_t mqttPacketSize(size_t topic_length, size_t payload_length) {
+    // Remaining length: topic length prefix + topic + payload (no packet id at QoS 0)
+    size_t remaining = 2 + topic_length + payload_length;
+    size_t length_bytes = 1;
+    for (size_t r = remaining; r >= 128; r >>= 7) length_bytes++;
+    return 1 + length_bytes + remaining;
+}
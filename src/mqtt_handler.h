@@ -6,6 +6,12 @@
 #include <map>
 #include <functional>
 #include "config.h"
+#include "mqtt_outbox.h"
+#include "mqtt_ring.h"
+
+// Takes every publish request (topic, payload, length, retain) instead of
+// the broker and the queues
+typedef std::function<void(const char*, const uint8_t*, size_t, bool)> PublishObserver;
 
 class MQTTHandler {
 public:
@@ -22,22 +28,41 @@ public:
     bool isConnected() const;
     uint32_t getConnectionAttempts() const { return connection_attempts; }
     uint32_t getMessagesPublished() const { return messages_published; }
+    uint32_t getBytesPublished() const { return bytes_published; }  // Whole PUBLISH packets
     
     // Publish methods
     bool publish(const char* topic, const char* payload, bool retain = false);
+    // Copied straight into the client's packet buffer; the class decides the
+    // order in which queued messages leave after a reconnect
+    bool publish(const char* topic, const char* payload, size_t length, bool retain,
+                 MqttClass_t cls = MQTT_CLASS_TELEMETRY);
+    bool publish(const char* topic, const uint8_t* payload, size_t length, bool retain,
+                 MqttClass_t cls = MQTT_CLASS_TELEMETRY);
     bool publish(const char* topic, float value, uint8_t precision = 2, bool retain = false);
     bool publish(const char* topic, int32_t value, bool retain = false);
     bool publish(const char* topic, uint32_t value, bool retain = false);
     bool publishJSON(const char* topic, const char* json_payload, bool retain = false);
     
+    // Store-and-forward: while disconnected, or while older messages are
+    // still queued, publishes go to the priority RAM queue and count as
+    // accepted; what does not fit there spills to the flash outbox. After
+    // reconnect loop() sends them, highest class first, at replay_rate
+    // messages/s.
+    bool beginOutbox(uint32_t budget_bytes, uint16_t replay_rate);
+    // Before sleep: move queued non-alarm messages to flash and write the
+    // partial page. Call once per idle period, every call costs a page.
+    void flushOutbox();
+    const MqttOutbox& getOutbox() const { return outbox; }
+    const MqttRing& getRing() const { return ring; }
+    
+    // Publish observer (trace replay recording): while set, publishes go to
+    // the observer only and are never sent or queued. nullptr to remove.
+    void setPublishObserver(PublishObserver observer) { publish_observer = observer; }
+    
     // Subscribe methods
     bool subscribe(const char* topic);
     void setMessageCallback(std::function<void(const char*, const byte*, unsigned int)> callback);
     
-    // Batch publishing (for efficient data sending)
-    void startBatch();
-    void endBatch();
-    
     // Reconnection handler
     void handleReconnection();
     
@@ -52,15 +77,28 @@ protected:
     uint32_t last_connection_attempt;
     uint32_t connection_attempts;
     uint32_t messages_published;
+    uint32_t bytes_published;
     uint32_t last_error;
     
-    // Batch mode
-    bool batch_mode;
-    String batch_data;
+    PublishObserver publish_observer;
+    
+    MqttRing ring;
+    MqttOutbox outbox;
+    uint16_t replay_rate;
+    uint32_t last_replay;
     
 private:
     static MQTTHandler* instance;  // For callback routing
     static void messageCallback(char* topic, byte* payload, unsigned int length);
+    bool transmit(const char* topic, const uint8_t* payload, size_t length, bool retain);
+    static bool sendReplayed(void* ctx, const char* topic, const uint8_t* payload,
+                             size_t length, bool retain);
+    static bool spillToOutbox(void* ctx, const char* topic, const uint8_t* payload,
+                              size_t length, bool retain);
+    void replayOutbox();
 };
 
+// Size of an MQTT 3.1.1 QoS 0 PUBLISH packet: fixed header, topic, payload
+size_t mqttPacketSize(size_t topic_length, size_t payload_length);
+
 #endif // MQTT_HANDLER_H
@@ -0,0 +1,318 @@
+#include "mqtt_outbox.h"
+#include "can_capture.h"
+#include <LittleFS.h>
+
+static const uint16_t OUTBOX_CURSOR_MAGIC = 0x434F;  // "OC"
+
+static inline void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void putU32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t getU32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+MqttOutbox::MqttOutbox()
+    : front_used(OUTBOX_HEADER_SIZE), front_count(0), front_opened_ms(0), page_seq(0),
+      oldest_segment(0), write_page(0), cursor_page(0), cursor_record(0), max_segments(2),
+      loaded_page(0), page_loaded(false), read_pos(0), page_count(0), active(false),
+      queued(0), replayed(0), dropped(0), dropped_pages(0), pages_written(0) {}
+
+bool MqttOutbox::begin(uint32_t budget_bytes) {
+    const uint32_t segment_bytes = (uint32_t)OUTBOX_PAGE_SIZE * OUTBOX_SEGMENT_PAGES;
+    max_segments = budget_bytes / segment_bytes;
+    if (max_segments < 2) max_segments = 2;  // One being written, one being replayed
+
+    if (!LittleFS.exists(OUTBOX_DIR) && !LittleFS.mkdir(OUTBOX_DIR)) {
+        DEBUG_PRINTLN("[Outbox] Cannot create " OUTBOX_DIR);
+        return false;
+    }
+
+    uint32_t oldest, next;
+    oldest_segment = 0;
+    write_page = 0;
+    if (CANCapture::findSegments(OUTBOX_DIR, oldest, next)) {
+        oldest_segment = oldest;
+
+        // The newest segment may be partly filled; a torn page closes it
+        char path[32];
+        CANCapture::segmentPath(OUTBOX_DIR, next - 1, path, sizeof(path));
+        File last = LittleFS.open(path, "r");
+        size_t size = last ? last.size() : 0;
+        if (last) last.close();
+        if (size % OUTBOX_PAGE_SIZE != 0) {
+            write_page = next * OUTBOX_SEGMENT_PAGES;
+        } else {
+            write_page = (next - 1) * OUTBOX_SEGMENT_PAGES + size / OUTBOX_PAGE_SIZE;
+        }
+    }
+    loadCursor();
+    resetFront();
+    page_loaded = false;
+    active = true;
+
+    DEBUG_PRINTF("[Outbox] Started: %lu segments x %lu bytes, %lu pages pending\n",
+                max_segments, segment_bytes, getStoredPages());
+    return true;
+}
+
+void MqttOutbox::end() {
+    if (!active) return;
+    flush();
+    saveCursor();  // Keeps a partly sent page from being sent again
+    active = false;
+}
+
+void MqttOutbox::resetFront() {
+    front_used = OUTBOX_HEADER_SIZE;
+    front_count = 0;
+}
+
+bool MqttOutbox::push(const char* topic, const uint8_t* payload, size_t length, bool retain) {
+    size_t topic_length = strlen(topic);
+    size_t record = OUTBOX_RECORD_HEADER + topic_length + length;
+    if (topic_length > 0xFF || record > OUTBOX_MAX_RECORD) {
+        dropped++;
+        return false;
+    }
+
+    if (front_used + record > OUTBOX_PAGE_SIZE && !writeFrontPage()) {
+        dropped += front_count;  // Flash refused the page
+        resetFront();
+    }
+
+    if (front_count == 0) {
+        front_opened_ms = millis();
+    }
+    uint8_t* p = front + front_used;
+    p[0] = (uint8_t)topic_length;
+    p[1] = retain ? OUTBOX_FLAG_RETAIN : 0;
+    putU16(p + 2, (uint16_t)length);
+    memcpy(p + OUTBOX_RECORD_HEADER, topic, topic_length);
+    memcpy(p + OUTBOX_RECORD_HEADER + topic_length, payload, length);
+    front_used += record;
+    front_count++;
+    queued++;
+    return true;
+}
+
+void MqttOutbox::flush() {
+    if (front_count > 0 && !writeFrontPage()) {
+        dropped += front_count;
+        resetFront();
+    }
+}
+
+void MqttOutbox::loop() {
+    if (active && front_count > 0 && (millis() - front_opened_ms) >= OUTBOX_FRONT_MAX_AGE_MS) {
+        flush();
+    }
+}
+
+bool MqttOutbox::writeFrontPage() {
+    if (front_count == 0) return true;
+
+    putU16(front, OUTBOX_MAGIC);
+    front[2] = OUTBOX_VERSION;
+    front[3] = 0;
+    putU16(front + 4, front_used);
+    putU16(front + 6, front_count);
+    putU32(front + 8, page_seq);
+    memset(front + front_used, 0, OUTBOX_PAGE_SIZE - front_used);
+
+    // Starting a segment: make room within the budget first
+    uint32_t segment = write_page / OUTBOX_SEGMENT_PAGES;
+    if (write_page % OUTBOX_SEGMENT_PAGES == 0) {
+        while (segment - oldest_segment >= max_segments) {
+            dropOldestSegment();
+        }
+    }
+
+    char path[32];
+    CANCapture::segmentPath(OUTBOX_DIR, segment, path, sizeof(path));
+    File file = LittleFS.open(path, "a");
+    size_t written = file ? file.write(front, OUTBOX_PAGE_SIZE) : 0;
+    if (file) file.close();
+    if (written != OUTBOX_PAGE_SIZE) {
+        // Continue in a fresh segment so pages stay aligned
+        DEBUG_PRINTF("[Outbox] Page write to %s failed\n", path);
+        write_page = (segment + 1) * OUTBOX_SEGMENT_PAGES;
+        return false;
+    }
+
+    write_page++;
+    pages_written++;
+    page_seq++;
+    resetFront();
+    return true;
+}
+
+void MqttOutbox::dropOldestSegment() {
+    char path[32];
+    CANCapture::segmentPath(OUTBOX_DIR, oldest_segment, path, sizeof(path));
+    LittleFS.remove(path);
+    oldest_segment++;
+
+    uint32_t first_kept = oldest_segment * OUTBOX_SEGMENT_PAGES;
+    if (cursor_page < first_kept) {
+        dropped_pages += first_kept - cursor_page;
+        cursor_page = first_kept;
+        cursor_record = 0;
+        page_loaded = false;
+        saveCursor();
+    }
+    DEBUG_PRINTF("[Outbox] Budget reached, dropped segment %lu\n", oldest_segment - 1);
+}
+
+uint16_t MqttOutbox::replay(uint16_t max_messages, OutboxSender send, void* ctx) {
+    char topic[256];
+    uint16_t sent = 0;
+    uint16_t front_pos = OUTBOX_HEADER_SIZE;
+    uint16_t front_sent = 0;
+
+    while (sent < max_messages) {
+        if (cursor_page < write_page) {
+            // Flash pages first: they are older than anything in RAM
+            if (!loadPage(cursor_page)) {
+                dropped_pages++;
+                advancePage();
+                continue;
+            }
+            if (cursor_record >= page_count) {
+                advancePage();
+                continue;
+            }
+
+            const uint8_t* p = page + read_pos;
+            uint16_t topic_length = p[0];
+            uint16_t length = getU16(p + 2);
+            uint16_t record = OUTBOX_RECORD_HEADER + topic_length + length;
+            if (read_pos + record > getU16(page + 4)) {
+                dropped_pages++;  // Corrupt record: skip the rest of the page
+                advancePage();
+                continue;
+            }
+
+            memcpy(topic, p + OUTBOX_RECORD_HEADER, topic_length);
+            topic[topic_length] = '\0';
+            if (!send(ctx, topic, p + OUTBOX_RECORD_HEADER + topic_length, length,
+                      (p[1] & OUTBOX_FLAG_RETAIN) != 0)) {
+                break;
+            }
+            read_pos += record;
+            cursor_record++;
+        } else if (front_sent < front_count) {
+            const uint8_t* p = front + front_pos;
+            uint16_t topic_length = p[0];
+            uint16_t length = getU16(p + 2);
+
+            memcpy(topic, p + OUTBOX_RECORD_HEADER, topic_length);
+            topic[topic_length] = '\0';
+            if (!send(ctx, topic, p + OUTBOX_RECORD_HEADER + topic_length, length,
+                      (p[1] & OUTBOX_FLAG_RETAIN) != 0)) {
+                break;
+            }
+            front_pos += OUTBOX_RECORD_HEADER + topic_length + length;
+            front_sent++;
+        } else {
+            break;
+        }
+        sent++;
+        replayed++;
+    }
+
+    // Drop the sent records from the RAM page
+    if (front_sent > 0) {
+        memmove(front + OUTBOX_HEADER_SIZE, front + front_pos, front_used - front_pos);
+        front_used -= front_pos - OUTBOX_HEADER_SIZE;
+        front_count -= front_sent;
+    }
+    return sent;
+}
+
+bool MqttOutbox::loadPage(uint32_t page_id) {
+    if (page_loaded && loaded_page == page_id) return true;
+    page_loaded = false;
+
+    char path[32];
+    CANCapture::segmentPath(OUTBOX_DIR, page_id / OUTBOX_SEGMENT_PAGES, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    bool ok = file.seek((page_id % OUTBOX_SEGMENT_PAGES) * OUTBOX_PAGE_SIZE) &&
+              file.read(page, OUTBOX_PAGE_SIZE) == OUTBOX_PAGE_SIZE;
+    file.close();
+    if (!ok || getU16(page) != OUTBOX_MAGIC || page[2] != OUTBOX_VERSION) return false;
+
+    uint16_t used = getU16(page + 4);
+    if (used < OUTBOX_HEADER_SIZE || used > OUTBOX_PAGE_SIZE) return false;
+    page_count = getU16(page + 6);
+
+    // Skip what was sent before a reset
+    read_pos = OUTBOX_HEADER_SIZE;
+    for (uint16_t i = 0; i < cursor_record && i < page_count; i++) {
+        read_pos += OUTBOX_RECORD_HEADER + page[read_pos] + getU16(page + read_pos + 2);
+        if (read_pos > used) return false;
+    }
+    loaded_page = page_id;
+    page_loaded = true;
+    return true;
+}
+
+void MqttOutbox::advancePage() {
+    cursor_page++;
+    cursor_record = 0;
+    page_loaded = false;
+
+    // Segment fully sent: delete it
+    if (cursor_page % OUTBOX_SEGMENT_PAGES == 0) {
+        uint32_t done = cursor_page / OUTBOX_SEGMENT_PAGES - 1;
+        if (done >= oldest_segment) {
+            char path[32];
+            CANCapture::segmentPath(OUTBOX_DIR, done, path, sizeof(path));
+            LittleFS.remove(path);
+            oldest_segment = done + 1;
+        }
+    }
+    saveCursor();
+}
+
+void MqttOutbox::saveCursor() {
+    uint8_t buf[8];
+    putU16(buf, OUTBOX_CURSOR_MAGIC);
+    putU32(buf + 2, cursor_page);
+    putU16(buf + 6, cursor_record);
+    File file = LittleFS.open(OUTBOX_CURSOR_FILE, "w");
+    if (!file) return;
+    file.write(buf, sizeof(buf));
+    file.close();
+}
+
+void MqttOutbox::loadCursor() {
+    cursor_page = oldest_segment * OUTBOX_SEGMENT_PAGES;
+    cursor_record = 0;
+
+    uint8_t buf[8];
+    File file = LittleFS.open(OUTBOX_CURSOR_FILE, "r");
+    if (!file) return;
+    bool ok = file.read(buf, sizeof(buf)) == sizeof(buf);
+    file.close();
+    if (!ok || getU16(buf) != OUTBOX_CURSOR_MAGIC) return;
+
+    // Clamp to the pages that still exist
+    uint32_t saved = getU32(buf + 2);
+    if (saved >= cursor_page && saved <= write_page) {
+        cursor_page = saved;
+        cursor_record = getU16(buf + 6);
+    }
+}
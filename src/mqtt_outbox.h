@@ -0,0 +1,113 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+
+// ============================================================================
+// STORE-AND-FORWARD OUTBOX
+// Publishes that cannot go out are appended to a RAM front page; a full
+// page is written to flash in one piece, so the flash only sees whole
+// OUTBOX_PAGE_SIZE writes. Pages are appended to numbered segment files in
+// OUTBOX_DIR and replayed oldest first.
+//
+// Page layout (little-endian):
+//   header  magic u16 | version u8 | reserved u8 | used_bytes u16 |
+//           record_count u16 | seq u32
+//   records topic_len u8 | flags u8 | payload_len u16 | topic | payload
+// Records never span pages.
+//
+// Pages are numbered linearly (segment = page / OUTBOX_SEGMENT_PAGES). The
+// replay cursor (page, record) is saved to OUTBOX_CURSOR_FILE each time a
+// page has been fully sent, so after a reset at most one page is sent
+// twice. A drained segment is deleted. When the byte budget is exceeded the
+// oldest segment is dropped. A partial RAM page is written once it is
+// OUTBOX_FRONT_MAX_AGE_MS old, which bounds what a reset can lose.
+// ============================================================================
+
+#define OUTBOX_MAGIC 0x4F5A            // "ZO"
+#define OUTBOX_VERSION 1
+#define OUTBOX_HEADER_SIZE 12
+#define OUTBOX_RECORD_HEADER 4
+#define OUTBOX_MAX_RECORD (OUTBOX_PAGE_SIZE - OUTBOX_HEADER_SIZE)  // Header, topic and payload
+#define OUTBOX_FLAG_RETAIN 0x01
+
+// Sends one replayed message; false stops the replay (the record is kept)
+typedef bool (*OutboxSender)(void* ctx, const char* topic, const uint8_t* payload,
+                             size_t length, bool retain);
+
+class MqttOutbox {
+public:
+    MqttOutbox();
+
+    // Recovers the segments and cursor left by a previous run
+    bool begin(uint32_t budget_bytes);
+    void end();
+    bool isActive() const { return active; }
+
+    // Nothing stored in flash or RAM
+    bool isEmpty() const { return front_count == 0 && write_page == cursor_page; }
+
+    // Queue one message; false if it can never fit a page
+    bool push(const char* topic, const uint8_t* payload, size_t length, bool retain);
+
+    // Write a partial front page (e.g. before sleep or power off)
+    void flush();
+    
+    // Writes the front page once it is too old
+    void loop();
+
+    // Send up to max_messages in order; returns the number sent
+    uint16_t replay(uint16_t max_messages, OutboxSender send, void* ctx);
+
+    // Statistics
+    uint32_t getStoredPages() const { return write_page - cursor_page; }
+    uint16_t getFrontCount() const { return front_count; }
+    uint32_t getQueued() const { return queued; }
+    uint32_t getReplayed() const { return replayed; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getDroppedPages() const { return dropped_pages; }
+    uint32_t getPagesWritten() const { return pages_written; }
+
+private:
+    // RAM front page (records not yet in flash)
+    uint8_t front[OUTBOX_PAGE_SIZE];
+    uint16_t front_used;
+    uint16_t front_count;
+    uint32_t front_opened_ms;      // millis() of the oldest RAM record
+    uint32_t page_seq;
+
+    // Flash pages [cursor_page, write_page) are pending
+    uint32_t oldest_segment;       // Oldest segment file still present
+    uint32_t write_page;           // Next page to write
+    uint32_t cursor_page;          // Next page to replay
+    uint16_t cursor_record;        // Records of cursor_page already sent
+    uint32_t max_segments;
+
+    // Page being replayed
+    uint8_t page[OUTBOX_PAGE_SIZE];
+    uint32_t loaded_page;
+    bool page_loaded;
+    uint16_t read_pos;             // Offset of record cursor_record
+    uint16_t page_count;
+
+    bool active;
+
+    // Statistics
+    uint32_t queued;
+    uint32_t replayed;
+    uint32_t dropped;              // Messages that could not be stored
+    uint32_t dropped_pages;        // Pages lost to the budget or corruption
+    uint32_t pages_written;
+
+    bool writeFrontPage();
+    void resetFront();
+    bool loadPage(uint32_t page_id);
+    void advancePage();
+    void dropOldestSegment();
+    void saveCursor();
+    void loadCursor();
+};
+
+#endif // MQTT_OUTBOX_H
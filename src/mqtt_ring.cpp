@@ -0,0 +1,190 @@
+#include "mqtt_ring.h"
+
+// Keep only the latest entry per topic when short of room
+static const bool CLASS_COALESCES[MQTT_CLASS_COUNT] = {false, true, true, false};
+
+static inline void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline bool isLive(const uint8_t* entry) {
+    return (entry[1] & MQTT_RING_FLAG_DEAD) == 0;
+}
+
+static inline const char* entryTopic(const uint8_t* entry) {
+    return (const char*)entry + MQTT_RING_ENTRY_HEADER;
+}
+
+static inline const uint8_t* entryPayload(const uint8_t* entry) {
+    return entry + MQTT_RING_ENTRY_HEADER + entry[2] + 1;
+}
+
+MqttRing::MqttRing()
+    : used(0), entries(0), dead_bytes(0), oldest_ms(0), spilled_classes(0), active(false),
+      spill_sink(nullptr), spill_ctx(nullptr), high_water(0), queued(0), sent_total(0),
+      coalesced(0), spilled(0), dropped(0) {
+    memset(class_count, 0, sizeof(class_count));
+}
+
+uint16_t MqttRing::entrySize(const uint8_t* entry) {
+    return MQTT_RING_ENTRY_HEADER + entry[2] + 1 + getU16(entry + 4);
+}
+
+bool MqttRing::push(const char* topic, const uint8_t* payload, size_t length, bool retain,
+                    MqttClass_t cls) {
+    size_t topic_length = strlen(topic);
+    size_t size = MQTT_RING_ENTRY_HEADER + topic_length + 1 + length;
+    if (topic_length > 0xFF || size > MQTT_RING_BYTES) {
+        return spill(topic, payload, length, retain, cls);
+    }
+    if (used + size > MQTT_RING_BYTES && !makeRoom((uint16_t)size, cls)) {
+        return spill(topic, payload, length, retain, cls);
+    }
+
+    if (entries == 0) {
+        oldest_ms = millis();
+    }
+    uint8_t* entry = buffer + used;
+    entry[0] = (uint8_t)cls;
+    entry[1] = retain ? MQTT_RING_FLAG_RETAIN : 0;
+    entry[2] = (uint8_t)topic_length;
+    entry[3] = 0;
+    putU16(entry + 4, (uint16_t)length);
+    memcpy(entry + MQTT_RING_ENTRY_HEADER, topic, topic_length + 1);
+    memcpy(entry + MQTT_RING_ENTRY_HEADER + topic_length + 1, payload, length);
+
+    used += size;
+    entries++;
+    class_count[cls]++;
+    queued++;
+    if (used > high_water) high_water = used;
+    return true;
+}
+
+uint16_t MqttRing::drain(uint16_t max_messages, MqttClass_t cls, OutboxSender send, void* ctx) {
+    uint16_t sent = 0;
+    uint16_t pos = 0;
+    while (pos < used && class_count[cls] > 0 && sent < max_messages) {
+        uint8_t* entry = buffer + pos;
+        pos += entrySize(entry);
+        if (!isLive(entry) || entry[0] != cls) continue;
+
+        if (!send(ctx, entryTopic(entry), entryPayload(entry), getU16(entry + 4),
+                  (entry[1] & MQTT_RING_FLAG_RETAIN) != 0)) {
+            break;
+        }
+        kill(entry);
+        sent++;
+        sent_total++;
+    }
+
+    compact();
+    return sent;
+}
+
+void MqttRing::spillAll(MqttClass_t from) {
+    uint16_t pos = 0;
+    while (pos < used) {
+        uint8_t* entry = buffer + pos;
+        pos += entrySize(entry);
+        if (isLive(entry) && entry[0] >= from) spillEntry(entry);
+    }
+    compact();
+    oldest_ms = millis();
+}
+
+void MqttRing::kill(uint8_t* entry) {
+    entry[1] |= MQTT_RING_FLAG_DEAD;
+    entries--;
+    class_count[entry[0]]--;
+    dead_bytes += entrySize(entry);
+}
+
+void MqttRing::compact() {
+    if (dead_bytes == 0) return;
+
+    uint16_t read = 0;
+    uint16_t write = 0;
+    while (read < used) {
+        uint16_t size = entrySize(buffer + read);
+        if (isLive(buffer + read)) {
+            if (write != read) memmove(buffer + write, buffer + read, size);
+            write += size;
+        }
+        read += size;
+    }
+    used = write;
+    dead_bytes = 0;
+}
+
+void MqttRing::coalesce(MqttClass_t cls) {
+    if (class_count[cls] < 2) return;
+
+    for (uint16_t pos = 0; pos < used; pos += entrySize(buffer + pos)) {
+        uint8_t* entry = buffer + pos;
+        if (!isLive(entry) || entry[0] != cls) continue;
+
+        // Superseded if a newer entry of the class has the same topic
+        for (uint16_t later = pos + entrySize(entry); later < used;
+             later += entrySize(buffer + later)) {
+            const uint8_t* other = buffer + later;
+            if (isLive(other) && other[0] == cls && other[2] == entry[2] &&
+                memcmp(entryTopic(other), entryTopic(entry), entry[2]) == 0) {
+                kill(entry);
+                coalesced++;
+                break;
+            }
+        }
+    }
+}
+
+bool MqttRing::spill(const char* topic, const uint8_t* payload, size_t length, bool retain,
+                     MqttClass_t cls) {
+    if (spill_sink && spill_sink(spill_ctx, topic, payload, length, retain)) {
+        spilled++;
+        spilled_classes |= 1 << cls;
+        return true;
+    }
+    dropped++;
+    return false;
+}
+
+bool MqttRing::spillEntry(uint8_t* entry) {
+    bool stored = spill(entryTopic(entry), entryPayload(entry), getU16(entry + 4),
+                        (entry[1] & MQTT_RING_FLAG_RETAIN) != 0, (MqttClass_t)entry[0]);
+    kill(entry);
+    return stored;
+}
+
+bool MqttRing::spillOldest(MqttClass_t cls) {
+    if (class_count[cls] == 0) return false;
+
+    for (uint16_t pos = 0; pos < used; pos += entrySize(buffer + pos)) {
+        uint8_t* entry = buffer + pos;
+        if (!isLive(entry) || entry[0] != cls) continue;
+        spillEntry(entry);
+        return true;
+    }
+    return false;
+}
+
+bool MqttRing::makeRoom(uint16_t needed, MqttClass_t cls) {
+    // Cheapest first: superseded values cost nothing to lose
+    for (int k = cls; k < MQTT_CLASS_COUNT; k++) {
+        if (CLASS_COALESCES[k]) coalesce((MqttClass_t)k);
+    }
+
+    // Then spill, lowest class and oldest entry first
+    for (int k = MQTT_CLASS_COUNT - 1; k >= (int)cls; k--) {
+        while (used - dead_bytes + needed > MQTT_RING_BYTES && spillOldest((MqttClass_t)k)) {
+        }
+    }
+
+    compact();
+    return used + needed <= MQTT_RING_BYTES;
+}
@@ -0,0 +1,119 @@
+#ifndef MQTT_RING_H
+#define MQTT_RING_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "mqtt_outbox.h"
+
+// ============================================================================
+// PRIORITY RAM QUEUE
+// Publishes that cannot go out right away wait here, in front of the flash
+// outbox, so a short disconnect costs no flash writes. Each message has a
+// class; after reconnect the highest class is sent first.
+//
+// Messages are kept in arrival order in one fixed buffer:
+//   class u8 | flags u8 | topic_len u8 | reserved u8 | payload_len u16 |
+//   topic '\0' | payload
+// Sent or superseded entries are marked dead and squeezed out when the
+// buffer is compacted.
+//
+// When a message does not fit, room is made from its own class and below:
+//   1. STATE and TELEMETRY keep only the latest entry per topic (ALARM and
+//      BULK never coalesce: every alarm, batch and history block is distinct)
+//   2. the oldest entries are spilled, lowest class first
+// If that is not enough the new message itself is spilled. Spilled
+// messages go to the spill sink (the flash outbox); without one they are
+// dropped.
+//
+// A topic always has the same class, so draining class by class keeps
+// every topic in order, except against copies already in flash. The queue
+// therefore remembers which classes have spilled: those wait until the
+// flash backlog is sent (see MQTTHandler::replayOutbox).
+// ============================================================================
+
+typedef enum {
+    MQTT_CLASS_ALARM = 0,          // Critical transitions (plug, faults, trip/charge start/end)
+    MQTT_CLASS_STATE,              // Retained state (dictionary, cells, live charge)
+    MQTT_CLASS_TELEMETRY,          // Periodic signal values
+    MQTT_CLASS_BULK,               // Batches, history, diagnostics, trip/charge records
+    MQTT_CLASS_COUNT
+} MqttClass_t;
+
+#define MQTT_RING_ENTRY_HEADER 6
+#define MQTT_RING_FLAG_RETAIN 0x01
+#define MQTT_RING_FLAG_DEAD 0x02
+
+class MqttRing {
+public:
+    MqttRing();
+
+    void begin() { active = true; }
+    bool isActive() const { return active; }
+
+    // Where spilled messages go; false from the sink counts as a drop
+    void setSpill(OutboxSender sink, void* ctx) { spill_sink = sink; spill_ctx = ctx; }
+
+    bool isEmpty() const { return entries == 0; }
+    uint16_t getCount() const { return entries; }
+    uint16_t getCount(MqttClass_t cls) const { return class_count[cls]; }
+
+    // Queue one message; false only if it had to be dropped
+    bool push(const char* topic, const uint8_t* payload, size_t length, bool retain,
+              MqttClass_t cls);
+
+    // Send up to max_messages of one class, oldest first; stops at the
+    // first failed send
+    uint16_t drain(uint16_t max_messages, MqttClass_t cls, OutboxSender send, void* ctx);
+
+    // Spill classes from..BULK in arrival order (e.g. everything before sleep)
+    void spillAll(MqttClass_t from = MQTT_CLASS_ALARM);
+
+    // Some messages of the class went to flash since the last clearSpilled()
+    bool isSpilled(MqttClass_t cls) const { return (spilled_classes & (1 << cls)) != 0; }
+    void markAllSpilled() { spilled_classes = (1 << MQTT_CLASS_COUNT) - 1; }
+    void clearSpilled() { spilled_classes = 0; }
+
+    // millis() when the queue last filled from empty or was spilled
+    uint32_t getOldestMs() const { return oldest_ms; }
+
+    // Statistics
+    uint16_t getUsedBytes() const { return used; }
+    uint16_t getHighWater() const { return high_water; }
+    uint32_t getQueued() const { return queued; }
+    uint32_t getSent() const { return sent_total; }
+    uint32_t getCoalesced() const { return coalesced; }
+    uint32_t getSpilled() const { return spilled; }
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    uint8_t buffer[MQTT_RING_BYTES];
+    uint16_t used;
+    uint16_t entries;                  // Live entries
+    uint16_t class_count[MQTT_CLASS_COUNT];
+    uint16_t dead_bytes;               // Dead entries not yet compacted
+    uint32_t oldest_ms;
+    uint8_t spilled_classes;           // Bit per class
+    bool active;
+
+    OutboxSender spill_sink;
+    void* spill_ctx;
+
+    uint16_t high_water;
+    uint32_t queued;
+    uint32_t sent_total;
+    uint32_t coalesced;
+    uint32_t spilled;
+    uint32_t dropped;
+
+    static uint16_t entrySize(const uint8_t* entry);
+    void kill(uint8_t* entry);
+    void compact();
+    void coalesce(MqttClass_t cls);
+    bool spill(const char* topic, const uint8_t* payload, size_t length, bool retain,
+               MqttClass_t cls);
+    bool spillEntry(uint8_t* entry);
+    bool spillOldest(MqttClass_t cls);
+    bool makeRoom(uint16_t needed, MqttClass_t cls);
+};
+
+#endif // MQTT_RING_H
@@ -0,0 +1,107 @@
+#include "msgpack_writer.h"
+#include <string.h>
+
+MsgPackWriter::MsgPackWriter(uint8_t* buffer, size_t cap)
+    : buf(buffer), capacity(cap), len(0), overflow(false) {}
+
+void MsgPackWriter::put(uint8_t byte) {
+    if (len >= capacity) {
+        overflow = true;
+        return;
+    }
+    buf[len++] = byte;
+}
+
+void MsgPackWriter::putBig(uint64_t value, uint8_t bytes) {
+    while (bytes > 0) {
+        bytes--;
+        put((uint8_t)(value >> (bytes * 8)));
+    }
+}
+
+void MsgPackWriter::writeNil() {
+    put(0xC0);
+}
+
+void MsgPackWriter::writeBool(bool value) {
+    put(value ? 0xC3 : 0xC2);
+}
+
+void MsgPackWriter::writeUint(uint64_t value) {
+    if (value < 0x80) {
+        put((uint8_t)value);                    // positive fixint
+    } else if (value <= 0xFF) {
+        put(0xCC); putBig(value, 1);
+    } else if (value <= 0xFFFF) {
+        put(0xCD); putBig(value, 2);
+    } else if (value <= 0xFFFFFFFFULL) {
+        put(0xCE); putBig(value, 4);
+    } else {
+        put(0xCF); putBig(value, 8);
+    }
+}
+
+void MsgPackWriter::writeInt(int64_t value) {
+    if (value >= 0) {
+        writeUint((uint64_t)value);
+    } else if (value >= -32) {
+        put((uint8_t)(int8_t)value);            // negative fixint
+    } else if (value >= INT8_MIN) {
+        put(0xD0); putBig((uint64_t)value, 1);
+    } else if (value >= INT16_MIN) {
+        put(0xD1); putBig((uint64_t)value, 2);
+    } else if (value >= INT32_MIN) {
+        put(0xD2); putBig((uint64_t)value, 4);
+    } else {
+        put(0xD3); putBig((uint64_t)value, 8);
+    }
+}
+
+void MsgPackWriter::writeStr(const char* str, size_t str_len) {
+    if (str_len < 32) {
+        put(0xA0 | (uint8_t)str_len);
+    } else if (str_len <= 0xFF) {
+        put(0xD9); putBig(str_len, 1);
+    } else {
+        put(0xDA); putBig(str_len, 2);
+    }
+    if (len + str_len > capacity) {
+        overflow = true;
+        return;
+    }
+    memcpy(buf + len, str, str_len);
+    len += str_len;
+}
+
+void MsgPackWriter::writeArrayHeader(uint32_t count) {
+    if (count < 16) {
+        put(0x90 | (uint8_t)count);
+    } else if (count <= 0xFFFF) {
+        put(0xDC); putBig(count, 2);
+    } else {
+        put(0xDD); putBig(count, 4);
+    }
+}
+
+void MsgPackWriter::writeMapHeader(uint32_t count) {
+    if (count < 16) {
+        put(0x80 | (uint8_t)count);
+    } else if (count <= 0xFFFF) {
+        put(0xDE); putBig(count, 2);
+    } else {
+        put(0xDF); putBig(count, 4);
+    }
+}
+
+size_t MsgPackWriter::beginMap16() {
+    size_t pos = len;
+    put(0xDE);
+    putBig(0, 2);
+    return pos;
+}
+
+void MsgPackWriter::endMap16(size_t header_pos, uint16_t count) {
+    if (header_pos + 3 > len) return;
+    buf[header_pos + 1] = (uint8_t)(count >> 8);
+    buf[header_pos + 2] = (uint8_t)count;
+}
@@ -0,0 +1,39 @@
+#ifndef MSGPACK_WRITER_H
+#define MSGPACK_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Minimal MessagePack encoder into a caller-owned buffer. Integers use the
+// smallest encoding that holds them. Writing past the end sets overflowed()
+// and drops the rest, so callers check once at the end.
+class MsgPackWriter {
+public:
+    MsgPackWriter(uint8_t* buffer, size_t capacity);
+
+    void writeNil();
+    void writeBool(bool value);
+    void writeUint(uint64_t value);
+    void writeInt(int64_t value);
+    void writeStr(const char* str, size_t len);
+    void writeArrayHeader(uint32_t count);
+    void writeMapHeader(uint32_t count);
+
+    // Map whose size is only known afterwards: reserve a map16 header
+    size_t beginMap16();
+    void endMap16(size_t header_pos, uint16_t count);
+
+    size_t length() const { return len; }
+    bool overflowed() const { return overflow; }
+
+private:
+    uint8_t* buf;
+    size_t capacity;
+    size_t len;
+    bool overflow;
+
+    void put(uint8_t byte);
+    void putBig(uint64_t value, uint8_t bytes);
+};
+
+#endif // MSGPACK_WRITER_H
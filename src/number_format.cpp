@@ -0,0 +1,51 @@
+#include "number_format.h"
+#include <math.h>
+#include <string.h>
+
+static const uint64_t POW10[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL};
+
+size_t formatUnsigned(char* out, uint64_t value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    out[count] = '\0';
+    return count;
+}
+
+size_t formatDecimal(char* out, double value, uint8_t decimals) {
+    if (isnan(value) || isinf(value)) {
+        memcpy(out, "nan", 4);
+        return 3;
+    }
+    if (decimals > 6) decimals = 6;
+
+    size_t len = 0;
+    if (value < 0) {
+        value = -value;
+        if (value * POW10[decimals] >= 0.5) out[len++] = '-';  // No "-0.00"
+    }
+    if (value >= 1e15) decimals = 0;
+
+    uint64_t scaled = (uint64_t)(value * POW10[decimals] + 0.5);
+    uint64_t whole = scaled / POW10[decimals];
+    uint64_t fraction = scaled % POW10[decimals];
+
+    len += formatUnsigned(out + len, whole);
+    if (decimals > 0) {
+        out[len++] = '.';
+        for (uint8_t d = decimals; d > 0; d--) {
+            out[len + d - 1] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        len += decimals;
+        out[len] = '\0';
+    }
+    return len;
+}
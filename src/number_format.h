@@ -0,0 +1,19 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Allocation-free number formatting for publish payloads (no printf).
+// Both write a NUL terminator and return the length without it; out needs
+// NUMBER_FORMAT_MAX bytes.
+
+#define NUMBER_FORMAT_MAX 32
+
+size_t formatUnsigned(char* out, uint64_t value);
+
+// Fixed-point with rounding, e.g. (-3.14159, 2) -> "-3.14"; "nan" for
+// NaN/infinity. Values beyond +/-1e15 lose their fraction digits.
+size_t formatDecimal(char* out, double value, uint8_t decimals);
+
+#endif // NUMBER_FORMAT_H
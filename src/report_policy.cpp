@@ -0,0 +1,58 @@
+#include "report_policy.h"
+#include <math.h>
+
+static double deadband(const ReportPolicy_t& policy, const ReportState_t& state) {
+    double threshold = fabs(state.last_value) * policy.rel_deadband;
+    return policy.abs_deadband > threshold ? policy.abs_deadband : threshold;
+}
+
+static bool isOnOff(const ReportState_t& state, double value) {
+    return (value == 0.0) != (state.last_value == 0.0);
+}
+
+ReportReason_t reportEvaluate(const ReportPolicy_t& policy, ReportState_t& state,
+                              double value, uint32_t now_ms) {
+    ReportReason_t reason = REPORT_SUPPRESS;
+
+    if (!state.has_published) {
+        reason = REPORT_FIRST;
+    } else {
+        uint32_t elapsed = now_ms - state.last_published_ms;
+        if (reportIsUrgent(policy, state, value)) {
+            reason = REPORT_CHANGE;
+        } else if (policy.priority != REPORT_PRIORITY_CRITICAL &&
+                   reportIsChange(policy, state, value) && elapsed >= policy.min_spacing_ms) {
+            reason = REPORT_CHANGE;
+        }
+
+        if (reason == REPORT_SUPPRESS && policy.max_silence_ms > 0 &&
+            elapsed >= policy.max_silence_ms) {
+            reason = REPORT_HEARTBEAT;
+        }
+    }
+
+    if (reason != REPORT_SUPPRESS) {
+        state.last_value = value;
+        state.last_published_ms = now_ms;
+        state.has_published = true;
+    }
+    return reason;
+}
+
+bool reportIsChange(const ReportPolicy_t& policy, const ReportState_t& state, double value) {
+    if (!state.has_published) return true;
+    double change = fabs(value - state.last_value);
+    return change > 0.0 && change >= deadband(policy, state);
+}
+
+bool reportIsUrgent(const ReportPolicy_t& policy, const ReportState_t& state, double value) {
+    if (!state.has_published) return false;
+    if (policy.priority == REPORT_PRIORITY_CRITICAL) return value != state.last_value;
+    return isOnOff(state, value) && reportIsChange(policy, state, value);
+}
+
+void reportReset(ReportState_t& state) {
+    state.last_value = 0;
+    state.last_published_ms = 0;
+    state.has_published = false;
+}
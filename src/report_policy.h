@@ -0,0 +1,55 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdint.h>
+
+// ============================================================================
+// REPORT BY EXCEPTION
+// Decides per decoded value whether a signal is published:
+//   - a change beyond the deadband (max of absolute and relative-to-last)
+//     is published once min_spacing_ms has passed since the last publish
+//   - an unchanged value is re-sent after max_silence_ms as a heartbeat
+//   - a change to or from zero skips the spacing (e.g. charging starts)
+//   - critical signals publish every change immediately, ignoring spacing
+// The deadband is measured against the last *published* value, so slow
+// drift still gets reported once it adds up.
+// ============================================================================
+
+typedef enum {
+    REPORT_PRIORITY_NORMAL = 0,
+    REPORT_PRIORITY_CRITICAL       // State transitions: no spacing, no deadband
+} ReportPriority_t;
+
+typedef enum {
+    REPORT_SUPPRESS = 0,
+    REPORT_FIRST,                  // No value published yet
+    REPORT_CHANGE,                 // Outside the deadband
+    REPORT_HEARTBEAT               // max_silence_ms elapsed
+} ReportReason_t;
+
+typedef struct {
+    double abs_deadband;           // Minimum change in signal units
+    float rel_deadband;            // Minimum change as a fraction of the last value
+    uint32_t min_spacing_ms;       // Rate limit between publishes
+    uint32_t max_silence_ms;       // Heartbeat period, 0 = never
+    ReportPriority_t priority;
+} ReportPolicy_t;
+
+typedef struct {
+    double last_value;             // Last published value
+    uint32_t last_published_ms;
+    bool has_published;
+} ReportState_t;
+
+// Evaluate a new value; on a publish decision the state is updated
+ReportReason_t reportEvaluate(const ReportPolicy_t& policy, ReportState_t& state,
+                              double value, uint32_t now_ms);
+
+void reportReset(ReportState_t& state);
+
+// Time-independent checks for the decode path: would the value count as a
+// change, and may it skip the spacing (critical change or to/from zero)?
+bool reportIsChange(const ReportPolicy_t& policy, const ReportState_t& state, double value);
+bool reportIsUrgent(const ReportPolicy_t& policy, const ReportState_t& state, double value);
+
+#endif // REPORT_POLICY_H
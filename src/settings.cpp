@@ -84,6 +84,12 @@ bool SettingsManager::load() {
         if (mqtt["publish_interval_mid"]) settings.mqtt.publish_interval_mid = mqtt["publish_interval_mid"];
         if (mqtt["publish_interval_slow"]) settings.mqtt.publish_interval_slow = mqtt["publish_interval_slow"];
         if (mqtt["reconnect_interval"]) settings.mqtt.reconnect_interval = mqtt["reconnect_interval"];
+        if (mqtt["window_summaries"]) settings.mqtt.window_summaries = mqtt["window_summaries"];
+        if (mqtt["batch_enabled"]) settings.mqtt.batch_enabled = mqtt["batch_enabled"];
+        if (mqtt["batch_max_bytes"]) settings.mqtt.batch_max_bytes = mqtt["batch_max_bytes"];
+        if (mqtt["batch_deadline_ms"]) settings.mqtt.batch_deadline_ms = mqtt["batch_deadline_ms"];
+        if (mqtt["binary_batches"]) settings.mqtt.binary_batches = mqtt["binary_batches"];
+        if (mqtt["history_enabled"]) settings.mqtt.history_enabled = mqtt["history_enabled"];
     }
     
     // Parse CAN settings
@@ -131,6 +137,31 @@ bool SettingsManager::load() {
         if (simulator["vary_values"]) settings.simulator.vary_values = simulator["vary_values"];
     }
     
+    // Parse Capture settings
+    if (doc["capture"].is<JsonObject>()) {
+        auto capture = doc["capture"];
+        if (capture["enabled"]) settings.capture.enabled = capture["enabled"];
+        if (capture["budget_bytes"]) settings.capture.budget_bytes = capture["budget_bytes"];
+        if (capture["segment_bytes"]) settings.capture.segment_bytes = capture["segment_bytes"];
+    }
+    
+    // Parse Outbox settings
+    if (doc["outbox"].is<JsonObject>()) {
+        auto outbox = doc["outbox"];
+        if (!outbox["enabled"].isNull()) settings.outbox.enabled = outbox["enabled"];
+        if (outbox["budget_bytes"]) settings.outbox.budget_bytes = outbox["budget_bytes"];
+        if (outbox["replay_rate"]) settings.outbox.replay_rate = outbox["replay_rate"];
+    }
+    
+    // Parse Replay settings
+    if (doc["replay"].is<JsonObject>()) {
+        auto replay = doc["replay"];
+        if (replay["enabled"]) settings.replay.enabled = replay["enabled"];
+        if (replay["path"]) strlcpy(settings.replay.path, replay["path"], sizeof(settings.replay.path));
+        if (replay["realtime"]) settings.replay.realtime = replay["realtime"];
+        if (!replay["record_output"].isNull()) settings.replay.record_output = replay["record_output"];
+    }
+    
     if (doc["version"]) settings.version = doc["version"];
     if (doc["last_modified"]) settings.last_modified = doc["last_modified"];
     
@@ -154,6 +185,12 @@ bool SettingsManager::save() {
     doc["mqtt"]["publish_interval_mid"] = settings.mqtt.publish_interval_mid;
     doc["mqtt"]["publish_interval_slow"] = settings.mqtt.publish_interval_slow;
     doc["mqtt"]["reconnect_interval"] = settings.mqtt.reconnect_interval;
+    doc["mqtt"]["window_summaries"] = settings.mqtt.window_summaries;
+    doc["mqtt"]["batch_enabled"] = settings.mqtt.batch_enabled;
+    doc["mqtt"]["batch_max_bytes"] = settings.mqtt.batch_max_bytes;
+    doc["mqtt"]["batch_deadline_ms"] = settings.mqtt.batch_deadline_ms;
+    doc["mqtt"]["binary_batches"] = settings.mqtt.binary_batches;
+    doc["mqtt"]["history_enabled"] = settings.mqtt.history_enabled;
     
     // Build CAN section
     doc["can"]["speed_high"] = settings.can.speed_high;
@@ -185,6 +222,22 @@ bool SettingsManager::save() {
     doc["simulator"]["update_interval_ms"] = settings.simulator.update_interval_ms;
     doc["simulator"]["vary_values"] = settings.simulator.vary_values;
     
+    // Build Capture section
+    doc["capture"]["enabled"] = settings.capture.enabled;
+    doc["capture"]["budget_bytes"] = settings.capture.budget_bytes;
+    doc["capture"]["segment_bytes"] = settings.capture.segment_bytes;
+    
+    // Build Outbox section
+    doc["outbox"]["enabled"] = settings.outbox.enabled;
+    doc["outbox"]["budget_bytes"] = settings.outbox.budget_bytes;
+    doc["outbox"]["replay_rate"] = settings.outbox.replay_rate;
+    
+    // Build Replay section
+    doc["replay"]["enabled"] = settings.replay.enabled;
+    doc["replay"]["path"] = settings.replay.path;
+    doc["replay"]["realtime"] = settings.replay.realtime;
+    doc["replay"]["record_output"] = settings.replay.record_output;
+    
     // Metadata
     doc["version"] = settings.version;
     doc["last_modified"] = millis();
@@ -272,6 +325,21 @@ void SettingsManager::setSimulatorSettings(const SimulatorSettings& simulator) {
     save();
 }
 
+void SettingsManager::setCaptureSettings(const CaptureSettings& capture) {
+    settings.capture = capture;
+    save();
+}
+
+void SettingsManager::setOutboxSettings(const OutboxSettings& outbox) {
+    settings.outbox = outbox;
+    save();
+}
+
+void SettingsManager::setReplaySettings(const ReplaySettings& replay) {
+    settings.replay = replay;
+    save();
+}
+
 void SettingsManager::exportToJSON(JsonDocument& doc) const {
     doc["mqtt"]["broker"] = settings.mqtt.broker;
     doc["mqtt"]["port"] = settings.mqtt.port;
@@ -304,6 +372,12 @@ void SettingsManager::debugPrint() const {
     DEBUG_PRINTF("Debug Enabled: %s\n", settings.debug.enabled ? "YES" : "NO");
     DEBUG_PRINTF("Simulator Enabled: %s\n", settings.simulator.enabled ? "YES" : "NO");
     DEBUG_PRINTF("Simulator Update Interval: %u ms\n", settings.simulator.update_interval_ms);
+    DEBUG_PRINTF("Capture Enabled: %s (budget %u bytes)\n",
+                settings.capture.enabled ? "YES" : "NO", settings.capture.budget_bytes);
+    DEBUG_PRINTF("Outbox Enabled: %s (budget %u bytes)\n",
+                settings.outbox.enabled ? "YES" : "NO", settings.outbox.budget_bytes);
+    DEBUG_PRINTF("Replay Enabled: %s (%s)\n",
+                settings.replay.enabled ? "YES" : "NO", settings.replay.path);
     DEBUG_PRINTLN("============================\n");
 }
 
@@ -24,6 +24,12 @@ public:
         uint32_t publish_interval_mid = 300000UL;     // 5 minutes
         uint32_t publish_interval_slow = 3600000UL;   // 60 minutes
         uint32_t reconnect_interval = 10000UL;         // 10 seconds
+        bool window_summaries = false;                 // JSON min/max/mean/last/count per publish
+        bool batch_enabled = false;                    // Coalesce signals per interval class
+        uint16_t batch_max_bytes = 1024;               // Size cap of one batch payload
+        uint32_t batch_deadline_ms = 2000UL;           // Flush deadline after the first value
+        bool binary_batches = false;                   // MessagePack batches + signal dictionary
+        bool history_enabled = false;                  // Gorilla-compressed per-signal history
     };
 
     // CAN Bus Settings
@@ -66,6 +72,28 @@ public:
         bool vary_values = true;           // Randomize values
     };
 
+    // Binary CAN capture to LittleFS (for offline analysis)
+    struct CaptureSettings {
+        bool enabled = false;
+        uint32_t budget_bytes = 524288UL;  // Total size of all segments (512 KB)
+        uint32_t segment_bytes = 65536UL;  // Size of one segment file (64 KB)
+    };
+
+    // Store-and-forward of publishes while the broker is unreachable
+    struct OutboxSettings {
+        bool enabled = true;
+        uint32_t budget_bytes = 262144UL;  // Flash used by queued messages (256 KB)
+        uint16_t replay_rate = 20;         // Messages per second after reconnect
+    };
+
+    // Trace replay from LittleFS instead of the live bus
+    struct ReplaySettings {
+        bool enabled = false;
+        char path[64] = "/capture";       // Capture directory, candump log or .asc file
+        bool realtime = false;            // Keep recorded frame spacing
+        bool record_output = true;        // Write the publish stream to LittleFS
+    };
+
     // Complete Settings Structure
     struct Settings {
         MQTTSettings mqtt;
@@ -74,6 +102,9 @@ public:
         PowerSettings power;
         DebugSettings debug;
         SimulatorSettings simulator;  // NEW: Simulator configuration
+        CaptureSettings capture;
+        OutboxSettings outbox;
+        ReplaySettings replay;
         uint32_t version = 1;
         uint32_t last_modified = 0;
     };
@@ -158,6 +189,21 @@ public:
      */
     void setSimulatorSettings(const SimulatorSettings& simulator);
 
+    /**
+     * Update Capture settings
+     */
+    void setCaptureSettings(const CaptureSettings& capture);
+
+    /**
+     * Update Outbox settings
+     */
+    void setOutboxSettings(const OutboxSettings& outbox);
+
+    /**
+     * Update Replay settings
+     */
+    void setReplaySettings(const ReplaySettings& replay);
+
     /**
      * Export settings as JSON document
      * @param doc ArduinoJson document to fill
@@ -0,0 +1,57 @@
+#ifndef SIGNAL_EXTRACTOR_H
+#define SIGNAL_EXTRACTOR_H
+
+#include <stdint.h>
+#include <string.h>
+
+// ============================================================================
+// CAN SIGNAL EXTRACTION
+// Shift-and-mask decoding of little-endian (Intel) signals from a CAN payload.
+// The payload is loaded once as a 64-bit word; bytes beyond the DLC read as 0.
+// ============================================================================
+
+namespace SignalCodec {
+
+    // Mask with the lowest bit_length bits set (bit_length 1..64)
+    constexpr uint64_t bitMask(uint8_t bit_length) {
+        return (bit_length >= 64) ? ~0ULL : ((1ULL << bit_length) - 1ULL);
+    }
+
+    // Load up to 8 data bytes as a little-endian 64-bit word
+    inline uint64_t loadPayload(const uint8_t* data, uint8_t dlc) {
+        uint64_t word = 0;
+        uint8_t len = (dlc < 8) ? dlc : 8;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        memcpy(&word, data, len);
+#else
+        for (uint8_t i = 0; i < len; i++) {
+            word |= (uint64_t)data[i] << (8 * i);
+        }
+#endif
+        return word;
+    }
+
+    // Two's complement sign extension of a bit_length-wide raw value
+    inline int64_t signExtend(uint64_t raw, uint8_t bit_length) {
+        if (bit_length >= 64) return (int64_t)raw;
+        uint64_t sign_bit = 1ULL << (bit_length - 1);
+        return (int64_t)((raw ^ sign_bit) - sign_bit);
+    }
+
+    // Generic runtime extraction from an already loaded payload word
+    inline int64_t extractRaw(uint64_t payload, uint8_t start_bit, uint8_t bit_length,
+                              bool is_signed) {
+        if (start_bit >= 64) return 0;
+        uint64_t raw = (payload >> start_bit) & bitMask(bit_length);
+        return is_signed ? signExtend(raw, bit_length) : (int64_t)raw;
+    }
+
+    // Extraction straight from a payload (single lookups; decode plans load
+    // the payload once for all signals of a frame)
+    inline int64_t extractRaw(const uint8_t* data, uint8_t dlc, uint8_t start_bit,
+                              uint8_t bit_length, bool is_signed) {
+        return extractRaw(loadPayload(data, dlc), start_bit, bit_length, is_signed);
+    }
+}
+
+#endif // SIGNAL_EXTRACTOR_H
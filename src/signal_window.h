@@ -0,0 +1,41 @@
+#ifndef SIGNAL_WINDOW_H
+#define SIGNAL_WINDOW_H
+
+#include <stdint.h>
+
+// Streaming min/max/mean/last/count of one signal between two publishes.
+// Updated for every decoded value: constant time, no allocation.
+typedef struct {
+    double min;
+    double max;
+    double sum;
+    double last;
+    uint32_t count;
+} SignalWindow_t;
+
+inline void windowReset(SignalWindow_t& window) {
+    window.min = 0;
+    window.max = 0;
+    window.sum = 0;
+    window.last = 0;
+    window.count = 0;
+}
+
+inline void windowAdd(SignalWindow_t& window, double value) {
+    if (window.count == 0) {
+        window.min = value;
+        window.max = value;
+    } else {
+        if (value < window.min) window.min = value;
+        if (value > window.max) window.max = value;
+    }
+    window.sum += value;
+    window.last = value;
+    window.count++;
+}
+
+inline double windowMean(const SignalWindow_t& window) {
+    return window.count > 0 ? window.sum / window.count : 0.0;
+}
+
+#endif // SIGNAL_WINDOW_H
@@ -0,0 +1,70 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-size, lock-free single-producer/single-consumer ring buffer.
+// The producer (e.g. the CAN RX task) only writes head, the consumer only
+// writes tail; indices run freely and wrap through a power-of-two mask.
+// Only plain atomic loads/stores are used, so it also works on cores
+// without atomic read-modify-write instructions (ESP32-C3).
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+    
+public:
+    SpscRing() : head(0), tail(0), drops(0), high_water(0) {}
+    
+    // Producer side: returns false (and counts a drop) when full
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if ((h - t) >= N) {
+            drops.store(drops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        
+        uint32_t used = h + 1 - t;
+        if (used > high_water.load(std::memory_order_relaxed)) {
+            high_water.store(used, std::memory_order_relaxed);
+        }
+        return true;
+    }
+    
+    // Consumer side: returns false when empty
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (h == t) return false;
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    static uint32_t capacity() { return N; }
+    
+    uint32_t getDrops() const { return drops.load(std::memory_order_relaxed); }
+    uint32_t getHighWater() const { return high_water.load(std::memory_order_relaxed); }
+    
+    // Only valid while neither side is running
+    void reset() {
+        head.store(0);
+        tail.store(0);
+    }
+    
+private:
+    T buffer[N];
+    std::atomic<uint32_t> head;        // Next slot to write (producer)
+    std::atomic<uint32_t> tail;        // Next slot to read (consumer)
+    std::atomic<uint32_t> drops;       // Items rejected because the ring was full
+    std::atomic<uint32_t> high_water;  // Maximum fill level seen
+};
+
+#endif // SPSC_RING_H
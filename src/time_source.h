@@ -0,0 +1,24 @@
+#ifndef TIME_SOURCE_H
+#define TIME_SOURCE_H
+
+#include <stdint.h>
+
+// Monotonic microsecond clock shared by frame timestamps and rate statistics.
+// On target this is esp_timer (the same time base as millis()/micros(), but
+// 64-bit so it never wraps); on a host build it is std::chrono::steady_clock.
+#ifdef ARDUINO
+#include <esp_timer.h>
+
+inline uint64_t monotonicMicros() {
+    return (uint64_t)esp_timer_get_time();
+}
+#else
+#include <chrono>
+
+inline uint64_t monotonicMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#endif // TIME_SOURCE_H
@@ -0,0 +1,119 @@
+#include "timer_wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+TimerWheel::TimerWheel() {
+    reset(0);
+}
+
+void TimerWheel::reset(uint32_t now_ms) {
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint16_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            slots[level][i].next = &slots[level][i];
+            slots[level][i].prev = &slots[level][i];
+        }
+    }
+    base_ms = now_ms;
+    current_tick = 0;
+    pending = 0;
+    fired = 0;
+}
+
+void TimerWheel::schedule(TimerNode_t& node, uint32_t expires_ms) {
+    if (timerIsScheduled(node)) cancel(node);
+
+    // Round up so a timer never fires before its time
+    int32_t offset = (int32_t)(expires_ms - base_ms);
+    uint32_t tick = offset > 0 ? ((uint32_t)offset + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS : 0;
+    node.expires_tick = tick;
+    insert(node);
+    pending++;
+}
+
+void TimerWheel::cancel(TimerNode_t& node) {
+    if (!timerIsScheduled(node)) return;
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.next = nullptr;
+    node.prev = nullptr;
+    pending--;
+}
+
+void TimerWheel::insert(TimerNode_t& node) {
+    int32_t delta = (int32_t)(node.expires_tick - current_tick);
+    if (delta < 0) {
+        node.expires_tick = current_tick;  // Overdue: next tick
+        delta = 0;
+    }
+
+    // Lowest level whose range covers the delay
+    uint8_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           (uint32_t)delta >= (1UL << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    uint32_t max_delta = (1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    if ((uint32_t)delta > max_delta) {
+        node.expires_tick = current_tick + max_delta;
+    }
+
+    TimerNode_t& head =
+        slots[level][(node.expires_tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    node.next = &head;
+    node.prev = head.prev;
+    head.prev->next = &node;
+    head.prev = &node;
+}
+
+void TimerWheel::cascade(uint8_t level) {
+    // Move one slot of this level down now that its range has come up
+    TimerNode_t& head =
+        slots[level][(current_tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    TimerNode_t* node = head.next;
+    head.next = &head;
+    head.prev = &head;
+    while (node != &head) {
+        TimerNode_t* next = node->next;
+        insert(*node);
+        node = next;
+    }
+}
+
+void TimerWheel::advance(uint32_t now_ms, TimerCallback callback, void* ctx) {
+    int32_t offset = (int32_t)(now_ms - base_ms);
+    if (offset < 0) return;
+    uint32_t target = (uint32_t)offset / TIMER_WHEEL_TICK_MS;
+
+    while ((int32_t)(target - current_tick) >= 0) {
+        if (pending == 0) {
+            current_tick = target + 1;
+            break;
+        }
+
+        uint32_t index = current_tick & TIMER_WHEEL_MASK;
+        if (index == 0) {
+            for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                cascade(level);
+                if ((current_tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK) break;
+            }
+        }
+
+        // Detach the slot first so callbacks can reschedule freely
+        TimerNode_t& head = slots[0][index];
+        TimerNode_t* node = head.next;
+        head.prev->next = nullptr;
+        head.next = &head;
+        head.prev = &head;
+        current_tick++;
+
+        while (node != nullptr && node != &head) {
+            TimerNode_t* next = node->next;
+            node->next = nullptr;
+            node->prev = nullptr;
+            pending--;
+            fired++;
+            callback(ctx, node, now_ms);
+            node = next;
+        }
+    }
+}
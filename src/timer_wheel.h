@@ -0,0 +1,77 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// HIERARCHICAL TIMER WHEEL
+// Timers are intrusive nodes kept in circular lists, one list per slot.
+// Level 0 has one slot per tick; each higher level covers 64 slots of the
+// level below and is cascaded down when the lower level wraps. Scheduling
+// and cancelling are O(1); advancing costs one slot visit per tick (and
+// jumps straight to the target when no timer is pending). All timers that
+// expire in the same tick fire together. Times are counted from the last
+// reset(), so millis() wrap-around only matters after ~49 days without one.
+// ============================================================================
+
+#define TIMER_WHEEL_TICK_MS 10
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4     // 10 ms * 2^24 = ~46 h range
+
+typedef struct TimerNode {
+    struct TimerNode* next;
+    struct TimerNode* prev;      // nullptr while not scheduled
+    uint32_t expires_tick;
+    uint16_t id;                 // Owner's index
+} TimerNode_t;
+
+typedef void (*TimerCallback)(void* ctx, TimerNode_t* node, uint32_t now_ms);
+
+inline void timerNodeInit(TimerNode_t& node, uint16_t id) {
+    node.next = nullptr;
+    node.prev = nullptr;
+    node.expires_tick = 0;
+    node.id = id;
+}
+
+inline bool timerIsScheduled(const TimerNode_t& node) {
+    return node.prev != nullptr;
+}
+
+class TimerWheel {
+public:
+    TimerWheel();
+
+    // Drop all timers (their nodes must be re-initialized by the owner)
+    // and restart the wheel at now_ms
+    void reset(uint32_t now_ms);
+
+    // (Re)arm a node to fire at expires_ms; times in the past fire on the next tick
+    void schedule(TimerNode_t& node, uint32_t expires_ms);
+    void cancel(TimerNode_t& node);
+
+    // Fire everything that expired up to now_ms. The callback may
+    // reschedule the node it was given. Moving backwards is ignored.
+    void advance(uint32_t now_ms, TimerCallback callback, void* ctx);
+
+    // Expiry time of a scheduled node
+    uint32_t expiresMs(const TimerNode_t& node) const {
+        return base_ms + node.expires_tick * TIMER_WHEEL_TICK_MS;
+    }
+    uint32_t getPending() const { return pending; }
+    uint32_t getFired() const { return fired; }
+
+private:
+    TimerNode_t slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];  // List heads
+    uint32_t base_ms;            // Time of tick 0
+    uint32_t current_tick;       // Next tick to process
+    uint32_t pending;
+    uint32_t fired;
+
+    void insert(TimerNode_t& node);
+    void cascade(uint8_t level);
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,46 @@
+#include "topic_arena.h"
+#include <string.h>
+
+TopicArena::TopicArena() : used(0), base_len(0) {
+    base[0] = '\0';
+}
+
+void TopicArena::setBase(const char* new_base) {
+    base_len = strlen(new_base);
+    if (base_len >= sizeof(base)) base_len = sizeof(base) - 1;
+    memcpy(base, new_base, base_len);
+    base[base_len] = '\0';
+    used = 0;
+}
+
+Topic_t TopicArena::intern(const char* suffix) {
+    Topic_t topic = {nullptr, 0};
+    size_t suffix_len = strlen(suffix);
+    size_t len = base_len + 1 + suffix_len;
+
+    // Registration-time lookup: walk the NUL-separated entries
+    size_t pos = 0;
+    while (pos < used) {
+        const char* entry = arena + pos;
+        size_t entry_len = strlen(entry);
+        if (entry_len == len && memcmp(entry + base_len + 1, suffix, suffix_len) == 0) {
+            topic.str = entry;
+            topic.len = (uint16_t)len;
+            return topic;
+        }
+        pos += entry_len + 1;
+    }
+
+    if (used + len + 1 > sizeof(arena)) return topic;
+
+    char* entry = arena + used;
+    memcpy(entry, base, base_len);
+    entry[base_len] = '/';
+    memcpy(entry + base_len + 1, suffix, suffix_len);
+    entry[len] = '\0';
+    used += len + 1;
+
+    topic.str = entry;
+    topic.len = (uint16_t)len;
+    return topic;
+}
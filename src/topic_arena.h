@@ -0,0 +1,44 @@
+#ifndef TOPIC_ARENA_H
+#define TOPIC_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================================================
+// TOPIC ARENA
+// Full MQTT topics ("<base>/<suffix>") are built once, when a signal is
+// registered or the base topic changes, and stored back to back in a fixed
+// buffer. Publishers keep the returned pointer and length, so the publish
+// path neither formats nor allocates topics.
+// ============================================================================
+
+#define TOPIC_ARENA_SIZE 2048
+#define TOPIC_BASE_MAX 128         // Matches MQTTSettings::base_topic
+
+typedef struct {
+    const char* str;               // NUL-terminated, owned by the arena
+    uint16_t len;
+} Topic_t;
+
+class TopicArena {
+public:
+    TopicArena();
+
+    // Drops all interned topics: every holder must intern again
+    void setBase(const char* base);
+    const char* getBase() const { return base; }
+
+    // "<base>/<suffix>", shared with an earlier identical request;
+    // str is nullptr when the arena is full
+    Topic_t intern(const char* suffix);
+
+    size_t getUsed() const { return used; }
+
+private:
+    char arena[TOPIC_ARENA_SIZE];
+    size_t used;
+    char base[TOPIC_BASE_MAX];
+    size_t base_len;
+};
+
+#endif // TOPIC_ARENA_H
@@ -0,0 +1,374 @@
+#include "trace_replayer.h"
+#include <LittleFS.h>
+#include <ctype.h>
+
+static inline uint8_t hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+static inline const char* skipSpaces(const char* p) {
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+TraceReplayer::TraceReplayer(DataManager* data, MQTTHandler* mqtt)
+    : data_manager(data), mqtt_handler(mqtt), format(TRACE_FORMAT_CAPTURE),
+      realtime(false), active(false), segment_index(0), segment_end(0),
+      block_valid(false), read_pos(0), read_len(0), pending_bus(1),
+      has_pending(false), started(false), trace_start_us(0), wall_start_us(0),
+      trace_ms(0), recording(false), frames_replayed(0), parse_errors(0), publish_count(0),
+      process_us(0), output_us(0), elapsed_us(0) {
+    path[0] = '\0';
+}
+
+TraceReplayer::~TraceReplayer() {
+    end();
+}
+
+bool TraceReplayer::begin(const char* trace_path, bool realtime_mode, bool record_output) {
+    if (active) end();
+    
+    strlcpy(path, trace_path, sizeof(path));
+    realtime = realtime_mode;
+    
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        DEBUG_PRINTF("[Replay] Cannot open %s\n", path);
+        return false;
+    }
+    
+    if (file.isDirectory()) {
+        file.close();
+        format = TRACE_FORMAT_CAPTURE;
+        if (!CANCapture::findSegments(path, segment_index, segment_end)) {
+            DEBUG_PRINTF("[Replay] No capture segments in %s\n", path);
+            return false;
+        }
+        block_valid = false;
+    } else {
+        size_t len = strlen(path);
+        bool asc = len > 4 && strcasecmp(path + len - 4, ".asc") == 0;
+        format = asc ? TRACE_FORMAT_ASC : TRACE_FORMAT_CANDUMP;
+        source = file;
+        read_pos = 0;
+        read_len = 0;
+    }
+    
+    recording = false;
+    if (record_output) {
+        output = LittleFS.open(REPLAY_OUTPUT_FILE, "w");
+        recording = (bool)output;
+        if (!recording) {
+            DEBUG_PRINTLN("[Replay] Cannot create " REPLAY_OUTPUT_FILE ", not recording");
+        }
+    }
+    mqtt_handler->setPublishObserver(
+        [this](const char* topic, const uint8_t* payload, size_t length, bool retain) {
+            recordPublish(topic, payload, length, retain);
+        });
+    
+    // Same starting state on every run
+    data_manager->resetSignalState();
+    
+    frames_replayed = 0;
+    parse_errors = 0;
+    publish_count = 0;
+    publish_bytes = 0;
+    process_us = 0;
+    output_us = 0;
+    elapsed_us = 0;
+    has_pending = false;
+    started = false;
+    active = true;
+    
+    static const char* format_names[] = { "capture", "candump", "asc" };
+    DEBUG_PRINTF("[Replay] Replaying %s (%s, %s)\n", path, format_names[format],
+                realtime ? "real time" : "as fast as possible");
+    return true;
+}
+
+void TraceReplayer::loop() {
+    if (!active) return;
+    
+    uint64_t loop_start = monotonicMicros();
+    uint16_t frames = 0;
+    
+    while (true) {
+        if (!has_pending) {
+            if (!readFrame(pending, pending_bus)) {
+                finish();
+                return;
+            }
+            has_pending = true;
+            
+            if (!started) {
+                started = true;
+                trace_start_us = pending.timestamp_us;
+                wall_start_us = monotonicMicros();
+            }
+        }
+        
+        // Real time: hold the frame until its recorded offset has passed
+        if (realtime && (pending.timestamp_us - trace_start_us) >
+                        (monotonicMicros() - wall_start_us)) {
+            break;
+        }
+        
+        process(pending, pending_bus);
+        has_pending = false;
+        
+        // Yield back to the main loop (MQTT, watchdog) once the budget is used
+        if ((++frames & 7) == 0 && monotonicMicros() - loop_start >= REPLAY_LOOP_BUDGET_US) {
+            break;
+        }
+    }
+    
+    elapsed_us = monotonicMicros() - wall_start_us;
+}
+
+void TraceReplayer::end() {
+    if (active) finish();
+}
+
+void TraceReplayer::process(const CANMessage_t& msg, uint8_t bus) {
+    trace_ms = msg.timestampMs();
+    uint64_t output_before = output_us;
+    uint64_t start = monotonicMicros();
+    
+    if (bus == 2) {
+        data_manager->processCAN2Message(msg);
+    } else {
+        data_manager->processCAN1Message(msg);
+    }
+    
+    process_us += (monotonicMicros() - start) - (output_us - output_before);
+    frames_replayed++;
+}
+
+bool TraceReplayer::readFrame(CANMessage_t& msg, uint8_t& bus) {
+    if (format == TRACE_FORMAT_CAPTURE) {
+        return readCaptureFrame(msg, bus);
+    }
+    
+    char line[REPLAY_LINE_MAX];
+    while (readLine(line, sizeof(line))) {
+        if (line[0] == '\0' || line[0] == '#') continue;
+        
+        if (format == TRACE_FORMAT_CANDUMP) {
+            if (parseCandump(line, msg, bus)) return true;
+            parse_errors++;
+        } else if (parseAsc(line, msg, bus)) {
+            return true;  // ASC header and event lines are skipped silently
+        }
+    }
+    return false;
+}
+
+bool TraceReplayer::readCaptureFrame(CANMessage_t& msg, uint8_t& bus) {
+    while (true) {
+        if (block_valid && block_reader.next(msg, bus)) return true;
+        
+        block_valid = false;
+        if (!source || source.read(block.bytes, CAPTURE_BLOCK_SIZE) != CAPTURE_BLOCK_SIZE) {
+            if (!openNextSegment()) return false;
+            continue;
+        }
+        block_valid = block_reader.begin(block.bytes);
+        if (!block_valid) parse_errors++;
+    }
+}
+
+bool TraceReplayer::openNextSegment() {
+    if (source) source.close();
+    
+    // Segments deleted by rotation while replaying are skipped
+    char segment_path[96];
+    while (segment_index < segment_end) {
+        CANCapture::segmentPath(path, segment_index++, segment_path, sizeof(segment_path));
+        source = LittleFS.open(segment_path, "r");
+        if (source) return true;
+    }
+    return false;
+}
+
+bool TraceReplayer::readLine(char* line, size_t line_size) {
+    size_t len = 0;
+    bool got_data = false;
+    
+    while (true) {
+        if (read_pos >= read_len) {
+            read_len = source ? source.read(read_buffer, sizeof(read_buffer)) : 0;
+            read_pos = 0;
+            if (read_len == 0) break;
+        }
+        
+        char c = (char)read_buffer[read_pos++];
+        got_data = true;
+        if (c == '\n') break;
+        if (c != '\r' && len + 1 < line_size) {
+            line[len++] = c;  // Overlong lines are truncated
+        }
+    }
+    
+    line[len] = '\0';
+    return got_data;
+}
+
+bool TraceReplayer::parseCandump(const char* line, CANMessage_t& msg, uint8_t& bus) {
+    // (seconds.micros) interface id#data
+    if (line[0] != '(') return false;
+    
+    char* end;
+    uint64_t seconds = strtoull(line + 1, &end, 10);
+    uint32_t micros_part = 0;
+    if (*end == '.') {
+        uint8_t digits = 0;
+        end++;
+        while (isdigit((unsigned char)*end)) {
+            if (digits < 6) {
+                micros_part = micros_part * 10 + (*end - '0');
+                digits++;
+            }
+            end++;
+        }
+        while (digits++ < 6) micros_part *= 10;
+    }
+    if (*end != ')') return false;
+    
+    // Interface: can0 -> CAN1, can1 -> CAN2
+    const char* p = skipSpaces(end + 1);
+    const char* iface = p;
+    while (*p && *p != ' ' && *p != '\t') p++;
+    if (p == iface) return false;
+    bus = (p[-1] == '1') ? 2 : 1;
+    
+    p = skipSpaces(p);
+    msg.id = strtoul(p, &end, 16);
+    if (end == p || *end != '#') return false;
+    
+    p = end + 1;
+    uint8_t dlc = 0;
+    if (*p != 'R') {  // Remote frames carry no data
+        while (dlc < 8 && isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1])) {
+            msg.data[dlc++] = (hexNibble(p[0]) << 4) | hexNibble(p[1]);
+            p += 2;
+        }
+    }
+    msg.dlc = dlc;
+    msg.timestamp_us = seconds * 1000000ULL + micros_part;
+    return true;
+}
+
+bool TraceReplayer::parseAsc(const char* line, CANMessage_t& msg, uint8_t& bus) {
+    // <seconds> <channel> <id>[x] Rx|Tx d <dlc> <bytes...>
+    char* end;
+    double seconds = strtod(line, &end);
+    if (end == line) return false;
+    
+    const char* p = end;
+    long channel = strtol(p, &end, 10);
+    if (end == p || channel < 1) return false;
+    
+    p = skipSpaces(end);
+    msg.id = strtoul(p, &end, 16);
+    if (end == p) return false;
+    if (*end == 'x') end++;  // Extended ID marker
+    
+    p = skipSpaces(end);
+    if (strncmp(p, "Rx", 2) != 0 && strncmp(p, "Tx", 2) != 0) return false;
+    p = skipSpaces(p + 2);
+    if (*p != 'd') return false;  // Data frames only
+    
+    long dlc = strtol(p + 1, &end, 10);
+    if (end == p + 1 || dlc < 0 || dlc > 8) return false;
+    
+    for (long i = 0; i < dlc; i++) {
+        p = end;
+        msg.data[i] = (uint8_t)strtoul(p, &end, 16);
+        if (end == p) return false;
+    }
+    msg.dlc = (uint8_t)dlc;
+    msg.timestamp_us = (uint64_t)(seconds * 1000000.0 + 0.5);
+    bus = (channel == 2) ? 2 : 1;
+    return true;
+}
+
+static bool isText(const uint8_t* payload, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (payload[i] < 0x20 || payload[i] >= 0x7F) return false;
+    }
+    return true;
+}
+
+void TraceReplayer::recordPublish(const char* topic, const uint8_t* payload, size_t length,
+                                  bool retain) {
+    size_t topic_length = strlen(topic);
+    publish_count++;
+    publish_bytes += mqttPacketSize(topic_length, length);
+    if (!recording) return;
+    
+    // <trace ms> TAB <topic> TAB <payload> TAB <retain>
+    uint64_t start = monotonicMicros();
+    char prefix[16];
+    int len = snprintf(prefix, sizeof(prefix), "%lu\t", (unsigned long)trace_ms);
+    output.write((const uint8_t*)prefix, len);
+    output.write((const uint8_t*)topic, topic_length);
+    output.write('\t');
+    if (isText(payload, length)) {
+        output.write(payload, length);
+    } else {
+        static const char digits[] = "0123456789abcdef";
+        char hex[64];
+        size_t n = 0;
+        output.write((const uint8_t*)"hex:", 4);
+        for (size_t i = 0; i < length; i++) {
+            hex[n++] = digits[payload[i] >> 4];
+            hex[n++] = digits[payload[i] & 0x0F];
+            if (n == sizeof(hex)) {
+                output.write((const uint8_t*)hex, n);
+                n = 0;
+            }
+        }
+        output.write((const uint8_t*)hex, n);
+    }
+    output.write((const uint8_t*)(retain ? "\t1\n" : "\t0\n"), 3);
+    output_us += monotonicMicros() - start;
+}
+
+void TraceReplayer::finish() {
+    active = false;
+    if (started) {
+        elapsed_us = monotonicMicros() - wall_start_us;
+    }
+    if (source) source.close();
+    data_manager->endTrip();       // A trace usually stops mid-drive
+    data_manager->endChargeSession();
+    data_manager->flushBatches();  // Pending values belong to the recorded stream
+    data_manager->flushHistory();
+    if (output) output.close();
+    mqtt_handler->setPublishObserver(nullptr);
+    printReport();
+}
+
+float TraceReplayer::getFramesPerSecond() const {
+    return elapsed_us > 0 ? frames_replayed * 1000000.0f / elapsed_us : 0.0f;
+}
+
+float TraceReplayer::getMicrosPerFrame() const {
+    return frames_replayed > 0 ? (float)process_us / frames_replayed : 0.0f;
+}
+
+void TraceReplayer::printReport() const {
+    DEBUG_PRINTLN("\n====== TRACE REPLAY REPORT =======");
+    DEBUG_PRINTF("Trace: %s\n", path);
+    DEBUG_PRINTF("Frames: %lu (%lu unparsable)\n", frames_replayed, parse_errors);
+    DEBUG_PRINTF("Wall time: %.3f s, %.0f frames/s\n", elapsed_us / 1e6, getFramesPerSecond());
+    DEBUG_PRINTF("Decode + publish: %.2f us/frame\n", getMicrosPerFrame());
+    DEBUG_PRINTF("Publishes: %lu, %lu MQTT bytes", publish_count, publish_bytes);
+    if (recording) {
+        DEBUG_PRINTF(" (recorded to %s)", REPLAY_OUTPUT_FILE);
+    }
+    DEBUG_PRINTLN("\n==================================\n");
+}
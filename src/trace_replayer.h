@@ -0,0 +1,110 @@
+#ifndef TRACE_REPLAYER_H
+#define TRACE_REPLAYER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "config.h"
+#include "can_messages.h"
+#include "can_capture.h"
+#include "data_manager.h"
+#include "mqtt_handler.h"
+
+// ============================================================================
+// TRACE REPLAY
+// Feeds a recorded trace from LittleFS through the regular DataManager
+// decode-and-publish path instead of the live bus. Supported sources:
+//   - a binary capture directory (see can_capture.h)
+//   - candump log files ("(1700000000.123456) can0 42E#0102...")
+//   - Vector ASC files (*.asc)
+// In real-time mode frames are released at their recorded spacing; otherwise
+// the trace runs as fast as the decoder allows. Publish decisions use the
+// frame timestamps, so the same trace always produces the same publish
+// stream, which can be recorded to REPLAY_OUTPUT_FILE for comparison.
+// Nothing is sent to the broker or queued while a replay runs.
+// Binary payloads are recorded as "hex:<bytes>" so the file stays one
+// publish per line (tools/batch_decode.py expands and sizes them).
+// ============================================================================
+
+typedef enum {
+    TRACE_FORMAT_CAPTURE = 0,
+    TRACE_FORMAT_CANDUMP,
+    TRACE_FORMAT_ASC
+} TraceFormat_t;
+
+class TraceReplayer {
+public:
+    TraceReplayer(DataManager* data, MQTTHandler* mqtt);
+    ~TraceReplayer();
+
+    bool begin(const char* path, bool realtime, bool record_output);
+    void loop();
+    void end();
+
+    bool isActive() const { return active; }
+
+    // Results
+    uint32_t getFramesReplayed() const { return frames_replayed; }
+    uint32_t getParseErrors() const { return parse_errors; }
+    uint32_t getPublishCount() const { return publish_count; }
+    uint32_t getPublishBytes() const { return publish_bytes; }
+    float getFramesPerSecond() const;
+    float getMicrosPerFrame() const;
+    void printReport() const;
+
+private:
+    DataManager* data_manager;
+    MQTTHandler* mqtt_handler;
+
+    // Source
+    TraceFormat_t format;
+    File source;
+    char path[64];
+    bool realtime;
+    bool active;
+
+    // Binary capture: segment cursor and current block
+    uint32_t segment_index;
+    uint32_t segment_end;
+    CaptureBlock_t block;
+    CaptureBlockReader block_reader;
+    bool block_valid;
+
+    // Text formats: read buffer
+    uint8_t read_buffer[CAPTURE_BLOCK_SIZE];
+    uint16_t read_pos;
+    uint16_t read_len;
+
+    // Frame held back by real-time pacing
+    CANMessage_t pending;
+    uint8_t pending_bus;
+    bool has_pending;
+    bool started;
+    uint64_t trace_start_us;
+    uint64_t wall_start_us;
+    uint32_t trace_ms;             // Timestamp of the frame being processed
+
+    // Recorded publish stream
+    File output;
+    bool recording;
+
+    // Statistics
+    uint32_t frames_replayed;
+    uint32_t parse_errors;
+    uint32_t publish_count;
+    uint32_t publish_bytes;        // MQTT packet bytes the publishes would cost
+    uint64_t process_us;           // Time inside DataManager (output excluded)
+    uint64_t output_us;            // Time spent recording the publish stream
+    uint64_t elapsed_us;
+
+    bool readFrame(CANMessage_t& msg, uint8_t& bus);
+    bool readCaptureFrame(CANMessage_t& msg, uint8_t& bus);
+    bool openNextSegment();
+    bool readLine(char* line, size_t line_size);
+    bool parseCandump(const char* line, CANMessage_t& msg, uint8_t& bus);
+    bool parseAsc(const char* line, CANMessage_t& msg, uint8_t& bus);
+    void process(const CANMessage_t& msg, uint8_t bus);
+    void recordPublish(const char* topic, const uint8_t* payload, size_t length, bool retain);
+    void finish();
+};
+
+#endif // TRACE_REPLAYER_H
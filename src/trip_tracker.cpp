@@ -0,0 +1,115 @@
+#include "trip_tracker.h"
+#include <string.h>
+
+static double counter(const DerivedSignalGraph& state, DerivedOutput_t output) {
+    return state.isValid(output) ? state.getValue(output) : 0.0;
+}
+
+TripTracker::TripTracker() : trip_count(0) {
+    reset();
+}
+
+void TripTracker::reset() {
+    memset(&summary, 0, sizeof(summary));
+    active = false;
+    last_frame_ms = 0;
+    base_distance = 0;
+    base_energy = 0;
+    base_regen = 0;
+    last_lat = 0;
+    last_lon = 0;
+    has_position = false;
+}
+
+void TripTracker::update(uint32_t now_ms, const DerivedSignalGraph& state) {
+    last_frame_ms = now_ms;
+    if (!state.hasInput(DERIVED_IN_SPEED)) return;
+
+    double speed = state.getInput(DERIVED_IN_SPEED);
+    bool plugged = state.hasInput(DERIVED_IN_PLUG) && state.getInput(DERIVED_IN_PLUG) >= 0.5;
+
+    if (!active) {
+        if (speed >= TRIP_START_KMH && !plugged) {
+            start(now_ms, state);
+        }
+        return;
+    }
+
+    if (plugged) {
+        endTrip(TRIP_END_PLUG);
+    } else if (speed >= TRIP_MOVING_KMH) {
+        record(now_ms, state);
+    } else if ((now_ms - summary.end_ms) >= TRIP_STOP_IDLE_MS) {
+        endTrip(TRIP_END_IDLE);
+    }
+}
+
+void TripTracker::tick(uint32_t now_ms) {
+    if (!active) return;
+    if ((now_ms - last_frame_ms) >= TRIP_BUS_SILENT_MS) {
+        endTrip(TRIP_END_BUS_SILENT);
+    } else if ((now_ms - summary.end_ms) >= TRIP_STOP_IDLE_MS) {
+        endTrip(TRIP_END_IDLE);
+    }
+}
+
+void TripTracker::endTrip(TripEndReason_t reason) {
+    if (!active) return;
+    active = false;
+    summary.reason = reason;
+}
+
+void TripTracker::setPosition(float latitude, float longitude) {
+    last_lat = latitude;
+    last_lon = longitude;
+    has_position = true;
+    if (!active) return;
+
+    if (!summary.has_start_gps) {
+        summary.start_lat = latitude;
+        summary.start_lon = longitude;
+        summary.has_start_gps = true;
+    }
+    summary.end_lat = latitude;
+    summary.end_lon = longitude;
+    summary.has_end_gps = true;
+}
+
+void TripTracker::start(uint32_t now_ms, const DerivedSignalGraph& state) {
+    memset(&summary, 0, sizeof(summary));
+    summary.id = ++trip_count;
+    summary.start_ms = now_ms;
+    base_distance = counter(state, DERIVED_DISTANCE);
+    base_energy = counter(state, DERIVED_ENERGY_OUT);
+    base_regen = counter(state, DERIVED_REGEN);
+    active = true;
+
+    // The last fix before moving off is where the trip started
+    if (has_position) {
+        setPosition(last_lat, last_lon);
+    }
+    record(now_ms, state);
+}
+
+void TripTracker::record(uint32_t now_ms, const DerivedSignalGraph& state) {
+    summary.end_ms = now_ms;
+    summary.distance_km = counter(state, DERIVED_DISTANCE) - base_distance;
+    summary.energy_kwh = counter(state, DERIVED_ENERGY_OUT) - base_energy;
+    summary.regen_kwh = counter(state, DERIVED_REGEN) - base_regen;
+
+    float speed = (float)state.getInput(DERIVED_IN_SPEED);
+    if (speed > summary.speed_max) summary.speed_max = speed;
+
+    if (state.hasInput(DERIVED_IN_SOC)) {
+        float soc = (float)state.getInput(DERIVED_IN_SOC);
+        if (!summary.has_soc) {
+            summary.soc_start = soc;
+            summary.soc_min = soc;
+            summary.soc_max = soc;
+            summary.has_soc = true;
+        }
+        if (soc < summary.soc_min) summary.soc_min = soc;
+        if (soc > summary.soc_max) summary.soc_max = soc;
+        summary.soc_end = soc;
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef TRIP_TRACKER_H
+#define TRIP_TRACKER_H
+
+#include <stdint.h>
+#include "derived_signals.h"
+
+// ============================================================================
+// TRIP DETECTION
+// Follows the vehicle state kept by DerivedSignalGraph on frame time:
+//   - a trip starts at the first sample at or above TRIP_START_KMH
+//   - it ends when the car has stood still for TRIP_STOP_IDLE_MS, when
+//     the bus has been silent for TRIP_BUS_SILENT_MS (car switched off),
+//     or when the charge plug is connected
+// The summary is updated at every moving sample, so a trip ends at its last
+// movement: parking time after it counts for neither duration nor energy.
+// Energy and distance are differences of the derived counters. Trips
+// shorter than TRIP_MIN_DISTANCE_KM are discarded (moving the car in a
+// driveway).
+// ============================================================================
+
+#define TRIP_START_KMH 5.0              // Speed that starts a trip
+#define TRIP_MOVING_KMH 1.0             // Below this the car stands still
+#define TRIP_STOP_IDLE_MS 300000UL      // Standing still this long ends the trip
+#define TRIP_BUS_SILENT_MS 60000UL      // No frames this long ends the trip
+#define TRIP_MIN_DISTANCE_KM 0.2        // Shorter trips are not reported
+
+typedef enum {
+    TRIP_END_NONE = 0,
+    TRIP_END_IDLE,                 // Stood still for TRIP_STOP_IDLE_MS
+    TRIP_END_BUS_SILENT,           // Car switched off
+    TRIP_END_PLUG,                 // Charge plug connected
+    TRIP_END_FORCED                // endTrip(), e.g. end of a replay
+} TripEndReason_t;
+
+typedef struct {
+    uint32_t id;                   // Counts trips since boot
+    uint32_t start_ms;             // Frame time of the first moving sample
+    uint32_t end_ms;               // Frame time of the last moving sample
+    double distance_km;
+    double energy_kwh;             // Drawn from the battery
+    double regen_kwh;              // Recovered while moving
+    float speed_max;
+    float soc_start;
+    float soc_end;
+    float soc_min;
+    float soc_max;
+    bool has_soc;
+    float start_lat;
+    float start_lon;
+    float end_lat;
+    float end_lon;
+    bool has_start_gps;
+    bool has_end_gps;
+    TripEndReason_t reason;
+} TripSummary_t;
+
+class TripTracker {
+public:
+    TripTracker();
+
+    void reset();
+
+    // New vehicle state from a frame
+    void update(uint32_t now_ms, const DerivedSignalGraph& state);
+
+    // Time passing without frames
+    void tick(uint32_t now_ms);
+
+    // End the current trip now
+    void endTrip(TripEndReason_t reason);
+
+    // Latest GPS fix (from the modem); becomes the trip start or end point
+    void setPosition(float latitude, float longitude);
+
+    bool isActive() const { return active; }
+    // Current trip, or the last one once it has ended
+    const TripSummary_t& getSummary() const { return summary; }
+    bool isReportable() const { return summary.distance_km >= TRIP_MIN_DISTANCE_KM; }
+
+private:
+    TripSummary_t summary;
+    bool active;
+    uint32_t trip_count;
+    uint32_t last_frame_ms;
+
+    // Derived counters when the trip started
+    double base_distance;
+    double base_energy;
+    double base_regen;
+
+    float last_lat;
+    float last_lon;
+    bool has_position;
+
+    void start(uint32_t now_ms, const DerivedSignalGraph& state);
+    void record(uint32_t now_ms, const DerivedSignalGraph& state);
+};
+
+#endif // TRIP_TRACKER_H
@@ -0,0 +1,187 @@
+#include "uds_scheduler.h"
+#include <string.h>
+
+// Wrap-safe "a is at or after b" for millisecond timestamps
+static inline bool reached(uint32_t now_ms, uint32_t when_ms) {
+    return (int32_t)(now_ms - when_ms) >= 0;
+}
+
+UdsScheduler::UdsScheduler()
+    : ecu_count(0), request_count(0), next_ecu(0), started(false), sender(nullptr),
+      handler(nullptr), handler_ctx(nullptr), bus_load(0.0f), busy_skips(0) {}
+
+void UdsScheduler::begin(IsoTpSender* frame_sender, UdsResponseHandler response_handler,
+                         void* ctx) {
+    sender = frame_sender;
+    handler = response_handler;
+    handler_ctx = ctx;
+}
+
+int8_t UdsScheduler::addEcu(const char* name, uint32_t tx_id, uint32_t rx_id) {
+    if (ecu_count >= UDS_MAX_ECUS || sender == nullptr) return -1;
+
+    UdsEcu_t& ecu = ecus[ecu_count];
+    ecu.name = name;
+    ecu.link.begin(sender, tx_id, rx_id);
+    ecu.active_request = -1;
+    ecu.request_start_us = 0;
+    ecu.timeout_us = UDS_P2_TIMEOUT_US;
+    ecu.consecutive_failures = 0;
+    ecu.backoff_until_ms = 0;
+    return (int8_t)ecu_count++;
+}
+
+int8_t UdsScheduler::addRequest(uint8_t ecu, const uint8_t* request, uint8_t len,
+                                uint32_t interval_ms) {
+    if (request_count >= UDS_MAX_REQUESTS || ecu >= ecu_count) return -1;
+    if (len == 0 || len > UDS_MAX_REQUEST_LEN) return -1;
+
+    UdsRequest_t& req = requests[request_count];
+    req.ecu = ecu;
+    memcpy(req.request, request, len);
+    req.request_len = len;
+    req.interval_ms = interval_ms;
+    req.next_due_ms = 0;
+    req.responses = 0;
+    req.failures = 0;
+    return (int8_t)request_count++;
+}
+
+bool UdsScheduler::onFrame(uint32_t id, const uint8_t* data, uint8_t dlc, uint64_t now_us) {
+    for (uint8_t i = 0; i < ecu_count; i++) {
+        if (ecus[i].link.getRxId() == id) {
+            ecus[i].link.onFrame(data, dlc, (uint32_t)now_us);
+            return true;
+        }
+    }
+    return false;
+}
+
+void UdsScheduler::loop(uint64_t now_us64) {
+    uint32_t now_us = (uint32_t)now_us64;
+    uint32_t now_ms = (uint32_t)(now_us64 / 1000ULL);
+
+    if (!started) {
+        // Everything is due on the first pass
+        for (uint8_t r = 0; r < request_count; r++) {
+            requests[r].next_due_ms = now_ms;
+        }
+        started = true;
+    }
+
+    // Advance transports and collect responses, errors and timeouts
+    uint8_t in_flight = 0;
+    for (uint8_t i = 0; i < ecu_count; i++) {
+        UdsEcu_t& ecu = ecus[i];
+        ecu.link.poll(now_us);
+
+        if (ecu.link.getState() == ISOTP_RX_DONE) {
+            handleResponse(ecu, now_us, now_ms);
+        } else if (ecu.link.getState() == ISOTP_ERROR) {
+            fail(ecu, now_ms);
+        } else if (ecu.active_request >= 0 && ecu.link.isIdle() &&
+                   now_us - ecu.request_start_us > ecu.timeout_us) {
+            // No response started within P2 (a multi-frame response is timed by ISO-TP)
+            fail(ecu, now_ms);
+        }
+
+        if (ecu.active_request >= 0) in_flight++;
+    }
+
+    if (bus_load > UDS_BUSY_LOAD_PCT) {
+        busy_skips++;
+        return;
+    }
+
+    // Start the most overdue request on each idle ECU, round robin
+    for (uint8_t n = 0; n < ecu_count && in_flight < UDS_MAX_IN_FLIGHT; n++) {
+        uint8_t i = (next_ecu + n) % ecu_count;
+        UdsEcu_t& ecu = ecus[i];
+        if (ecu.active_request >= 0 || !ecu.link.isIdle()) continue;
+        if (ecu.consecutive_failures > 0 && !reached(now_ms, ecu.backoff_until_ms)) continue;
+
+        int8_t r = pickRequest(i, now_ms);
+        if (r < 0) continue;
+
+        UdsRequest_t& req = requests[r];
+        if (!ecu.link.send(req.request, req.request_len, now_us)) {
+            // TX queue full: the bus is saturated, try again next loop
+            ecu.link.reset();
+            busy_skips++;
+            break;
+        }
+        ecu.active_request = r;
+        ecu.request_start_us = now_us;
+        ecu.timeout_us = UDS_P2_TIMEOUT_US;
+        in_flight++;
+        next_ecu = (i + 1) % ecu_count;
+    }
+}
+
+void UdsScheduler::handleResponse(UdsEcu_t& ecu, uint32_t now_us, uint32_t now_ms) {
+    const uint8_t* data;
+    uint16_t len;
+    ecu.link.receive(data, len);
+    if (ecu.active_request < 0 || len == 0) return;  // Unsolicited
+
+    UdsRequest_t& req = requests[ecu.active_request];
+    uint8_t sid = req.request[0];
+
+    if (data[0] == UDS_NEGATIVE_RESPONSE && len >= 3 && data[1] == sid) {
+        if (data[2] == UDS_NRC_RESPONSE_PENDING) {
+            // ECU needs more time; the final response follows on the same link
+            ecu.request_start_us = now_us;
+            ecu.timeout_us = UDS_P2_EXT_TIMEOUT_US;
+            return;
+        }
+        // ECU is alive but refused: retry at the normal interval
+        req.failures++;
+        ecu.consecutive_failures = 0;
+        complete(ecu, now_ms);
+        return;
+    }
+
+    if (data[0] != (uint8_t)(sid + UDS_POSITIVE_OFFSET)) return;  // Not ours, keep waiting
+
+    req.responses++;
+    ecu.consecutive_failures = 0;
+    uint8_t index = (uint8_t)ecu.active_request;
+    complete(ecu, now_ms);
+    if (handler) {
+        handler(handler_ctx, index, data, len);
+    }
+}
+
+void UdsScheduler::complete(UdsEcu_t& ecu, uint32_t now_ms) {
+    UdsRequest_t& req = requests[ecu.active_request];
+    req.next_due_ms = now_ms + req.interval_ms;
+    ecu.active_request = -1;
+}
+
+void UdsScheduler::fail(UdsEcu_t& ecu, uint32_t now_ms) {
+    if (ecu.active_request >= 0) {
+        requests[ecu.active_request].failures++;
+        ecu.active_request = -1;  // Request stays due and is retried after the backoff
+    }
+    ecu.link.reset();
+
+    if (ecu.consecutive_failures < 16) ecu.consecutive_failures++;
+    uint32_t backoff = UDS_BACKOFF_BASE_MS << (ecu.consecutive_failures - 1);
+    if (backoff > UDS_BACKOFF_MAX_MS) backoff = UDS_BACKOFF_MAX_MS;
+    ecu.backoff_until_ms = now_ms + backoff;
+}
+
+int8_t UdsScheduler::pickRequest(uint8_t ecu, uint32_t now_ms) const {
+    int8_t best = -1;
+    uint32_t best_lateness = 0;
+    for (uint8_t r = 0; r < request_count; r++) {
+        const UdsRequest_t& req = requests[r];
+        if (req.ecu != ecu || !reached(now_ms, req.next_due_ms)) continue;
+        uint32_t lateness = now_ms - req.next_due_ms;
+        if (best < 0 || lateness > best_lateness) {
+            best = (int8_t)r;
+            best_lateness = lateness;
+        }
+    }
+    return best;
+}
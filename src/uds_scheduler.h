@@ -0,0 +1,101 @@
+#ifndef UDS_SCHEDULER_H
+#define UDS_SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "isotp.h"
+
+// ============================================================================
+// DIAGNOSTIC QUERY SCHEDULER
+// Periodic request/response polling of ECUs over ISO-TP (UDS and the
+// KWP-style 0x21 local identifiers CanZE uses on the Zoe). Each ECU has its
+// own link, so requests to different ECUs are in flight at the same time,
+// while each ECU only ever sees one outstanding request. The most overdue
+// request of an idle ECU goes next. New requests are held back while the bus
+// is busy, and an ECU that stops answering is retried with exponential
+// backoff (e.g. while it is asleep).
+// ============================================================================
+
+#define UDS_MAX_ECUS 4
+#define UDS_MAX_REQUESTS 16
+#define UDS_MAX_REQUEST_LEN 7          // Fits a single frame
+#define UDS_MAX_IN_FLIGHT 2            // Concurrent requests across all ECUs
+#define UDS_P2_TIMEOUT_US 500000UL     // Response timeout
+#define UDS_P2_EXT_TIMEOUT_US 5000000UL // After NRC 0x78 (response pending)
+#define UDS_BACKOFF_BASE_MS 1000UL
+#define UDS_BACKOFF_MAX_MS 60000UL
+#define UDS_BUSY_LOAD_PCT 70.0f        // No new requests above this bus load
+
+#define UDS_NEGATIVE_RESPONSE 0x7F
+#define UDS_NRC_RESPONSE_PENDING 0x78
+#define UDS_POSITIVE_OFFSET 0x40
+
+typedef struct {
+    uint8_t ecu;                          // Index into the ECU table
+    uint8_t request[UDS_MAX_REQUEST_LEN]; // Service ID + parameters
+    uint8_t request_len;
+    uint32_t interval_ms;                 // Refresh interval
+    uint32_t next_due_ms;
+    uint32_t responses;
+    uint32_t failures;                    // Timeouts, transport errors, negative responses
+} UdsRequest_t;
+
+typedef struct {
+    const char* name;
+    IsoTpLink link;
+    int8_t active_request;                // -1 while idle
+    uint32_t request_start_us;
+    uint32_t timeout_us;
+    uint8_t consecutive_failures;
+    uint32_t backoff_until_ms;
+} UdsEcu_t;
+
+// Positive responses (first byte = request SID + 0x40) of request index
+typedef void (*UdsResponseHandler)(void* ctx, uint8_t request, const uint8_t* data, uint16_t len);
+
+class UdsScheduler {
+public:
+    UdsScheduler();
+
+    void begin(IsoTpSender* sender, UdsResponseHandler handler, void* ctx);
+
+    // Table construction; return the new index or -1 when full
+    int8_t addEcu(const char* name, uint32_t tx_id, uint32_t rx_id);
+    int8_t addRequest(uint8_t ecu, const uint8_t* request, uint8_t len, uint32_t interval_ms);
+
+    // Feed a received frame; true if it belonged to one of the ECUs
+    bool onFrame(uint32_t id, const uint8_t* data, uint8_t dlc, uint64_t now_us);
+
+    // Drive transports, timeouts and the request schedule
+    void loop(uint64_t now_us);
+
+    void setBusLoad(float percent) { bus_load = percent; }
+
+    // Inspection
+    uint8_t getEcuCount() const { return ecu_count; }
+    uint8_t getRequestCount() const { return request_count; }
+    const UdsEcu_t& getEcu(uint8_t index) const { return ecus[index]; }
+    const UdsRequest_t& getRequest(uint8_t index) const { return requests[index]; }
+    uint32_t getBusySkips() const { return busy_skips; }
+
+private:
+    UdsEcu_t ecus[UDS_MAX_ECUS];
+    UdsRequest_t requests[UDS_MAX_REQUESTS];
+    uint8_t ecu_count;
+    uint8_t request_count;
+    uint8_t next_ecu;              // Round-robin start for fairness
+    bool started;
+
+    IsoTpSender* sender;
+    UdsResponseHandler handler;
+    void* handler_ctx;
+    float bus_load;
+    uint32_t busy_skips;
+
+    void handleResponse(UdsEcu_t& ecu, uint32_t now_us, uint32_t now_ms);
+    void complete(UdsEcu_t& ecu, uint32_t now_ms);
+    void fail(UdsEcu_t& ecu, uint32_t now_ms);
+    int8_t pickRequest(uint8_t ecu, uint32_t now_ms) const;
+};
+
+#endif // UDS_SCHEDULER_H
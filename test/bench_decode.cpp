@@ -0,0 +1,137 @@
+// Decode speed of DecodePlan against the per-bit loop it replaced
+// (CANHandler::extractSignal before decode plans), over the Zoe signal tables.
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "decode_plan.h"
+
+typedef struct {
+    uint32_t id;
+    const CANSignal_t* signals[DECODE_PLAN_MAX_SIGNALS];
+    uint8_t count;
+} BenchFrame_t;
+
+static const BenchFrame_t frames[] = {
+    {BatteryMessages::MSG_BATTERY_STATUS, {&BatteryMessages::SIG_SOC, &BatteryMessages::SIG_SOH,
+        &BatteryMessages::SIG_REAL_SOC}, 3},
+    {BatteryMessages::MSG_CELL_VOLTAGES, {&BatteryMessages::SIG_CELL_VOLTAGE_MIN,
+        &BatteryMessages::SIG_CELL_VOLTAGE_MAX}, 2},
+    {BatteryMessages::MSG_BATTERY_TEMP, {&BatteryMessages::SIG_TEMP_MIN, &BatteryMessages::SIG_TEMP_MAX,
+        &BatteryMessages::SIG_TEMP_AVG}, 3},
+    {BatteryMessages::MSG_BATTERY_POWER, {&BatteryMessages::SIG_BATTERY_VOLTAGE,
+        &BatteryMessages::SIG_BATTERY_CURRENT, &BatteryMessages::SIG_BATTERY_POWER}, 3},
+    {BatteryMessages::MSG_BATTERY_CAPACITY, {&BatteryMessages::SIG_USABLE_CAPACITY,
+        &BatteryMessages::SIG_MAX_CAPACITY, &BatteryMessages::SIG_ENERGY_TO_FULL}, 3},
+    {ChargingMessages::MSG_CHARGE_STATUS, {&ChargingMessages::SIG_PLUG_CONNECTED,
+        &ChargingMessages::SIG_CHARGE_POWER, &ChargingMessages::SIG_CHARGE_VOLTAGE,
+        &ChargingMessages::SIG_CHARGE_CURRENT}, 4},
+    {MotionMessages::MSG_SPEED, {&MotionMessages::SIG_VEHICLE_SPEED,
+        &MotionMessages::SIG_BRAKE_PRESSURE}, 2},
+    {MotionMessages::MSG_MOTOR_STATUS, {&MotionMessages::SIG_MOTOR_RPM,
+        &MotionMessages::SIG_MOTOR_TORQUE}, 2},
+    {MotionMessages::MSG_CONSUMPTION, {&MotionMessages::SIG_CONSUMPTION_KWH,
+        &MotionMessages::SIG_CONSUMPTION_INSTANT}, 2},
+    {MotionMessages::MSG_RANGE, {&MotionMessages::SIG_AVAILABLE_RANGE,
+        &MotionMessages::SIG_TRIP_DISTANCE}, 2},
+    {ClimateMessages::MSG_HEAT_PUMP, {&ClimateMessages::SIG_HP_PRESSURE,
+        &ClimateMessages::SIG_HP_EVAP_TEMP, &ClimateMessages::SIG_HP_COND_TEMP}, 3},
+    {TPMSMessages::MSG_TPMS, {&TPMSMessages::SIG_TIRE_FL_PRESSURE, &TPMSMessages::SIG_TIRE_FR_PRESSURE,
+        &TPMSMessages::SIG_TIRE_RL_PRESSURE, &TPMSMessages::SIG_TIRE_RR_PRESSURE}, 4},
+    {PowerMessages::MSG_AUX_VOLTAGE, {&PowerMessages::SIG_12V_VOLTAGE,
+        &PowerMessages::SIG_24V_VOLTAGE}, 2},
+    {RecuperationMessages::MSG_RECUPERATION, {&RecuperationMessages::SIG_MAX_RECUP,
+        &RecuperationMessages::SIG_INSTANT_RECUP, &RecuperationMessages::SIG_TOTAL_RECUP}, 3},
+};
+static const size_t FRAME_COUNT = sizeof(frames) / sizeof(frames[0]);
+
+#define PAYLOADS 256
+#define ROUNDS 2000
+
+// The old loop: one bit per iteration, bounds checked against the DLC. The
+// original sign-extended every value; this copy honours is_signed so both
+// decoders must agree exactly.
+static double extractPerBit(const CANMessage_t& msg, const CANSignal_t& signal) {
+    if (msg.dlc == 0) return signal.offset;
+
+    uint64_t raw_value = 0;
+    for (uint8_t i = 0; i < signal.bit_length; i++) {
+        uint8_t byte_index = (signal.start_bit + i) / 8;
+        uint8_t bit_in_byte = (signal.start_bit + i) % 8;
+        if (byte_index < msg.dlc && byte_index < 8) {
+            uint8_t bit_value = (msg.data[byte_index] >> bit_in_byte) & 1;
+            raw_value |= ((uint64_t)bit_value << i);
+        }
+    }
+    if (signal.is_signed && signal.bit_length < 64) {
+        uint64_t sign_bit = 1ULL << (signal.bit_length - 1);
+        if (raw_value & sign_bit) raw_value |= (0xFFFFFFFFFFFFFFFFULL << signal.bit_length);
+    }
+    return (double)(int64_t)raw_value * signal.factor + signal.offset;
+}
+
+int main() {
+    static CANMessage_t payloads[PAYLOADS];
+    srand(1);
+    for (int p = 0; p < PAYLOADS; p++) {
+        payloads[p].dlc = (p % 9 == 0) ? (uint8_t)(rand() % 9) : 8;
+        for (int b = 0; b < 8; b++) payloads[p].data[b] = (uint8_t)rand();
+    }
+
+    DecodePlan plans[FRAME_COUNT];
+    size_t signal_total = 0;
+    for (size_t f = 0; f < FRAME_COUNT; f++) {
+        for (uint8_t s = 0; s < frames[f].count; s++) {
+            CHECK(plans[f].addSignal(*frames[f].signals[s]));
+        }
+        signal_total += frames[f].count;
+    }
+
+    // Both decoders produce identical values
+    double planned[DECODE_PLAN_MAX_SIGNALS];
+    for (int p = 0; p < PAYLOADS; p++) {
+        for (size_t f = 0; f < FRAME_COUNT; f++) {
+            const CANMessage_t& msg = payloads[p];
+            uint8_t n = plans[f].decode(msg.data, msg.dlc, planned);
+            CHECK(n == frames[f].count);
+            for (uint8_t s = 0; s < n; s++) {
+                double expected = extractPerBit(msg, *frames[f].signals[s]);
+                // A zero DLC decodes as the offset in both
+                CHECK(planned[s] == expected);
+            }
+        }
+    }
+
+    double sink = 0;
+    uint64_t start = hostNanos();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int p = 0; p < PAYLOADS; p++) {
+            for (size_t f = 0; f < FRAME_COUNT; f++) {
+                for (uint8_t s = 0; s < frames[f].count; s++) {
+                    sink += extractPerBit(payloads[p], *frames[f].signals[s]);
+                }
+            }
+        }
+    }
+    uint64_t per_bit_ns = hostNanos() - start;
+    keep(sink);
+
+    start = hostNanos();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int p = 0; p < PAYLOADS; p++) {
+            for (size_t f = 0; f < FRAME_COUNT; f++) {
+                plans[f].decode(payloads[p].data, payloads[p].dlc, planned);
+                sink += planned[0];
+            }
+        }
+    }
+    uint64_t plan_ns = hostNanos() - start;
+    keep(sink);
+
+    double frame_count = (double)ROUNDS * PAYLOADS * FRAME_COUNT;
+    printf("%u frames, %u signals\n", (unsigned)FRAME_COUNT, (unsigned)signal_total);
+    printf("per-bit loop: %7.1f ns/frame\n", per_bit_ns / frame_count);
+    printf("decode plan:  %7.1f ns/frame\n", plan_ns / frame_count);
+    printf("speedup:      %7.1fx\n", plan_ns ? (double)per_bit_ns / plan_ns : 0.0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,85 @@
+// Per-frame lookup cost of CANDispatchTable against the std::map of signal
+// vectors it replaced (DataManager before the flat table). The traffic mix
+// is mostly frames nobody registered, like a real bus.
+
+#include <stdlib.h>
+#include <map>
+#include <vector>
+#include "host_test.h"
+#include "can_dispatch.h"
+
+static const uint32_t registered[] = {
+    BatteryMessages::MSG_BATTERY_STATUS, BatteryMessages::MSG_CELL_VOLTAGES,
+    BatteryMessages::MSG_BATTERY_TEMP, BatteryMessages::MSG_BATTERY_POWER,
+    BatteryMessages::MSG_BATTERY_CAPACITY, BatteryMessages::MSG_CHARGE_CYCLES,
+    ChargingMessages::MSG_CHARGE_STATUS, MotionMessages::MSG_SPEED,
+    MotionMessages::MSG_MOTOR_STATUS, MotionMessages::MSG_CONSUMPTION, MotionMessages::MSG_RANGE,
+    ClimateMessages::MSG_INTERIOR_TEMP, ClimateMessages::MSG_HEAT_PUMP, TPMSMessages::MSG_TPMS,
+    PowerMessages::MSG_AUX_VOLTAGE, PowerMessages::MSG_POWER_MODULE_TEMP,
+    RecuperationMessages::MSG_RECUPERATION,
+    0x18DAF1DB, 0x18DAF1DE, 0x18DAF1E0    // UDS responses (29-bit)
+};
+static const uint8_t REGISTERED_COUNT = sizeof(registered) / sizeof(registered[0]);
+
+#define TRAFFIC 4096
+#define ROUNDS 2000
+#define HIT_PERCENT 20
+
+int main() {
+    static CANDispatchTable table;
+    std::map<uint32_t, std::vector<int> > signal_map;
+    for (uint8_t i = 0; i < REGISTERED_COUNT; i++) {
+        CHECK(table.add(registered[i], i));
+        signal_map[registered[i]].push_back(i);
+    }
+    CHECK(table.getStandardCount() + table.getExtendedCount() == REGISTERED_COUNT);
+
+    static uint32_t traffic[TRAFFIC];
+    srand(1);
+    for (int i = 0; i < TRAFFIC; i++) {
+        if (rand() % 100 < HIT_PERCENT) {
+            traffic[i] = registered[rand() % REGISTERED_COUNT];
+        } else if (rand() % 10 == 0) {
+            traffic[i] = 0x18DA0000 | (uint32_t)(rand() & 0xFFFF);
+        } else {
+            traffic[i] = (uint32_t)(rand() % (CAN_STD_ID_MAX + 1));
+        }
+    }
+
+    // Both lookups agree on every frame
+    for (int i = 0; i < TRAFFIC; i++) {
+        std::map<uint32_t, std::vector<int> >::const_iterator it = signal_map.find(traffic[i]);
+        uint8_t expected = (it == signal_map.end()) ? (uint8_t)CANDispatchTable::NO_FRAME
+                                                    : (uint8_t)it->second[0];
+        CHECK(table.lookup(traffic[i]) == expected);
+    }
+
+    // The old path: find() to reject, then operator[] again for the signals
+    unsigned hits = 0;
+    uint64_t start = hostNanos();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < TRAFFIC; i++) {
+            if (signal_map.find(traffic[i]) == signal_map.end()) continue;
+            hits += (unsigned)signal_map[traffic[i]].size();
+        }
+    }
+    uint64_t map_ns = hostNanos() - start;
+    keep(hits);
+
+    start = hostNanos();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < TRAFFIC; i++) {
+            if (table.lookup(traffic[i]) != CANDispatchTable::NO_FRAME) hits++;
+        }
+    }
+    uint64_t table_ns = hostNanos() - start;
+    keep(hits);
+
+    double frames = (double)ROUNDS * TRAFFIC;
+    printf("%u registered IDs, %d%% of traffic registered\n", (unsigned)REGISTERED_COUNT, HIT_PERCENT);
+    printf("std::map:       %6.2f ns/frame\n", map_ns / frames);
+    printf("dispatch table: %6.2f ns/frame\n", table_ns / frames);
+    printf("speedup:        %6.1fx\n", table_ns ? (double)map_ns / table_ns : 0.0);
+
+    return TEST_RESULT();
+}
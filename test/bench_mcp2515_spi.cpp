@@ -0,0 +1,88 @@
+// SPI cost per received frame on the register-level MCP2515 model: the
+// driver's READ RX BUFFER / burst reads against register-by-register
+// polling (READ STATUS, READ of each buffer, BIT MODIFY to clear the flag).
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "mcp2515_model.h"
+
+#define BENCH_FRAMES 10000
+#define BENCH_SPI_HZ 8000000UL      // MCP2515_SPI_HZ default
+
+typedef struct {
+    uint32_t transactions;
+    uint32_t bytes;
+} SpiCost_t;
+
+// Polling without the dedicated instructions: one buffer per round trip
+static uint8_t readPolled(MCP2515Model& model, CANMessage_t* out) {
+    uint8_t tx[2 + MCP_BUFFER_BYTES];
+    uint8_t rx[2 + MCP_BUFFER_BYTES];
+    memset(tx, 0, sizeof(tx));
+    tx[0] = MCP_INSTR_READ;
+    tx[1] = MCP_REG_CANINTF;
+    model.transfer(tx, rx, 3);
+    uint8_t flags = rx[2];
+
+    uint8_t count = 0;
+    for (uint8_t buffer = 0; buffer < 2; buffer++) {
+        uint8_t flag = buffer ? MCP_RX1IF : MCP_RX0IF;
+        if (!(flags & flag)) continue;
+        tx[0] = MCP_INSTR_READ;
+        tx[1] = buffer ? MCP_REG_RXB1SIDH : MCP_REG_RXB0SIDH;
+        model.transfer(tx, rx, sizeof(tx));
+        out[count].id = ((uint32_t)rx[2] << 3) | (rx[3] >> 5);
+        out[count].dlc = rx[6] & 0x0F;
+        count++;
+        uint8_t clear[4] = { MCP_INSTR_BIT_MODIFY, MCP_REG_CANINTF, flag, 0x00 };
+        model.transfer(clear, nullptr, 4);
+    }
+    return count;
+}
+
+// Frames arrive in bursts of burst_size between two reads
+static SpiCost_t run(bool driver, uint8_t burst_size) {
+    MCP2515Model model;
+    MCP2515 chip(&model);
+    chip.begin(125000, 8);
+
+    CANMessage_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.dlc = 8;
+    CANMessage_t out[2];
+    uint32_t received = 0;
+
+    uint32_t start_transactions = model.transactions;
+    uint32_t start_bytes = model.bytes;
+    srand(1);
+    while (received < BENCH_FRAMES) {
+        for (uint8_t i = 0; i < burst_size; i++) {
+            msg.id = (uint32_t)(rand() % (CAN_STD_ID_MAX + 1));
+            model.receive(msg);
+        }
+        while (model.interruptPending()) {
+            received += driver ? chip.readFrames(out, 0) : readPolled(model, out);
+        }
+    }
+    SpiCost_t cost = { model.transactions - start_transactions, model.bytes - start_bytes };
+    return cost;
+}
+
+static void report(const char* name, const SpiCost_t& cost) {
+    double per_frame_bytes = (double)cost.bytes / BENCH_FRAMES;
+    printf("  %-8s %5.2f transactions/frame %5.1f bytes/frame %5.1f us/frame on the wire\n", name,
+           (double)cost.transactions / BENCH_FRAMES, per_frame_bytes,
+           per_frame_bytes * 8 * 1e6 / BENCH_SPI_HZ);
+}
+
+int main() {
+    for (uint8_t burst = 1; burst <= 2; burst++) {
+        printf("%u frame%s per interrupt:\n", (unsigned)burst, burst > 1 ? "s" : "");
+        SpiCost_t driver = run(true, burst);
+        SpiCost_t polled = run(false, burst);
+        report("driver", driver);
+        report("polled", polled);
+        CHECK(driver.transactions < polled.transactions);
+    }
+    return TEST_RESULT();
+}
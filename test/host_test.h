@@ -0,0 +1,40 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+// ============================================================================
+// HOST TESTS
+// Minimal checks and timing for the host programs under test/. A failed
+// CHECK prints its location and makes TEST_RESULT() return 1.
+// ============================================================================
+
+static int host_test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        host_test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(((a) - (b)) <= (eps) && ((b) - (a)) <= (eps))
+
+#define TEST_RESULT() (printf("%s: %s\n", __FILE__, host_test_failures ? "FAILED" : "ok"), \
+                       host_test_failures ? 1 : 0)
+
+// Monotonic nanoseconds for benchmarks
+static inline uint64_t hostNanos() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps the optimizer from dropping benchmark results
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,191 @@
+#ifndef MCP2515_MODEL_H
+#define MCP2515_MODEL_H
+
+#include <string.h>
+#include <vector>
+#include "mcp2515.h"
+
+// ============================================================================
+// MCP2515 REGISTER-LEVEL MODEL
+// Plays the chip behind MCP2515Transport: the register file, the SPI
+// instruction set the driver uses, mode changes, acceptance masks/filters
+// with RXB0 -> RXB1 rollover, interrupt flags, overflow and TXB0. Frames
+// arrive from the bus through receive(); sent frames collect in sent.
+// ============================================================================
+
+class MCP2515Model : public MCP2515Transport {
+public:
+    MCP2515Model() : present(true), hold_tx(false), transactions(0), bytes(0), delay_us(0) {
+        reset();
+    }
+
+    void reset() {
+        memset(regs, 0, sizeof(regs));
+        regs[MCP_REG_CANCTRL] = 0x87;
+        regs[MCP_REG_CANSTAT] = MCP_MODE_CONFIG;
+    }
+
+    void transfer(const uint8_t* tx, uint8_t* rx, size_t len) override {
+        transactions++;
+        bytes += len;
+        if (rx) memset(rx, present ? 0x00 : 0xFF, len);
+        if (!present || len == 0) return;
+
+        uint8_t instr = tx[0];
+        if (instr == MCP_INSTR_RESET) {
+            reset();
+        } else if (instr == MCP_INSTR_READ && len >= 2) {
+            for (size_t i = 2; i < len; i++) {
+                if (rx) rx[i] = regs[(tx[1] + i - 2) & 0x7F];
+            }
+        } else if (instr == MCP_INSTR_WRITE && len >= 2) {
+            for (size_t i = 2; i < len; i++) {
+                writeReg((uint8_t)((tx[1] + i - 2) & 0x7F), tx[i]);
+            }
+        } else if (instr == MCP_INSTR_BIT_MODIFY && len >= 4) {
+            writeReg(tx[1], (uint8_t)((regs[tx[1]] & ~tx[2]) | (tx[3] & tx[2])));
+        } else if (instr == MCP_INSTR_READ_STATUS) {
+            uint8_t status = regs[MCP_REG_CANINTF] & (MCP_RX0IF | MCP_RX1IF);
+            if (regs[MCP_REG_TXB0CTRL] & MCP_TXREQ) status |= 0x04;
+            for (size_t i = 1; i < len; i++) {
+                if (rx) rx[i] = status;
+            }
+        } else if ((instr & 0xF9) == 0x90) {
+            // READ RX BUFFER: bit 2 selects RXB1, bit 1 starts at D0
+            bool rxb1 = (instr & 0x04) != 0;
+            uint8_t base = (rxb1 ? MCP_REG_RXB1SIDH : MCP_REG_RXB0SIDH) + ((instr & 0x02) ? 5 : 0);
+            for (size_t i = 1; i < len; i++) {
+                if (rx) rx[i] = regs[(base + i - 1) & 0x7F];
+            }
+            regs[MCP_REG_CANINTF] &= (uint8_t)~(rxb1 ? MCP_RX1IF : MCP_RX0IF);
+        } else if ((instr & 0xF8) == MCP_INSTR_LOAD_TXB0 && (instr & 0x07) <= 1) {
+            uint8_t base = (MCP_REG_TXB0CTRL + 1) + ((instr & 0x01) ? 5 : 0);
+            for (size_t i = 1; i < len; i++) {
+                regs[(base + i - 1) & 0x7F] = tx[i];
+            }
+        } else if (instr == MCP_INSTR_RTS_TXB0) {
+            regs[MCP_REG_TXB0CTRL] |= MCP_TXREQ;
+            if (!hold_tx) completeTransmit();
+        }
+    }
+
+    void delayMicros(uint32_t us) override { delay_us += us; }
+
+    // A frame on the bus; false if the chip did not store it
+    bool receive(const CANMessage_t& msg) {
+        if ((regs[MCP_REG_CANSTAT] & MCP_MODE_MASK) != MCP_MODE_NORMAL) return false;
+
+        if (accepts(0, msg)) {
+            if (!(regs[MCP_REG_CANINTF] & MCP_RX0IF)) {
+                store(0, msg);
+                return true;
+            }
+            if (!(regs[MCP_REG_RXB0CTRL] & MCP_RXB0_BUKT)) {
+                regs[MCP_REG_EFLG] |= MCP_EFLG_RX0OVR;
+                return false;
+            }
+            // Rollover skips the RXB1 filters
+        } else if (!accepts(1, msg)) {
+            return false;
+        }
+        if (regs[MCP_REG_CANINTF] & MCP_RX1IF) {
+            regs[MCP_REG_EFLG] |= MCP_EFLG_RX1OVR;
+            return false;
+        }
+        store(1, msg);
+        return true;
+    }
+
+    // INT pin (active low on the chip)
+    bool interruptPending() const {
+        return (regs[MCP_REG_CANINTF] & regs[MCP_REG_CANINTE]) != 0;
+    }
+
+    void completeTransmit() {
+        if (!(regs[MCP_REG_TXB0CTRL] & MCP_TXREQ)) return;
+        CANMessage_t msg;
+        memset(&msg, 0, sizeof(msg));
+        decodeId(&regs[MCP_REG_TXB0CTRL + 1], msg.id);
+        msg.dlc = regs[MCP_REG_TXB0CTRL + 5] & 0x0F;
+        if (msg.dlc > 8) msg.dlc = 8;
+        memcpy(msg.data, &regs[MCP_REG_TXB0CTRL + 6], msg.dlc);
+        sent.push_back(msg);
+        regs[MCP_REG_TXB0CTRL] &= (uint8_t)~MCP_TXREQ;
+    }
+
+    uint8_t regs[128];
+    bool present;          // false: MISO floats high, as with no chip fitted
+    bool hold_tx;          // Leave TXREQ set until completeTransmit()
+    uint32_t transactions;
+    uint32_t bytes;
+    uint64_t delay_us;
+    std::vector<CANMessage_t> sent;
+
+private:
+    void writeReg(uint8_t reg, uint8_t value) {
+        regs[reg] = value;
+        if (reg == MCP_REG_CANCTRL) {
+            // Mode requests take effect at once
+            regs[MCP_REG_CANSTAT] = (uint8_t)((regs[MCP_REG_CANSTAT] & ~MCP_MODE_MASK) |
+                                              (value & MCP_MODE_MASK));
+        }
+    }
+
+    // Returns true for extended IDs
+    static bool decodeId(const uint8_t* r, uint32_t& id) {
+        id = ((uint32_t)r[0] << 3) | (r[1] >> 5);
+        if (!(r[1] & MCP_SIDL_IDE)) return false;
+        id = (id << 18) | ((uint32_t)(r[1] & 0x03) << 16) | ((uint32_t)r[2] << 8) | r[3];
+        return true;
+    }
+
+    bool filterMatches(uint8_t mask_reg, uint8_t filter_reg, const CANMessage_t& msg) const {
+        bool extended = msg.id > CAN_STD_ID_MAX;
+        uint32_t mask, filter;
+        decodeId(&regs[mask_reg], mask);
+        bool filter_ext = decodeId(&regs[filter_reg], filter);
+        if (filter_ext != extended) return false;
+        if (extended) {
+            // The mask IDE bit is unused; read all 29 bits
+            mask = ((uint32_t)regs[mask_reg] << 21) | ((uint32_t)(regs[mask_reg + 1] & 0xE0) << 13) |
+                   ((uint32_t)(regs[mask_reg + 1] & 0x03) << 16) |
+                   ((uint32_t)regs[mask_reg + 2] << 8) | regs[mask_reg + 3];
+        }
+        return ((msg.id ^ filter) & mask) == 0;
+    }
+
+    bool accepts(uint8_t buffer, const CANMessage_t& msg) const {
+        uint8_t ctrl = regs[buffer ? MCP_REG_RXB1CTRL : MCP_REG_RXB0CTRL];
+        if ((ctrl & MCP_RXB_RXM_OFF) == MCP_RXB_RXM_OFF) return true;
+        if (buffer == 0) {
+            return filterMatches(MCP_REG_RXM0SIDH, MCP_REG_RXF0SIDH, msg) ||
+                   filterMatches(MCP_REG_RXM0SIDH, MCP_REG_RXF1SIDH, msg);
+        }
+        static const uint8_t filters[4] = {
+            MCP_REG_RXF2SIDH, MCP_REG_RXF3SIDH, MCP_REG_RXF4SIDH, MCP_REG_RXF5SIDH
+        };
+        for (uint8_t i = 0; i < 4; i++) {
+            if (filterMatches(MCP_REG_RXM1SIDH, filters[i], msg)) return true;
+        }
+        return false;
+    }
+
+    void store(uint8_t buffer, const CANMessage_t& msg) {
+        uint8_t* r = &regs[buffer ? MCP_REG_RXB1SIDH : MCP_REG_RXB0SIDH];
+        memset(r, 0, MCP_BUFFER_BYTES);
+        if (msg.id > CAN_STD_ID_MAX) {
+            r[0] = (uint8_t)(msg.id >> 21);
+            r[1] = (uint8_t)(((msg.id >> 13) & 0xE0) | MCP_SIDL_IDE | ((msg.id >> 16) & 0x03));
+            r[2] = (uint8_t)(msg.id >> 8);
+            r[3] = (uint8_t)msg.id;
+        } else {
+            r[0] = (uint8_t)(msg.id >> 3);
+            r[1] = (uint8_t)((msg.id & 0x07) << 5);
+        }
+        r[4] = msg.dlc;
+        memcpy(&r[5], msg.data, msg.dlc <= 8 ? msg.dlc : 8);
+        regs[MCP_REG_CANINTF] |= buffer ? MCP_RX1IF : MCP_RX0IF;
+    }
+};
+
+#endif // MCP2515_MODEL_H
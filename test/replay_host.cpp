@@ -0,0 +1,119 @@
+// Trace replay on a PC: runs a candump/ASC log or a capture directory through
+// the firmware's DataManager and TraceReplayer, without a car or an ESP32.
+//
+//   replay_host [options] <trace>
+//     --realtime   release frames at their recorded spacing
+//     --record     write the publish stream to replay_publish.log next to
+//                  the trace (tools/batch_decode.py and history_decode.py
+//                  read it)
+//     --batch      batched publishing (mqtt.batch_enabled)
+//     --binary     MessagePack batches (mqtt.binary_batches)
+//     --history    compressed history blocks (mqtt.history_enabled)
+//     --windows    min/max/mean summaries (mqtt.window_summaries)
+//
+// The firmware sources build against the shims in test/shim: LittleFS is the
+// directory holding the trace, and the MQTT client never connects, so every
+// publish ends in the replayer's observer. CANHandler is replaced below by a
+// stand-in without controllers.
+
+#include <libgen.h>
+#include <string>
+#include "settings.h"
+#include "can_handler.h"
+#include "data_manager.h"
+#include "trace_replayer.h"
+
+HostSerial Serial;
+fs::LittleFSFS LittleFS;
+static SPIClass host_spi;
+
+// ----------------------------------------------------------------------------
+// CANHandler stand-in: no TWAI driver and no MCP2515; frames come from the
+// replayer only
+// ----------------------------------------------------------------------------
+
+CANHandler::CANHandler()
+    : can1_initialized(false), can2_initialized(false), msg_count1(0), msg_count2(0),
+      last_error(0), can1_speed(CAN_SPEED_HIGH),
+      can2_transport(host_spi, -1, -1, -1, 0, MCP2515_SPI_HZ), can2_controller(&can2_transport),
+      can2_burst_count(0), can2_burst_pos(0), can2_irq_pending(false), can2_irq_us(0),
+      can2_overflows(0), filter_id_count(0), rx_task_handle(nullptr), rx_task_running(false),
+      bus_off_events(0), bus_recoveries(0), last_can_activity(0) {
+    can1_filter = CANFilter::compute(nullptr, 0);
+}
+
+CANHandler::~CANHandler() {}
+
+bool CANHandler::setAcceptanceFilter(const uint32_t* ids, size_t count) {
+    can1_filter = CANFilter::compute(ids, count);
+    return true;
+}
+
+bool CANHandler::sendCAN1(const CANMessage_t&, uint32_t) {
+    return false;
+}
+
+bool CANHandler::getControllerHealth1(CANControllerHealth_t&) const {
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+
+static CANHandler can_handler;
+static MQTTHandler mqtt_handler;
+static DataManager data_manager(&can_handler, &mqtt_handler, nullptr);
+static TraceReplayer replayer(&data_manager, &mqtt_handler);
+
+static void usage() {
+    fprintf(stderr, "usage: replay_host [--realtime] [--record] [--batch] [--binary] "
+                    "[--history] [--windows] <trace>\n");
+}
+
+int main(int argc, char** argv) {
+    SettingsManager::MQTTSettings mqtt;
+    bool realtime = false;
+    bool record = false;
+    const char* trace = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--realtime") realtime = true;
+        else if (arg == "--record") record = true;
+        else if (arg == "--batch") mqtt.batch_enabled = true;
+        else if (arg == "--binary") mqtt.binary_batches = true;
+        else if (arg == "--history") mqtt.history_enabled = true;
+        else if (arg == "--windows") mqtt.window_summaries = true;
+        else if (arg[0] != '-' && trace == nullptr) trace = argv[i];
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (trace == nullptr) {
+        usage();
+        return 2;
+    }
+
+    // The trace's directory plays LittleFS; the replayer sees "/<name>"
+    std::string dir_copy = trace;
+    std::string name_copy = trace;
+    LittleFS.setRoot(dirname(&dir_copy[0]));
+    std::string path = std::string("/") + basename(&name_copy[0]);
+
+    data_manager.setBaseTopic(mqtt.base_topic);
+    data_manager.begin();
+    data_manager.setWindowSummaries(mqtt.window_summaries);
+    data_manager.setBinaryBatches(mqtt.binary_batches);
+    data_manager.setHistory(mqtt.history_enabled);
+    data_manager.configureBatching(mqtt.batch_enabled, mqtt.batch_max_bytes,
+                                   mqtt.batch_deadline_ms, mqtt.publish_interval_fast,
+                                   mqtt.publish_interval_mid);
+
+    if (!replayer.begin(path.c_str(), realtime, record)) {
+        return 1;
+    }
+    while (replayer.isActive()) {
+        replayer.loop();
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#ifndef HOST_SHIM_ARDUINO_H
+#define HOST_SHIM_ARDUINO_H
+
+// ============================================================================
+// HOST SHIM: Arduino core
+// Just enough of the Arduino API for the firmware modules the host tools
+// build (test/Makefile). Time follows the host's monotonic clock unless the
+// program runs on simulated time (hostSetMicros); pins do nothing; Serial
+// writes to stdout; tasks cannot be created.
+// ============================================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include "time_source.h"
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+
+// FreeRTOS (included by the ESP32 core's Arduino.h)
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+inline BaseType_t xTaskCreate(void (*)(void*), const char*, uint32_t, void*, unsigned,
+                              TaskHandle_t*) {
+    return pdFAIL;
+}
+inline void vTaskDelete(TaskHandle_t) {}
+inline void vTaskDelay(TickType_t) {}
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+// Simulated time: once set, millis() and micros() return it until the next call
+inline int64_t& hostSimulatedMicros() {
+    static int64_t us = -1;
+    return us;
+}
+inline void hostSetMicros(uint64_t us) { hostSimulatedMicros() = (int64_t)us; }
+inline uint64_t hostMicros() {
+    return hostSimulatedMicros() >= 0 ? (uint64_t)hostSimulatedMicros() : monotonicMicros();
+}
+
+inline unsigned long millis() { return (unsigned long)(uint32_t)(hostMicros() / 1000ULL); }
+inline unsigned long micros() { return (unsigned long)(uint32_t)hostMicros(); }
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    void print(const char* s) { fputs(s, stdout); }
+    void println(const char* s) { puts(s); }
+    void println() { putchar('\n'); }
+    int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vprintf(fmt, args);
+        va_end(args);
+        return n;
+    }
+};
+extern HostSerial Serial;
+
+#endif // HOST_SHIM_ARDUINO_H
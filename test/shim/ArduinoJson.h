@@ -0,0 +1,341 @@
+#ifndef HOST_SHIM_ARDUINOJSON_H
+#define HOST_SHIM_ARDUINOJSON_H
+
+// ============================================================================
+// HOST SHIM: ArduinoJson 6 (serialization only)
+// Used when the real library is not installed (test/Makefile prefers
+// .pio/libdeps). Covers the document API the firmware uses to build
+// payloads and models the capacity of a StaticJsonDocument on a 32-bit
+// target: 16 bytes per member or element plus copied (non-const) keys, so
+// overflowed() trips where it would on the ESP32. Numbers print in their
+// shortest round-trip form, which can differ from the library in the last
+// digit.
+// ============================================================================
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+class JsonDocument;
+
+namespace ArduinoJsonShim {
+
+enum NodeType { NODE_NULL, NODE_OBJECT, NODE_ARRAY, NODE_BOOL, NODE_INT, NODE_UINT,
+                NODE_FLOAT, NODE_DOUBLE, NODE_STRING };
+
+struct Node {
+    Node() : type(NODE_NULL), i(0), u(0), d(0), b(false) {}
+    NodeType type;
+    int64_t i;
+    uint64_t u;
+    double d;
+    bool b;
+    std::string s;
+    std::vector<std::pair<std::string, std::shared_ptr<Node> > > members;
+    std::vector<std::shared_ptr<Node> > elements;
+
+    Node* find(const char* key) {
+        for (size_t k = 0; k < members.size(); k++) {
+            if (members[k].first == key) return members[k].second.get();
+        }
+        return nullptr;
+    }
+};
+
+const size_t SLOT_SIZE = 16;  // sizeof(VariantSlot) on a 32-bit target
+
+template <typename T, bool is_signed = (T(-1) < T(0))>
+struct IntegerSetter {
+    static void set(Node& node, T value) { node.type = NODE_INT; node.i = (int64_t)value; }
+};
+template <typename T>
+struct IntegerSetter<T, false> {
+    static void set(Node& node, T value) { node.type = NODE_UINT; node.u = (uint64_t)value; }
+};
+
+inline void setValue(Node& node, bool value) { node.type = NODE_BOOL; node.b = value; }
+inline void setValue(Node& node, float value) { node.type = NODE_FLOAT; node.d = value; }
+inline void setValue(Node& node, double value) { node.type = NODE_DOUBLE; node.d = value; }
+inline void setValue(Node& node, const char* value) {
+    if (!value) {
+        node.type = NODE_NULL;
+        return;
+    }
+    node.type = NODE_STRING;
+    node.s = value;
+}
+inline void setValue(Node& node, char* value) { setValue(node, (const char*)value); }
+template <typename T>
+inline void setValue(Node& node, T value) { IntegerSetter<T>::set(node, value); }
+
+void writeNode(const Node& node, std::string& out);
+
+} // namespace ArduinoJsonShim
+
+class JsonArray;
+
+class JsonObject {
+public:
+    JsonObject() : node(nullptr), doc(nullptr) {}
+    JsonObject(ArduinoJsonShim::Node* node, JsonDocument* doc) : node(node), doc(doc) {}
+
+    class MemberRef {
+    public:
+        MemberRef(ArduinoJsonShim::Node* node, JsonDocument* doc, const char* key, bool copy_key)
+            : node(node), doc(doc), key(key), copy_key(copy_key) {}
+        template <typename T>
+        MemberRef& operator=(T value) {
+            ArduinoJsonShim::Node* member = JsonObject(node, doc).member(key, copy_key);
+            if (member) ArduinoJsonShim::setValue(*member, value);
+            return *this;
+        }
+    private:
+        ArduinoJsonShim::Node* node;
+        JsonDocument* doc;
+        const char* key;
+        bool copy_key;
+    };
+
+    MemberRef operator[](const char* key) const { return MemberRef(node, doc, key, false); }
+    MemberRef operator[](char* key) const { return MemberRef(node, doc, key, true); }
+
+    JsonObject createNestedObject(const char* key) const { return nestedObject(key, false); }
+    JsonObject createNestedObject(char* key) const { return nestedObject(key, true); }
+    JsonArray createNestedArray(const char* key) const;
+    JsonArray createNestedArray(char* key) const;
+
+    void remove(const char* key) const {
+        if (!node) return;
+        for (size_t k = 0; k < node->members.size(); k++) {
+            if (node->members[k].first == key) {
+                node->members.erase(node->members.begin() + k);
+                return;
+            }
+        }
+    }
+    size_t size() const { return node ? node->members.size() : 0; }
+    bool isNull() const { return node == nullptr; }
+
+private:
+    friend class JsonArray;
+    ArduinoJsonShim::Node* node;
+    JsonDocument* doc;
+
+    ArduinoJsonShim::Node* member(const char* key, bool copy_key) const;
+    JsonObject nestedObject(const char* key, bool copy_key) const {
+        ArduinoJsonShim::Node* child = member(key, copy_key);
+        if (!child) return JsonObject();
+        child->type = ArduinoJsonShim::NODE_OBJECT;
+        return JsonObject(child, doc);
+    }
+};
+
+class JsonArray {
+public:
+    JsonArray() : node(nullptr), doc(nullptr) {}
+    JsonArray(ArduinoJsonShim::Node* node, JsonDocument* doc) : node(node), doc(doc) {}
+
+    template <typename T>
+    bool add(T value) const {
+        ArduinoJsonShim::Node* element = append();
+        if (!element) return false;
+        ArduinoJsonShim::setValue(*element, value);
+        return true;
+    }
+    JsonObject createNestedObject() const {
+        ArduinoJsonShim::Node* element = append();
+        if (!element) return JsonObject();
+        element->type = ArduinoJsonShim::NODE_OBJECT;
+        return JsonObject(element, doc);
+    }
+    size_t size() const { return node ? node->elements.size() : 0; }
+    bool isNull() const { return node == nullptr; }
+
+private:
+    ArduinoJsonShim::Node* node;
+    JsonDocument* doc;
+
+    ArduinoJsonShim::Node* append() const;
+};
+
+class JsonDocument {
+public:
+    explicit JsonDocument(size_t capacity) : capacity(capacity) { clear(); }
+
+    void clear() {
+        root.reset(new ArduinoJsonShim::Node());
+        root->type = ArduinoJsonShim::NODE_OBJECT;
+        used = 0;
+        overflow = false;
+    }
+    bool overflowed() const { return overflow; }
+    size_t memoryUsage() const { return used; }
+    size_t getCapacity() const { return capacity; }
+
+    JsonObject::MemberRef operator[](const char* key) { return object()[key]; }
+    JsonObject::MemberRef operator[](char* key) { return object()[key]; }
+    JsonObject createNestedObject(const char* key) { return object().createNestedObject(key); }
+    JsonObject createNestedObject(char* key) { return object().createNestedObject(key); }
+    JsonArray createNestedArray(const char* key) { return object().createNestedArray(key); }
+    JsonArray createNestedArray(char* key) { return object().createNestedArray(key); }
+    void remove(const char* key) { object().remove(key); }
+
+    const ArduinoJsonShim::Node& getRoot() const { return *root; }
+
+    // Account for a new slot; false once the capacity is used up
+    bool allocate(size_t bytes) {
+        if (used + bytes > capacity) {
+            overflow = true;
+            return false;
+        }
+        used += bytes;
+        return true;
+    }
+
+private:
+    size_t capacity;
+    size_t used;
+    bool overflow;
+    std::unique_ptr<ArduinoJsonShim::Node> root;
+
+    JsonObject object() { return JsonObject(root.get(), this); }
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument {
+public:
+    StaticJsonDocument() : JsonDocument(N) {}
+};
+
+inline ArduinoJsonShim::Node* JsonObject::member(const char* key, bool copy_key) const {
+    if (!node || node->type != ArduinoJsonShim::NODE_OBJECT) return nullptr;
+    ArduinoJsonShim::Node* existing = node->find(key);
+    if (existing) return existing;
+    size_t bytes = ArduinoJsonShim::SLOT_SIZE + (copy_key ? strlen(key) + 1 : 0);
+    if (!doc->allocate(bytes)) return nullptr;
+    node->members.push_back(std::make_pair(std::string(key),
+                                           std::make_shared<ArduinoJsonShim::Node>()));
+    return node->members.back().second.get();
+}
+
+inline JsonArray JsonObject::createNestedArray(const char* key) const {
+    ArduinoJsonShim::Node* child = member(key, false);
+    if (!child) return JsonArray();
+    child->type = ArduinoJsonShim::NODE_ARRAY;
+    return JsonArray(child, doc);
+}
+
+inline JsonArray JsonObject::createNestedArray(char* key) const {
+    ArduinoJsonShim::Node* child = member(key, true);
+    if (!child) return JsonArray();
+    child->type = ArduinoJsonShim::NODE_ARRAY;
+    return JsonArray(child, doc);
+}
+
+inline ArduinoJsonShim::Node* JsonArray::append() const {
+    if (!node || !doc->allocate(ArduinoJsonShim::SLOT_SIZE)) return nullptr;
+    node->elements.push_back(std::make_shared<ArduinoJsonShim::Node>());
+    return node->elements.back().get();
+}
+
+namespace ArduinoJsonShim {
+
+inline void writeString(const std::string& s, std::string& out) {
+    out += '"';
+    for (size_t k = 0; k < s.size(); k++) {
+        char c = s[k];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+inline void writeReal(double value, bool single, std::string& out) {
+    if (isnan(value) || isinf(value)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    if (value == floor(value) && fabs(value) < 1e15) {
+        snprintf(buffer, sizeof(buffer), "%.0f", value);
+    } else {
+        // Shortest text that reads back as the same float or double
+        for (int precision = 1; precision <= 17; precision++) {
+            snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+            double back = strtod(buffer, nullptr);
+            if (single ? (float)back == (float)value : back == value) break;
+        }
+    }
+    out += buffer;
+}
+
+inline void writeNode(const Node& node, std::string& out) {
+    char buffer[24];
+    switch (node.type) {
+        case NODE_NULL: out += "null"; break;
+        case NODE_BOOL: out += node.b ? "true" : "false"; break;
+        case NODE_INT:
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)node.i);
+            out += buffer;
+            break;
+        case NODE_UINT:
+            snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)node.u);
+            out += buffer;
+            break;
+        case NODE_FLOAT: writeReal(node.d, true, out); break;
+        case NODE_DOUBLE: writeReal(node.d, false, out); break;
+        case NODE_STRING: writeString(node.s, out); break;
+        case NODE_OBJECT:
+            out += '{';
+            for (size_t k = 0; k < node.members.size(); k++) {
+                if (k) out += ',';
+                writeString(node.members[k].first, out);
+                out += ':';
+                writeNode(*node.members[k].second, out);
+            }
+            out += '}';
+            break;
+        case NODE_ARRAY:
+            out += '[';
+            for (size_t k = 0; k < node.elements.size(); k++) {
+                if (k) out += ',';
+                writeNode(*node.elements[k], out);
+            }
+            out += ']';
+            break;
+    }
+}
+
+} // namespace ArduinoJsonShim
+
+inline size_t measureJson(const JsonDocument& doc) {
+    std::string out;
+    ArduinoJsonShim::writeNode(doc.getRoot(), out);
+    return out.size();
+}
+
+// Like the library: truncates to size - 1 characters plus the terminator
+inline size_t serializeJson(const JsonDocument& doc, char* buffer, size_t size) {
+    std::string out;
+    ArduinoJsonShim::writeNode(doc.getRoot(), out);
+    if (size == 0) return 0;
+    size_t n = out.size() < size - 1 ? out.size() : size - 1;
+    memcpy(buffer, out.data(), n);
+    buffer[n] = '\0';
+    return n;
+}
+
+#endif // HOST_SHIM_ARDUINOJSON_H
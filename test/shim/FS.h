@@ -0,0 +1,125 @@
+#ifndef HOST_SHIM_FS_H
+#define HOST_SHIM_FS_H
+
+// ============================================================================
+// HOST SHIM: Arduino FS on the host file system
+// Paths are taken relative to a root directory (the current directory
+// unless setRoot() says otherwise), so "/outbox" stays inside it.
+// ============================================================================
+
+#include <Arduino.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+namespace fs {
+
+class File {
+public:
+    File() {}
+
+    static File open(const std::string& host_path, const std::string& name, const char* mode) {
+        File file;
+        struct stat info;
+        if (stat(host_path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            DIR* dir = opendir(host_path.c_str());
+            if (!dir) return file;
+            file.handle = std::make_shared<Handle>(nullptr, dir, host_path, name);
+            return file;
+        }
+        FILE* fp = fopen(host_path.c_str(), mode);
+        if (!fp) return file;
+        file.handle = std::make_shared<Handle>(fp, nullptr, host_path, name);
+        return file;
+    }
+
+    explicit operator bool() const { return handle && (handle->fp || handle->dir); }
+
+    size_t read(uint8_t* buffer, size_t size) {
+        return (handle && handle->fp) ? fread(buffer, 1, size, handle->fp) : 0;
+    }
+    size_t write(const uint8_t* buffer, size_t size) {
+        return (handle && handle->fp) ? fwrite(buffer, 1, size, handle->fp) : 0;
+    }
+    size_t write(uint8_t value) { return write(&value, 1); }
+    bool seek(uint32_t pos) {
+        return handle && handle->fp && fseek(handle->fp, (long)pos, SEEK_SET) == 0;
+    }
+    size_t position() const { return (handle && handle->fp) ? (size_t)ftell(handle->fp) : 0; }
+    size_t size() const {
+        struct stat info;
+        if (handle && handle->fp) fflush(handle->fp);
+        return (handle && stat(handle->host_path.c_str(), &info) == 0) ? (size_t)info.st_size : 0;
+    }
+    int available() { return (int)(size() - position()); }
+    void flush() {
+        if (handle && handle->fp) fflush(handle->fp);
+    }
+    void close() { handle.reset(); }
+
+    bool isDirectory() const { return handle && handle->dir; }
+    const char* name() const { return handle ? handle->name.c_str() : ""; }
+
+    File openNextFile() {
+        if (!handle || !handle->dir) return File();
+        struct dirent* entry;
+        while ((entry = readdir(handle->dir)) != nullptr) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            return open(handle->host_path + "/" + entry->d_name, entry->d_name, "r");
+        }
+        return File();
+    }
+
+private:
+    struct Handle {
+        Handle(FILE* fp, DIR* dir, const std::string& host_path, const std::string& name)
+            : fp(fp), dir(dir), host_path(host_path), name(name) {}
+        ~Handle() {
+            if (fp) fclose(fp);
+            if (dir) closedir(dir);
+        }
+        FILE* fp;
+        DIR* dir;
+        std::string host_path;
+        std::string name;
+    };
+    std::shared_ptr<Handle> handle;
+};
+
+class FS {
+public:
+    FS() : root(".") {}
+
+    void setRoot(const char* dir) { root = dir; }
+
+    File open(const char* path, const char* mode = "r") {
+        const char* slash = strrchr(path, '/');
+        return File::open(hostPath(path), slash ? slash + 1 : path, mode);
+    }
+    bool exists(const char* path) {
+        struct stat info;
+        return stat(hostPath(path).c_str(), &info) == 0;
+    }
+    bool remove(const char* path) { return ::unlink(hostPath(path).c_str()) == 0; }
+    bool mkdir(const char* path) { return ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+    bool rmdir(const char* path) { return ::rmdir(hostPath(path).c_str()) == 0; }
+    bool rename(const char* from, const char* to) {
+        return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+    }
+
+private:
+    std::string root;
+
+    std::string hostPath(const char* path) const {
+        return root + (path[0] == '/' ? "" : "/") + path;
+    }
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // HOST_SHIM_FS_H
@@ -0,0 +1,18 @@
+#ifndef HOST_SHIM_LITTLEFS_H
+#define HOST_SHIM_LITTLEFS_H
+
+// HOST SHIM: LittleFS as a directory on the host (see FS.h)
+
+#include <FS.h>
+
+namespace fs {
+class LittleFSFS : public FS {
+public:
+    bool begin(bool = false) { return true; }
+    void end() {}
+};
+}
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // HOST_SHIM_LITTLEFS_H
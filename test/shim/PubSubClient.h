@@ -0,0 +1,29 @@
+#ifndef HOST_SHIM_PUBSUBCLIENT_H
+#define HOST_SHIM_PUBSUBCLIENT_H
+
+// HOST SHIM: MQTT client without a network; it never connects, so every
+// publish stays with MQTTHandler's observer and queues
+
+#include <Arduino.h>
+#include <functional>
+
+#define MQTT_DISCONNECTED -1
+
+class PubSubClient {
+public:
+    typedef std::function<void(char*, uint8_t*, unsigned int)> Callback;
+
+    PubSubClient& setServer(const char*, uint16_t) { return *this; }
+    PubSubClient& setCallback(Callback) { return *this; }
+    bool setBufferSize(uint16_t) { return true; }
+    bool connect(const char*) { return false; }
+    bool connect(const char*, const char*, const char*) { return false; }
+    void disconnect() {}
+    bool connected() { return false; }
+    bool loop() { return false; }
+    int state() { return MQTT_DISCONNECTED; }
+    bool publish(const char*, const uint8_t*, unsigned int, bool) { return false; }
+    bool subscribe(const char*) { return false; }
+};
+
+#endif // HOST_SHIM_PUBSUBCLIENT_H
@@ -0,0 +1,27 @@
+#ifndef HOST_SHIM_SPI_H
+#define HOST_SHIM_SPI_H
+
+// HOST SHIM: SPI bus that is never wired to anything
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings {
+public:
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass {
+public:
+    void begin(int8_t, int8_t, int8_t, int8_t) {}
+    void end() {}
+    void beginTransaction(const SPISettings&) {}
+    void endTransaction() {}
+    void transferBytes(const uint8_t*, uint8_t* rx, uint32_t len) {
+        if (rx) memset(rx, 0xFF, len);
+    }
+};
+
+#endif // HOST_SHIM_SPI_H
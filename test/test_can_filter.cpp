@@ -0,0 +1,123 @@
+// CANFilter: every wanted ID passes the TWAI registers, and the admitted
+// counts match the IDs the registers really let through. Prints how many
+// IDs each mask admits for the Zoe ID sets.
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "can_filter.h"
+#include "can_messages.h"
+
+// TWAI acceptance check on the register values, as the controller applies it
+static bool twaiAccepts(const CANFilterConfig_t& config, uint32_t id) {
+    if (config.accept_all) return true;
+    if (config.extended) {
+        return (((id << 3) ^ config.acceptance_code) & ~config.acceptance_mask) == 0;
+    }
+    if (config.single_filter) {
+        return (((id << 21) ^ config.acceptance_code) & ~config.acceptance_mask) == 0;
+    }
+    bool first = (((id << 21) ^ config.acceptance_code) & ~config.acceptance_mask & 0xFFFF0000UL) == 0;
+    bool second = (((id << 5) ^ config.acceptance_code) & ~config.acceptance_mask & 0x0000FFFFUL) == 0;
+    return first || second;
+}
+
+static uint32_t countStandardAdmitted(const CANFilterConfig_t& config) {
+    uint32_t admitted = 0;
+    for (uint32_t id = 0; id <= CAN_STD_ID_MAX; id++) {
+        if (twaiAccepts(config, id)) admitted++;
+    }
+    return admitted;
+}
+
+static void checkConfig(const CANFilterConfig_t& config, const uint32_t* ids, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        CHECK(twaiAccepts(config, ids[i]));
+    }
+    if (config.accept_all) return;
+    if (!config.extended) {
+        CHECK(countStandardAdmitted(config) == config.admitted_total);
+    }
+    uint32_t filter_sum = 0;
+    for (uint8_t f = 0; f < config.filter_count; f++) filter_sum += config.filter[f].admitted;
+    CHECK(config.admitted_total <= filter_sum);
+    CHECK(config.admitted_total >= count);
+}
+
+static void report(const char* name, const uint32_t* ids, size_t count) {
+    CANFilterConfig_t config = CANFilter::compute(ids, count);
+    checkConfig(config, ids, count);
+
+    printf("%s: %u wanted", name, (unsigned)config.wanted);
+    if (config.accept_all) {
+        printf(", accept all\n");
+        return;
+    }
+    printf(", %s %s filter\n", config.extended ? "29-bit" : "11-bit",
+           config.single_filter ? "single" : "dual");
+    for (uint8_t f = 0; f < config.filter_count; f++) {
+        printf("  filter %u: code 0x%08X mask 0x%08X admits %u\n", (unsigned)f + 1,
+               (unsigned)config.filter[f].code, (unsigned)config.filter[f].mask,
+               (unsigned)config.filter[f].admitted);
+    }
+    printf("  admitted %u, %u unwanted left to the dispatch table\n",
+           (unsigned)config.admitted_total, (unsigned)(config.admitted_total - config.wanted));
+}
+
+int main() {
+    // IDs DataManager registers by default, with the LBC diagnostic response
+    const uint32_t zoe_default[] = {
+        BatteryMessages::MSG_BATTERY_STATUS, BatteryMessages::MSG_BATTERY_POWER,
+        ChargingMessages::MSG_CHARGE_STATUS, MotionMessages::MSG_SPEED,
+        MotionMessages::MSG_CONSUMPTION, ClimateMessages::MSG_INTERIOR_TEMP,
+        TPMSMessages::MSG_TPMS, PowerMessages::MSG_AUX_VOLTAGE, DiagnosticMessages::LBC_RX_ID
+    };
+    // Every frame in the signal tables
+    const uint32_t zoe_all[] = {
+        BatteryMessages::MSG_BATTERY_STATUS, BatteryMessages::MSG_CELL_VOLTAGES,
+        BatteryMessages::MSG_BATTERY_TEMP, BatteryMessages::MSG_BATTERY_POWER,
+        BatteryMessages::MSG_BATTERY_CAPACITY, BatteryMessages::MSG_CHARGE_CYCLES,
+        ChargingMessages::MSG_CHARGE_STATUS, MotionMessages::MSG_SPEED,
+        MotionMessages::MSG_MOTOR_STATUS, MotionMessages::MSG_CONSUMPTION, MotionMessages::MSG_RANGE,
+        ClimateMessages::MSG_INTERIOR_TEMP, ClimateMessages::MSG_HEAT_PUMP,
+        TPMSMessages::MSG_TPMS, PowerMessages::MSG_AUX_VOLTAGE, PowerMessages::MSG_POWER_MODULE_TEMP,
+        RecuperationMessages::MSG_RECUPERATION
+    };
+    const uint32_t single[] = {ChargingMessages::MSG_CHARGE_STATUS};
+    const uint32_t extended[] = {0x18DAF1DB, 0x18DAF1DE, 0x18DAF1E0};
+    const uint32_t mixed[] = {MotionMessages::MSG_SPEED, 0x18DAF1DB};
+
+    report("zoe default", zoe_default, sizeof(zoe_default) / sizeof(zoe_default[0]));
+    report("zoe all", zoe_all, sizeof(zoe_all) / sizeof(zoe_all[0]));
+    report("single", single, 1);
+    report("uds extended", extended, 3);
+    report("mixed 11/29-bit", mixed, 2);
+
+    // A single ID is matched exactly
+    CANFilterConfig_t config = CANFilter::compute(single, 1);
+    CHECK(!config.accept_all && config.admitted_total == 1);
+
+    // Mixed frame types and empty sets fall back to accept all
+    CHECK(CANFilter::compute(mixed, 2).accept_all);
+    CHECK(CANFilter::compute(nullptr, 0).accept_all);
+
+    // Extended: the mask only leaves the differing bits open
+    config = CANFilter::compute(extended, 3);
+    CHECK(config.extended && config.single_filter);
+    CHECK(config.admitted_total == (1UL << 6));
+
+    // The dual filter never admits more than the single cover
+    size_t zoe_count = sizeof(zoe_default) / sizeof(zoe_default[0]);
+    CHECK(CANFilter::compute(zoe_default, zoe_count).admitted_total <=
+          CANFilter::cover(zoe_default, zoe_count, 11).admitted);
+
+    // Random 11-bit sets against the brute-force count
+    srand(1);
+    for (int round = 0; round < 200; round++) {
+        uint32_t ids[16];
+        size_t count = 1 + (size_t)(rand() % 16);
+        for (size_t i = 0; i < count; i++) ids[i] = (uint32_t)(rand() % (CAN_STD_ID_MAX + 1));
+        checkConfig(CANFilter::compute(ids, count), ids, count);
+    }
+
+    return TEST_RESULT();
+}
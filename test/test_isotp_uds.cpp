@@ -0,0 +1,412 @@
+// ISO-TP links and the diagnostic scheduler against a simulated ECU on a
+// simulated bus: single and multi-frame transfers both ways, flow control,
+// timeouts, response pending, refusals, backoff of a sleeping ECU and the
+// bus load gate.
+
+#include <string.h>
+#include <vector>
+#include "host_test.h"
+#include "isotp.h"
+#include "uds_scheduler.h"
+
+#define TESTER_ID 0x79B      // LBC request ID
+#define ECU_ID 0x7BB         // LBC response ID
+#define CELL_BYTES 124       // 62 cells of 16 bits
+
+typedef struct {
+    uint32_t id;
+    uint8_t data[8];
+    uint8_t len;
+} Frame_t;
+
+// Frames in transmission order; refuses frames while full is set
+class SimBus : public IsoTpSender {
+public:
+    std::vector<Frame_t> frames;
+    std::vector<Frame_t> log;
+    bool full = false;
+
+    bool sendFrame(uint32_t id, const uint8_t* data, uint8_t len) override {
+        if (full) return false;
+        Frame_t frame;
+        frame.id = id;
+        frame.len = len;
+        memcpy(frame.data, data, len);
+        frames.push_back(frame);
+        log.push_back(frame);
+        return true;
+    }
+
+    size_t sentBy(uint32_t id) const {
+        size_t count = 0;
+        for (size_t i = 0; i < log.size(); i++) {
+            if (log[i].id == id) count++;
+        }
+        return count;
+    }
+};
+
+// Answers 0x21 requests with the PID and a counting payload of
+// response_len bytes
+class SimulatedEcu {
+public:
+    enum Mode { ANSWER, ASLEEP, PENDING, REFUSE };
+
+    Mode mode = ANSWER;
+    uint16_t response_len = CELL_BYTES;
+    uint32_t pending_us = 2000000;     // Delay after NRC 0x78
+    uint32_t requests = 0;
+
+    explicit SimulatedEcu(SimBus& bus) {
+        link.begin(&bus, ECU_ID, TESTER_ID);
+    }
+
+    void onFrame(const uint8_t* data, uint8_t dlc, uint32_t now_us) {
+        if (mode != ASLEEP) link.onFrame(data, dlc, now_us);
+    }
+
+    void poll(uint32_t now_us) {
+        link.poll(now_us);
+        if (answer_due && (int32_t)(now_us - answer_at_us) >= 0) {
+            answer_due = false;
+            answer(now_us);
+        }
+
+        const uint8_t* data;
+        uint16_t len;
+        if (!link.receive(data, len)) return;
+        requests++;
+        memcpy(request, data, 2);
+        if (mode == REFUSE) {
+            uint8_t nrc[3] = {UDS_NEGATIVE_RESPONSE, request[0], 0x22};
+            link.send(nrc, sizeof(nrc), now_us);
+        } else if (mode == PENDING) {
+            uint8_t nrc[3] = {UDS_NEGATIVE_RESPONSE, request[0], UDS_NRC_RESPONSE_PENDING};
+            link.send(nrc, sizeof(nrc), now_us);
+            answer_due = true;
+            answer_at_us = now_us + pending_us;
+        } else {
+            answer(now_us);
+        }
+    }
+
+private:
+    IsoTpLink link;
+    uint8_t request[2];
+    bool answer_due = false;
+    uint32_t answer_at_us = 0;
+
+    void answer(uint32_t now_us) {
+        uint8_t response[2 + CELL_BYTES];
+        response[0] = (uint8_t)(request[0] + UDS_POSITIVE_OFFSET);
+        response[1] = request[1];
+        for (uint16_t i = 0; i < response_len; i++) response[2 + i] = (uint8_t)(request[1] + i);
+        link.send(response, (uint16_t)(2 + response_len), now_us);
+    }
+};
+
+// Delivers queued frames until the bus is quiet
+template <typename Tester>
+static void deliver(SimBus& bus, SimulatedEcu& ecu, Tester& tester, uint32_t now_us) {
+    while (!bus.frames.empty()) {
+        Frame_t frame = bus.frames.front();
+        bus.frames.erase(bus.frames.begin());
+        if (frame.id == TESTER_ID) {
+            ecu.onFrame(frame.data, frame.len, now_us);
+            ecu.poll(now_us);
+        } else {
+            tester.onFrame(frame.data, frame.len, now_us);
+        }
+    }
+}
+
+// Routes the tester side of deliver() to a bare link
+struct LinkTester {
+    IsoTpLink& link;
+    void onFrame(const uint8_t* data, uint8_t len, uint32_t now_us) {
+        link.onFrame(data, len, now_us);
+    }
+};
+
+// Routes the tester side of deliver() to the scheduler
+struct SchedulerTester {
+    UdsScheduler& scheduler;
+    void onFrame(const uint8_t* data, uint8_t len, uint32_t now_us) {
+        scheduler.onFrame(ECU_ID, data, len, now_us);
+    }
+};
+
+// ----------------------------------------------------------------------------
+// ISO-TP
+// ----------------------------------------------------------------------------
+
+static void testSingleFrame() {
+    SimBus bus;
+    IsoTpLink tester;
+    tester.begin(&bus, TESTER_ID, ECU_ID);
+    SimulatedEcu ecu(bus);
+    ecu.response_len = 3;
+    LinkTester route = {tester};
+
+    uint8_t request[2] = {0x21, 0x04};
+    CHECK(tester.send(request, sizeof(request), 1000));
+    CHECK(bus.frames.size() == 1);
+    CHECK(bus.frames[0].len == 8 && bus.frames[0].data[0] == 0x02);
+    CHECK(bus.frames[0].data[3] == ISOTP_PADDING);
+    deliver(bus, ecu, route, 1000);
+
+    const uint8_t* data;
+    uint16_t len;
+    CHECK(tester.receive(data, len));
+    CHECK(len == 5);
+    CHECK(data[0] == 0x61 && data[1] == 0x04 && data[2] == 0x04 && data[4] == 0x06);
+    CHECK(tester.isIdle());
+}
+
+static void testMultiFrameResponse() {
+    SimBus bus;
+    IsoTpLink tester;
+    tester.begin(&bus, TESTER_ID, ECU_ID);
+    SimulatedEcu ecu(bus);
+    LinkTester route = {tester};
+
+    uint8_t request[2] = {0x21, 0x41};
+    CHECK(tester.send(request, sizeof(request), 1000));
+    deliver(bus, ecu, route, 1000);
+
+    // Request, first frame, flow control, then 18 consecutive frames
+    uint16_t total = 2 + CELL_BYTES;
+    CHECK(bus.log.size() == 21);
+    CHECK(bus.log[1].data[0] == (ISOTP_PCI_FIRST | (total >> 8)) && bus.log[1].data[1] == total);
+    CHECK(bus.log[2].id == TESTER_ID && bus.log[2].data[0] == ISOTP_PCI_FLOW_CONTROL);
+    CHECK(bus.log[3].data[0] == (ISOTP_PCI_CONSECUTIVE | 1));
+    CHECK(bus.log[17].data[0] == (ISOTP_PCI_CONSECUTIVE | 15));
+    CHECK(bus.log[18].data[0] == (ISOTP_PCI_CONSECUTIVE | 0));
+
+    const uint8_t* data;
+    uint16_t len;
+    CHECK(tester.receive(data, len));
+    CHECK(len == total);
+    bool intact = data[0] == 0x61 && data[1] == 0x41;
+    for (uint16_t i = 0; i < CELL_BYTES; i++) intact = intact && data[2 + i] == (uint8_t)(0x41 + i);
+    CHECK(intact);
+}
+
+static void testFlowControlPacing() {
+    SimBus bus;
+    IsoTpLink tester;
+    tester.begin(&bus, TESTER_ID, ECU_ID);
+
+    uint8_t message[30];
+    for (uint8_t i = 0; i < sizeof(message); i++) message[i] = i;
+    CHECK(tester.send(message, sizeof(message), 0));
+    CHECK(tester.getState() == ISOTP_TX_WAIT_FC);
+
+    // Block size 2, STmin 5 ms
+    uint8_t fc[3] = {ISOTP_PCI_FLOW_CONTROL | ISOTP_FS_CTS, 2, 5};
+    tester.onFrame(fc, sizeof(fc), 100);
+    CHECK(bus.frames.size() == 2);        // First frame and one CF right away
+    tester.poll(4000);
+    CHECK(bus.frames.size() == 2);        // STmin not yet elapsed
+    tester.poll(5100);
+    CHECK(bus.frames.size() == 3);
+    CHECK(tester.getState() == ISOTP_TX_WAIT_FC);
+
+    tester.onFrame(fc, sizeof(fc), 6000);
+    tester.poll(11000);
+    CHECK(bus.frames.size() == 5);
+    CHECK(tester.isIdle());
+    CHECK(bus.frames[4].data[0] == (ISOTP_PCI_CONSECUTIVE | 4));
+    CHECK(bus.frames[4].data[1] == 27 && bus.frames[4].data[4] == ISOTP_PADDING);
+
+    // Flow control wait restarts N_Bs; overflow aborts
+    bus.frames.clear();
+    CHECK(tester.send(message, sizeof(message), 20000));
+    uint8_t wait[3] = {ISOTP_PCI_FLOW_CONTROL | ISOTP_FS_WAIT, 0, 0};
+    tester.onFrame(wait, sizeof(wait), 20000 + ISOTP_TIMEOUT_US - 1000);
+    tester.poll(20000 + ISOTP_TIMEOUT_US + 1000);
+    CHECK(tester.getState() == ISOTP_TX_WAIT_FC);
+    uint8_t overflow[3] = {ISOTP_PCI_FLOW_CONTROL | ISOTP_FS_OVERFLOW, 0, 0};
+    tester.onFrame(overflow, sizeof(overflow), 20000 + ISOTP_TIMEOUT_US + 2000);
+    CHECK(tester.getState() == ISOTP_ERROR && tester.getError() == ISOTP_ERR_OVERFLOW);
+}
+
+static void testReceiveErrors() {
+    SimBus bus;
+    IsoTpLink tester;
+    tester.begin(&bus, TESTER_ID, ECU_ID);
+
+    // Longer than ISOTP_MAX_PAYLOAD: refused with an overflow flow control
+    uint16_t too_long = ISOTP_MAX_PAYLOAD + 1;
+    uint8_t first[8] = {(uint8_t)(ISOTP_PCI_FIRST | (too_long >> 8)), (uint8_t)too_long, 0, 0, 0, 0, 0, 0};
+    tester.onFrame(first, 8, 0);
+    CHECK(tester.getError() == ISOTP_ERR_OVERFLOW);
+    CHECK(bus.frames.size() == 1 && bus.frames[0].data[0] == (ISOTP_PCI_FLOW_CONTROL | ISOTP_FS_OVERFLOW));
+
+    // Consecutive frame out of sequence
+    tester.reset();
+    first[0] = ISOTP_PCI_FIRST;
+    first[1] = 20;
+    tester.onFrame(first, 8, 0);
+    CHECK(tester.getState() == ISOTP_RX_RECEIVING);
+    uint8_t cf[8] = {ISOTP_PCI_CONSECUTIVE | 2, 0, 0, 0, 0, 0, 0, 0};
+    tester.onFrame(cf, 8, 100);
+    CHECK(tester.getError() == ISOTP_ERR_SEQUENCE);
+
+    // Sender stops after the first frame
+    tester.reset();
+    tester.onFrame(first, 8, 0);
+    tester.poll(ISOTP_TIMEOUT_US);
+    CHECK(tester.getState() == ISOTP_RX_RECEIVING);
+    tester.poll(ISOTP_TIMEOUT_US + 1);
+    CHECK(tester.getError() == ISOTP_ERR_TIMEOUT);
+
+    // Full TX queue: the request is not sent
+    tester.reset();
+    bus.full = true;
+    uint8_t request[2] = {0x21, 0x41};
+    CHECK(!tester.send(request, sizeof(request), 0));
+    CHECK(tester.getError() == ISOTP_ERR_SEND);
+}
+
+// ----------------------------------------------------------------------------
+// Scheduler
+// ----------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t responses[UDS_MAX_REQUESTS];
+    uint16_t last_len;
+    bool last_intact;
+} Received_t;
+
+static void onResponse(void* ctx, uint8_t request, const uint8_t* data, uint16_t len) {
+    Received_t* received = (Received_t*)ctx;
+    received->responses[request]++;
+    received->last_len = len;
+    bool intact = true;
+    for (uint16_t i = 2; i < len; i++) intact = intact && data[i] == (uint8_t)(data[1] + i - 2);
+    received->last_intact = intact;
+}
+
+class SchedulerHarness {
+public:
+    SimBus bus;
+    SimulatedEcu ecu;
+    UdsScheduler scheduler;
+    Received_t received;
+    uint64_t now_us = 1000000;
+
+    SchedulerHarness() : ecu(bus) {
+        memset(&received, 0, sizeof(received));
+        scheduler.begin(&bus, onResponse, &received);
+        scheduler.addEcu("LBC", TESTER_ID, ECU_ID);
+        const uint8_t cells[2] = {0x21, 0x41};
+        const uint8_t temps[2] = {0x21, 0x04};
+        scheduler.addRequest(0, cells, sizeof(cells), 10000);
+        scheduler.addRequest(0, temps, sizeof(temps), 30000);
+    }
+
+    // Runs the scheduler in 10 ms steps
+    void run(uint32_t duration_ms) {
+        SchedulerTester route = {scheduler};
+        for (uint32_t t = 0; t < duration_ms; t += 10) {
+            scheduler.loop(now_us);
+            deliver(bus, ecu, route, (uint32_t)now_us);
+            ecu.poll((uint32_t)now_us);
+            deliver(bus, ecu, route, (uint32_t)now_us);
+            now_us += 10000;
+        }
+    }
+};
+
+static void testSchedule() {
+    SchedulerHarness h;
+    h.run(100);
+
+    // Both due at start, one at a time on the same ECU
+    CHECK(h.received.responses[0] == 1 && h.received.responses[1] == 1);
+    CHECK(h.received.last_intact);
+    CHECK(h.scheduler.getRequest(0).responses == 1);
+    CHECK(h.scheduler.getRequest(0).failures == 0);
+
+    // Intervals: 10 s and 30 s
+    h.run(31000);
+    CHECK(h.received.responses[0] == 4);
+    CHECK(h.received.responses[1] == 2);
+    CHECK(h.ecu.requests == 6);
+}
+
+static void testResponsePending() {
+    SchedulerHarness h;
+    h.ecu.mode = SimulatedEcu::PENDING;
+    h.run(1000);
+    CHECK(h.received.responses[0] == 0);      // Past P2, still waiting
+    CHECK(h.scheduler.getRequest(0).failures == 0);
+    h.run(1500);
+    CHECK(h.received.responses[0] == 1);
+    CHECK(h.scheduler.getRequest(0).failures == 0);
+}
+
+static void testRefusedAndAsleep() {
+    SchedulerHarness h;
+    h.ecu.mode = SimulatedEcu::REFUSE;
+    h.run(100);
+    CHECK(h.scheduler.getRequest(0).failures == 1);
+    CHECK(h.scheduler.getEcu(0).consecutive_failures == 0);
+    CHECK(h.received.responses[0] == 0);
+
+    // A sleeping ECU is retried with doubling backoff: P2 plus 1, 2, 4, 8 s
+    uint64_t sent_at[5];
+    size_t attempts = 0;
+    SchedulerHarness timing;
+    timing.ecu.mode = SimulatedEcu::ASLEEP;
+    for (uint32_t t = 0; t < 20000 && attempts < 5; t += 10) {
+        size_t before = timing.bus.sentBy(TESTER_ID);
+        timing.run(10);
+        if (timing.bus.sentBy(TESTER_ID) > before) sent_at[attempts++] = timing.now_us;
+    }
+    CHECK(attempts == 5);
+    for (size_t i = 1; i < attempts; i++) {
+        uint64_t expected = UDS_P2_TIMEOUT_US + (UDS_BACKOFF_BASE_MS << (i - 1)) * 1000ULL;
+        uint64_t gap = sent_at[i] - sent_at[i - 1];
+        CHECK(gap >= expected && gap <= expected + 20000);
+    }
+    CHECK(timing.scheduler.getEcu(0).consecutive_failures == 4);
+
+    // Waking up resets the backoff
+    timing.ecu.mode = SimulatedEcu::ANSWER;
+    timing.run(20000);
+    CHECK(timing.scheduler.getEcu(0).consecutive_failures == 0);
+    CHECK(timing.received.responses[0] > 0);
+}
+
+static void testBusLoadGate() {
+    SchedulerHarness h;
+    h.scheduler.setBusLoad(UDS_BUSY_LOAD_PCT + 10.0f);
+    h.run(1000);
+    CHECK(h.bus.log.empty());
+    CHECK(h.scheduler.getBusySkips() == 100);
+
+    // A full TX queue is treated like a busy bus
+    h.scheduler.setBusLoad(10.0f);
+    h.bus.full = true;
+    h.run(10);
+    CHECK(h.scheduler.getBusySkips() == 101);
+    CHECK(h.scheduler.getEcu(0).active_request < 0);
+
+    h.bus.full = false;
+    h.run(100);
+    CHECK(h.received.responses[0] == 1 && h.received.responses[1] == 1);
+}
+
+int main() {
+    testSingleFrame();
+    testMultiFrameResponse();
+    testFlowControlPacing();
+    testReceiveErrors();
+    testSchedule();
+    testResponsePending();
+    testRefusedAndAsleep();
+    testBusLoadGate();
+    return TEST_RESULT();
+}
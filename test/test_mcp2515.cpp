@@ -0,0 +1,171 @@
+// MCP2515 driver against the register-level model: bring-up, burst reads,
+// hardware filters, transmit and overflow.
+
+#include "host_test.h"
+#include "mcp2515_model.h"
+#include "can_filter.h"
+
+static CANMessage_t frame(uint32_t id, uint8_t dlc, uint8_t seed) {
+    CANMessage_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.id = id;
+    msg.dlc = dlc;
+    for (uint8_t i = 0; i < dlc; i++) msg.data[i] = (uint8_t)(seed + i);
+    return msg;
+}
+
+static bool sameFrame(const CANMessage_t& a, const CANMessage_t& b) {
+    return a.id == b.id && a.dlc == b.dlc && memcmp(a.data, b.data, a.dlc) == 0;
+}
+
+static void testBegin() {
+    MCP2515Model model;
+    MCP2515 chip(&model);
+    CHECK(chip.begin(125000, 8));
+    CHECK(model.regs[MCP_REG_CNF1] == 0x01);
+    CHECK(model.regs[MCP_REG_CNF2] == 0xB1);
+    CHECK(model.regs[MCP_REG_CNF3] == 0x85);
+    CHECK((model.regs[MCP_REG_CANSTAT] & MCP_MODE_MASK) == MCP_MODE_NORMAL);
+    CHECK(model.regs[MCP_REG_CANINTE] == (MCP_RX0IF | MCP_RX1IF));
+
+    // Unsupported timing and a missing chip both fail
+    MCP2515Model other;
+    MCP2515 chip2(&other);
+    CHECK(!chip2.begin(100000, 8));
+    other.present = false;
+    CHECK(!chip2.begin(125000, 8));
+}
+
+static void testReadFrames() {
+    MCP2515Model model;
+    MCP2515 chip(&model);
+    CHECK(chip.begin(125000, 8));
+    CANMessage_t out[2];
+
+    CHECK(chip.readFrames(out, 0) == 0);
+
+    // One buffer: READ STATUS + READ RX BUFFER, which clears the flag
+    CANMessage_t a = frame(0x5DE, 8, 1);
+    CHECK(model.receive(a));
+    CHECK(model.interruptPending());
+    uint32_t before = model.transactions;
+    CHECK(chip.readFrames(out, 1234) == 1);
+    CHECK(model.transactions - before == 2);
+    CHECK(sameFrame(out[0], a));
+    CHECK(out[0].timestamp_us == 1234);
+    CHECK(!model.interruptPending());
+
+    // Both buffers (rollover): one burst over RXB0 and RXB1 plus the flag clear
+    CANMessage_t b = frame(0x18DAF1DB, 5, 20);
+    CANMessage_t c = frame(0x0C1, 3, 40);
+    CHECK(model.receive(b));
+    CHECK(model.receive(c));
+    before = model.transactions;
+    CHECK(chip.readFrames(out, 0) == 2);
+    CHECK(model.transactions - before == 3);
+    CHECK(sameFrame(out[0], b));
+    CHECK(sameFrame(out[1], c));
+    CHECK(!model.interruptPending());
+    CHECK(chip.getFramesRead() == 3);
+}
+
+static void testFilters() {
+    // Up to six IDs are matched exactly
+    MCP2515Model model;
+    MCP2515 chip(&model);
+    CHECK(chip.begin(125000, 8));
+    const uint32_t few[] = {0x5DE, 0x60D, 0x0C1};
+    CHECK(chip.setFilters(few, 3));
+    CHECK((model.regs[MCP_REG_CANSTAT] & MCP_MODE_MASK) == MCP_MODE_NORMAL);
+    CANMessage_t out[2];
+    uint32_t stored = 0;
+    for (uint32_t id = 0; id <= CAN_STD_ID_MAX; id++) {
+        if (model.receive(frame(id, 1, 0))) {
+            stored++;
+            chip.readFrames(out, 0);
+        }
+    }
+    CHECK(stored == 3);
+
+    // More IDs: one calculated code/mask per RX buffer, every wanted ID passes
+    const uint32_t many[] = {0x5DE, 0x60D, 0x0C1, 0x350, 0x35D, 0x418, 0x4F8, 0x62C};
+    const size_t many_count = sizeof(many) / sizeof(many[0]);
+    CHECK(chip.setFilters(many, many_count));
+    for (size_t i = 0; i < many_count; i++) {
+        CHECK(model.receive(frame(many[i], 2, (uint8_t)i)));
+        CHECK(chip.readFrames(out, 0) == 1);
+        CHECK(out[0].id == many[i]);
+    }
+    stored = 0;
+    for (uint32_t id = 0; id <= CAN_STD_ID_MAX; id++) {
+        if (model.receive(frame(id, 1, 0))) {
+            stored++;
+            chip.readFrames(out, 0);
+        }
+    }
+    CANFilterConfig_t config = CANFilter::compute(many, many_count);
+    CHECK(stored >= many_count);
+    CHECK(stored <= config.admitted_total);
+    printf("MCP2515 filters: %u wanted, %u of 2048 IDs stored\n",
+           (unsigned)many_count, (unsigned)stored);
+
+    // Extended IDs, and standard frames no longer match
+    const uint32_t ext[] = {0x18DAF1DB, 0x18DAF1DE};
+    CHECK(chip.setFilters(ext, 2));
+    CHECK(model.receive(frame(0x18DAF1DB, 8, 0)));
+    CHECK(chip.readFrames(out, 0) == 1);
+    CHECK(!model.receive(frame(0x18DAF1DC, 8, 0)));
+    CHECK(!model.receive(frame(0x5DE, 8, 0)));
+
+    // No IDs: accept everything again
+    CHECK(chip.setFilters(nullptr, 0));
+    CHECK(model.receive(frame(0x123, 1, 0)));
+}
+
+static void testSend() {
+    MCP2515Model model;
+    MCP2515 chip(&model);
+    CHECK(chip.begin(125000, 8));
+
+    CANMessage_t a = frame(0x7E4, 8, 7);
+    CHECK(chip.sendFrame(a));
+    CHECK(model.sent.size() == 1);
+    CHECK(sameFrame(model.sent[0], a));
+
+    CANMessage_t b = frame(0x18DADBF1, 3, 9);
+    CHECK(chip.sendFrame(b));
+    CHECK(model.sent.size() == 2);
+    CHECK(sameFrame(model.sent[1], b));
+
+    // TXB0 busy
+    model.hold_tx = true;
+    CHECK(chip.sendFrame(a));
+    CHECK(!chip.sendFrame(a));
+    model.completeTransmit();
+    CHECK(chip.sendFrame(a));
+    CHECK(model.sent.size() == 3);
+}
+
+static void testOverflow() {
+    MCP2515Model model;
+    MCP2515 chip(&model);
+    CHECK(chip.begin(125000, 8));
+    CHECK(model.receive(frame(0x100, 1, 0)));
+    CHECK(model.receive(frame(0x101, 1, 0)));
+    CHECK(!model.receive(frame(0x102, 1, 0)));
+    CHECK(chip.readAndClearOverflow() == MCP_EFLG_RX1OVR);
+    CHECK(chip.readAndClearOverflow() == 0);
+
+    CANMessage_t out[2];
+    CHECK(chip.readFrames(out, 0) == 2);
+    CHECK(out[0].id == 0x100 && out[1].id == 0x101);
+}
+
+int main() {
+    testBegin();
+    testReadFrames();
+    testFilters();
+    testSend();
+    testOverflow();
+    return TEST_RESULT();
+}
@@ -0,0 +1,302 @@
+// MqttRing through simulated broker outages. The gateway below applies
+// MQTTHandler's queueing and replay policy around the ring; the broker stub
+// checks per-topic order and the flash stub stands in for the outbox as the
+// spill sink. Short outages must stay in RAM, alarms must leave first after
+// a reconnect, and no alarm or bulk message may be lost, reordered or
+// received twice.
+
+#include <deque>
+#include <map>
+#include <string>
+#include "host_test.h"
+#include "mqtt_ring.h"
+
+#define STEP_MS 10
+#define REPLAY_RATE 20             // Messages per second, as in settings.h
+
+typedef struct {
+    std::string topic;
+    std::string payload;
+    bool retain;
+} Message_t;
+
+// The flash outbox as a FIFO; counts the pages it would write
+class FlashStub {
+public:
+    std::deque<Message_t> queue;
+    uint32_t stored = 0;
+    uint32_t pages = 0;
+
+    static bool push(void* ctx, const char* topic, const uint8_t* payload, size_t length,
+                     bool retain) {
+        FlashStub* flash = static_cast<FlashStub*>(ctx);
+        size_t record = OUTBOX_RECORD_HEADER + strlen(topic) + length;
+        if (flash->page_used + record > OUTBOX_MAX_RECORD) {
+            flash->pages++;
+            flash->page_used = 0;
+        }
+        flash->page_used += record;
+        Message_t message = {topic, std::string((const char*)payload, length), retain};
+        flash->queue.push_back(message);
+        flash->stored++;
+        return true;
+    }
+
+    bool isEmpty() const { return queue.empty(); }
+
+    uint16_t replay(uint16_t max_messages, OutboxSender send, void* ctx) {
+        if (page_used > 0) {
+            pages++;                   // The partial front page is written first
+            page_used = 0;
+        }
+        uint16_t sent = 0;
+        while (sent < max_messages && !queue.empty()) {
+            const Message_t& message = queue.front();
+            if (!send(ctx, message.topic.c_str(), (const uint8_t*)message.payload.data(),
+                      message.payload.size(), message.retain)) {
+                break;
+            }
+            queue.pop_front();
+            sent++;
+        }
+        return sent;
+    }
+
+private:
+    size_t page_used = 0;
+};
+
+// Payloads are "<class> <sequence> <publish ms>" padded to the message size
+class BrokerStub {
+public:
+    bool connected = true;
+    uint32_t now_ms = 0;
+    uint32_t reconnect_ms = 0;
+    uint32_t received[MQTT_CLASS_COUNT] = {};
+    uint32_t out_of_order = 0;         // Older or repeated sequence on a topic
+    uint32_t alarms_queued = 0;        // Alarms from the outage not yet received
+    uint32_t overtaken = 0;            // Other messages received before them
+    uint32_t alarm_latency_ms = 0;     // Last alarm from the outage after reconnect
+
+    static bool send(void* ctx, const char* topic, const uint8_t* payload, size_t length,
+                     bool) {
+        BrokerStub* broker = static_cast<BrokerStub*>(ctx);
+        if (!broker->connected) return false;
+
+        std::string text((const char*)payload, length);
+        unsigned cls, sequence, published_ms;
+        if (sscanf(text.c_str(), "%u %u %u", &cls, &sequence, &published_ms) != 3) return false;
+        std::map<std::string, uint32_t>::iterator last = broker->last_sequence.find(topic);
+        if (last != broker->last_sequence.end() && sequence <= last->second) {
+            broker->out_of_order++;
+        }
+        broker->last_sequence[topic] = sequence;
+        broker->received[cls]++;
+        if (cls == MQTT_CLASS_ALARM && published_ms < broker->reconnect_ms &&
+            broker->alarms_queued > 0) {
+            broker->alarms_queued--;
+            broker->alarm_latency_ms = broker->now_ms - broker->reconnect_ms;
+        } else if (broker->alarms_queued > 0) {
+            broker->overtaken++;
+        }
+        return true;
+    }
+
+private:
+    std::map<std::string, uint32_t> last_sequence;
+};
+
+// MQTTHandler::publish(), loop() and replayOutbox() around the ring
+class Gateway {
+public:
+    MqttRing ring;
+    FlashStub flash;
+    BrokerStub broker;
+
+    Gateway() {
+        ring.setSpill(FlashStub::push, &flash);
+        ring.begin();
+    }
+
+    bool hasBacklog() const { return !ring.isEmpty() || !flash.isEmpty(); }
+
+    void publish(const char* topic, const std::string& payload, bool retain, MqttClass_t cls) {
+        const uint8_t* data = (const uint8_t*)payload.data();
+        if (!broker.connected || hasBacklog() ||
+            !BrokerStub::send(&broker, topic, data, payload.size(), retain)) {
+            ring.push(topic, data, payload.size(), retain, cls);
+        }
+    }
+
+    void loop(uint32_t now_ms) {
+        broker.now_ms = now_ms;
+        if (hasBacklog() && broker.connected && now_ms - last_replay >= OUTBOX_REPLAY_INTERVAL_MS) {
+            replay();
+            last_replay = now_ms;
+        }
+        if (!broker.connected && ring.getCount(MQTT_CLASS_ALARM) < ring.getCount() &&
+            now_ms - ring.getOldestMs() >= MQTT_RING_MAX_AGE_MS) {
+            ring.spillAll(MQTT_CLASS_STATE);
+        }
+    }
+
+private:
+    uint32_t last_replay = 0;
+
+    void replay() {
+        uint16_t burst = REPLAY_RATE * OUTBOX_REPLAY_INTERVAL_MS / 1000;
+        uint16_t sent = 0;
+        bool had_backlog = !flash.isEmpty();
+        if (!had_backlog) ring.clearSpilled();
+        for (int k = MQTT_CLASS_ALARM; k < MQTT_CLASS_COUNT && sent < burst; k++) {
+            MqttClass_t cls = (MqttClass_t)k;
+            if (ring.getCount(cls) == 0) continue;
+            if (ring.isSpilled(cls) && !flash.isEmpty()) {
+                sent += flash.replay(burst - sent, BrokerStub::send, &broker);
+                if (!flash.isEmpty()) break;
+                ring.clearSpilled();
+            }
+            sent += ring.drain(burst - sent, cls, BrokerStub::send, &broker);
+            if (ring.getCount(cls) > 0) break;
+        }
+        if (sent < burst && ring.isEmpty() && !flash.isEmpty()) {
+            flash.replay(burst - sent, BrokerStub::send, &broker);
+        }
+    }
+};
+
+// Roughly DataManager's publishes with report by exception on a drive
+typedef struct {
+    const char* topic;
+    MqttClass_t cls;
+    uint32_t period_ms;
+    uint16_t size;
+    bool retain;
+} Source_t;
+
+static const Source_t SOURCES[] = {
+    {"vehicle/zoe/charging/plug_connected", MQTT_CLASS_ALARM, 45000, 1, true},
+    {"vehicle/zoe/trip/active", MQTT_CLASS_ALARM, 120000, 1, true},
+    {"vehicle/zoe/batch/dict", MQTT_CLASS_STATE, 600000, 700, true},
+    {"vehicle/zoe/battery/cells", MQTT_CLASS_STATE, 60000, 600, true},
+    {"vehicle/zoe/charge/live", MQTT_CLASS_STATE, 300000, 200, true},
+    {"vehicle/zoe/battery/soc", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/battery/voltage", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/battery/current", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/battery/power", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/battery/temp_max", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/motion/speed", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/motion/available_range", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/motion/consumption_kwh_100km", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/climate/interior_temp", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/power/voltage_12v", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/energy/out", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/energy/in", MQTT_CLASS_TELEMETRY, 5000, 6, true},
+    {"vehicle/zoe/batch/fast", MQTT_CLASS_BULK, 10000, 350, false},
+    {"vehicle/zoe/history", MQTT_CLASS_BULK, 30000, 148, false},
+    {"vehicle/zoe/diagnostics/can", MQTT_CLASS_BULK, 60000, 900, false},
+    {"vehicle/zoe/trip/summary", MQTT_CLASS_BULK, 900000, 300, false},
+};
+static const size_t SOURCE_COUNT = sizeof(SOURCES) / sizeof(SOURCES[0]);
+
+class Simulation {
+public:
+    Gateway gateway;
+    uint32_t now_ms = 0;
+    uint32_t published[MQTT_CLASS_COUNT] = {};
+
+    // Runs for duration_ms; returns how long the backlog took to drain
+    // (0 if there was none)
+    uint32_t run(uint32_t duration_ms) {
+        uint32_t drained_after = 0;
+        uint32_t start_ms = now_ms;
+        bool had_backlog = gateway.hasBacklog();
+        for (uint32_t end = now_ms + duration_ms; now_ms < end; now_ms += STEP_MS) {
+            hostSetMicros((uint64_t)now_ms * 1000);
+            gateway.broker.now_ms = now_ms;
+            for (size_t s = 0; s < SOURCE_COUNT; s++) {
+                // Stagger the sources so they do not all fire together
+                if ((now_ms + s * 370) % SOURCES[s].period_ms == 0) emit(s);
+            }
+            gateway.loop(now_ms);
+            if (had_backlog && drained_after == 0 && !gateway.hasBacklog()) {
+                drained_after = now_ms - start_ms;
+            }
+        }
+        return drained_after;
+    }
+
+    void setConnected(bool connected) {
+        gateway.broker.connected = connected;
+        if (connected) {
+            gateway.broker.reconnect_ms = now_ms;
+            gateway.broker.alarms_queued = gateway.ring.getCount(MQTT_CLASS_ALARM);
+        }
+    }
+
+private:
+    uint32_t sequence[SOURCE_COUNT] = {};
+
+    void emit(size_t s) {
+        const Source_t& source = SOURCES[s];
+        char head[48];
+        snprintf(head, sizeof(head), "%u %u %u ", (unsigned)source.cls,
+                 (unsigned)++sequence[s], (unsigned)now_ms);
+        std::string payload = head;
+        if (payload.size() < source.size) payload.resize(source.size, 'x');
+        gateway.publish(source.topic, payload, source.retain, source.cls);
+        published[source.cls]++;
+    }
+};
+
+int main() {
+    static const uint32_t OUTAGES_MS[] = {20000, 90000, 600000, 1800000};
+    Simulation sim;
+    sim.run(60000);
+
+    printf("%8s %8s %8s %8s %8s %10s %10s\n", "outage", "spilled", "pages", "coalesce",
+           "alarms", "alarm ms", "drained s");
+    for (size_t i = 0; i < sizeof(OUTAGES_MS) / sizeof(OUTAGES_MS[0]); i++) {
+        MqttRing& ring = sim.gateway.ring;
+        uint32_t spilled = ring.getSpilled();
+        uint32_t pages = sim.gateway.flash.pages;
+        uint32_t coalesced = ring.getCoalesced();
+        sim.gateway.broker.alarm_latency_ms = 0;
+
+        sim.setConnected(false);
+        sim.run(OUTAGES_MS[i]);
+        sim.setConnected(true);
+        uint32_t alarms = ring.getCount(MQTT_CLASS_ALARM);
+        uint32_t drained_ms = sim.run(900000);
+
+        spilled = ring.getSpilled() - spilled;
+        pages = sim.gateway.flash.pages - pages;
+        printf("%7lus %8lu %8lu %8lu %8lu %10lu %10.1f\n", (unsigned long)OUTAGES_MS[i] / 1000,
+               (unsigned long)spilled, (unsigned long)pages,
+               (unsigned long)(ring.getCoalesced() - coalesced), (unsigned long)alarms,
+               (unsigned long)sim.gateway.broker.alarm_latency_ms, drained_ms / 1000.0);
+
+        // Short outages cost no flash writes
+        if (OUTAGES_MS[i] < MQTT_RING_MAX_AGE_MS) CHECK(spilled == 0 && pages == 0);
+        // Queued alarms leave first, in the first replay steps
+        uint32_t burst = REPLAY_RATE * OUTBOX_REPLAY_INTERVAL_MS / 1000;
+        CHECK(sim.gateway.broker.alarms_queued == 0);
+        CHECK(sim.gateway.broker.alarm_latency_ms <=
+              ((alarms + burst - 1) / burst) * OUTBOX_REPLAY_INTERVAL_MS);
+        CHECK(drained_ms > 0);
+    }
+
+    const BrokerStub& broker = sim.gateway.broker;
+    CHECK(!sim.gateway.hasBacklog());
+    CHECK(sim.gateway.ring.getDropped() == 0);
+    CHECK(broker.out_of_order == 0);
+    CHECK(broker.overtaken == 0);
+    CHECK(broker.received[MQTT_CLASS_ALARM] == sim.published[MQTT_CLASS_ALARM]);
+    CHECK(broker.received[MQTT_CLASS_BULK] == sim.published[MQTT_CLASS_BULK]);
+    // STATE and TELEMETRY may lose superseded values, nothing else
+    uint32_t latest_only = sim.published[MQTT_CLASS_STATE] + sim.published[MQTT_CLASS_TELEMETRY];
+    CHECK(broker.received[MQTT_CLASS_STATE] + broker.received[MQTT_CLASS_TELEMETRY] +
+          sim.gateway.ring.getCoalesced() == latest_only);
+    CHECK(sim.gateway.ring.getCoalesced() > 0);
+    return TEST_RESULT();
+}
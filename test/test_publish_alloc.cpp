@@ -0,0 +1,189 @@
+// The per-value publish path does not touch the heap: the same steps as
+// DataManager (window, report policy, timer wheel, topic arena, number
+// formatting) run for simulated hours with operator new counted. Setup may
+// allocate; steady state must not.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "host_test.h"
+#include "topic_arena.h"
+#include "number_format.h"
+#include "report_policy.h"
+#include "signal_window.h"
+#include "timer_wheel.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+#define SIGNALS 48
+#define FRAME_MS 20
+
+static const char* const SUFFIXES[8] = {
+    "battery/soc", "battery/voltage", "battery/current", "battery/power",
+    "motion/speed", "climate/interior_temp", "power/voltage_12v", "charging/plug_connected"};
+
+typedef struct {
+    Topic_t topic;
+    ReportPolicy_t policy;
+    ReportState_t report;
+    SignalWindow_t window;
+    TimerNode_t timer;
+    double latest;
+    bool change_armed;
+} Signal_t;
+
+// Stand-in for MQTTHandler::publish: copies like the ring would
+typedef struct {
+    char last[256];
+    uint32_t messages;
+    uint64_t bytes;
+} Sink_t;
+
+static Signal_t signals[SIGNALS];
+static Sink_t sink;
+static TopicArena topics;
+static TimerWheel wheel;
+
+static void publish(Signal_t& signal) {
+    char payload[48 + 5 * NUMBER_FORMAT_MAX];
+    size_t len;
+    if (signal.window.count > 1) {
+        len = 0;
+        memcpy(payload, "{\"last\":", 8);
+        len = 8 + formatDecimal(payload + 8, signal.window.last, 2);
+        memcpy(payload + len, ",\"mean\":", 8);
+        len += 8;
+        len += formatDecimal(payload + len, windowMean(signal.window), 2);
+        memcpy(payload + len, ",\"n\":", 5);
+        len += 5;
+        len += formatUnsigned(payload + len, signal.window.count);
+        payload[len++] = '}';
+        payload[len] = '\0';
+    } else {
+        len = formatDecimal(payload, signal.latest, 2);
+    }
+    memcpy(sink.last, signal.topic.str, signal.topic.len);
+    memcpy(sink.last + signal.topic.len, payload, len + 1);
+    sink.messages++;
+    sink.bytes += signal.topic.len + len;
+    windowReset(signal.window);
+}
+
+static void emit(Signal_t& signal, uint32_t now) {
+    if (reportEvaluate(signal.policy, signal.report, signal.latest, now) != REPORT_SUPPRESS) {
+        publish(signal);
+    }
+}
+
+static void armHeartbeat(Signal_t& signal) {
+    if (signal.policy.max_silence_ms == 0 || !signal.report.has_published) return;
+    wheel.schedule(signal.timer, signal.report.last_published_ms + signal.policy.max_silence_ms);
+}
+
+static void onTimer(void*, TimerNode_t* node, uint32_t now) {
+    Signal_t& signal = signals[node->id];
+    signal.change_armed = false;
+    emit(signal, now);
+    armHeartbeat(signal);
+}
+
+static void update(Signal_t& signal, double value, uint32_t now) {
+    windowAdd(signal.window, value);
+    signal.latest = value;
+    if (reportIsUrgent(signal.policy, signal.report, value)) {
+        emit(signal, now);
+        signal.change_armed = false;
+        armHeartbeat(signal);
+        return;
+    }
+    if (!signal.change_armed && reportIsChange(signal.policy, signal.report, value)) {
+        uint32_t due = now;
+        if (signal.report.has_published) {
+            uint32_t allowed = signal.report.last_published_ms + signal.policy.min_spacing_ms;
+            if ((int32_t)(allowed - now) > 0) due = allowed;
+        }
+        wheel.schedule(signal.timer, due);
+        signal.change_armed = true;
+    }
+}
+
+static void setup() {
+    topics.setBase("vehicle/zoe");
+    wheel.reset(0);
+    char suffix[64];
+    for (uint16_t i = 0; i < SIGNALS; i++) {
+        Signal_t& signal = signals[i];
+        memset(&signal, 0, sizeof(signal));
+        snprintf(suffix, sizeof(suffix), "%s/%u", SUFFIXES[i % 8], (unsigned)i);
+        signal.topic = topics.intern(suffix);
+        signal.policy.abs_deadband = 0.1;
+        signal.policy.rel_deadband = 0.01f;
+        signal.policy.min_spacing_ms = 1000 * (1 + i % 5);
+        signal.policy.max_silence_ms = 60000;
+        signal.policy.priority = (i % 8 == 7) ? REPORT_PRIORITY_CRITICAL : REPORT_PRIORITY_NORMAL;
+        reportReset(signal.report);
+        windowReset(signal.window);
+        timerNodeInit(signal.timer, i);
+    }
+}
+
+// Drives every signal for duration_ms of frame time from start_ms
+static void run(uint32_t start_ms, uint32_t duration_ms) {
+    for (uint32_t now = start_ms; now < start_ms + duration_ms; now += FRAME_MS) {
+        for (uint16_t i = 0; i < SIGNALS; i++) {
+            double value;
+            if (i % 8 == 7) {
+                value = ((now / 600000) % 2) ? 1.0 : 0.0;                   // Plug
+            } else if (i % 3 == 0) {
+                value = 50.0;                                               // Constant
+            } else {
+                value = 100.0 * sin((now / 1000.0 + i) / (10.0 + i));     // Drifting
+            }
+            update(signals[i], value, now);
+        }
+        wheel.advance(now, onTimer, nullptr);
+    }
+}
+
+int main() {
+    // The counter must see allocations, or a zero below proves nothing
+    size_t before = allocations;
+    int* probe = new int(1);
+    keep(probe);
+    delete probe;
+    CHECK(allocations == before + 1);
+
+    setup();
+    run(0, 60000);                       // Warm-up: first values, heartbeats armed
+
+    before = allocations;
+    uint32_t messages = sink.messages;
+    run(60000, 4 * 3600000UL);           // Four hours of frames
+    size_t steady = allocations - before;
+
+    CHECK(sink.messages > messages);
+    CHECK(steady == 0);
+    printf("%u values published, %lu bytes, %u heap allocations in steady state\n",
+           (unsigned)(sink.messages - messages), (unsigned long)sink.bytes, (unsigned)steady);
+    return TEST_RESULT();
+}
@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+"""Expand binary (MessagePack) telemetry batches back into per-topic values.
+
+With mqtt.binary_batches enabled the gateway publishes each batch on
+<base>/batch/<class>/mp as
+
+    [version, epoch, ts_ms, {index: raw | [last, min, max, mean, n]}]
+
+where raw is the fixed-point CAN value and index points into the retained
+signal dictionary on <base>/batch/dict (see docs/MQTT_TOPICS.md):
+
+    {"epoch": E, "base": "...", "signals": [[suffix, factor, offset, unit], ...]}
+
+Commands:
+
+    tools/batch_decode.py decode --dict dict.json batch.bin
+    tools/batch_decode.py log replay_publish.log
+    tools/batch_decode.py size replay_publish.log
+    tools/batch_decode.py bridge --host broker.local --base vehicle/zoe
+
+"log" and "size" read a publish stream recorded by the trace replayer
+(REPLAY_OUTPUT_FILE); binary payloads appear there as "hex:<bytes>".
+"size" compares the MQTT bytes actually sent with what the same values
+cost as one text publish per topic. "bridge" republishes the values
+retained on <base>/<suffix> for Home Assistant (needs paho-mqtt).
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+BATCH_VERSION = 1
+
+
+class MsgPackError(ValueError):
+    pass
+
+
+def unpack(buf, pos=0):
+    """Decode one MessagePack object; returns (value, next position)."""
+    if pos >= len(buf):
+        raise MsgPackError("truncated payload")
+    b = buf[pos]
+    pos += 1
+    if b <= 0x7F:
+        return b, pos
+    if b >= 0xE0:
+        return b - 0x100, pos
+    if 0x80 <= b <= 0x8F:
+        return unpack_map(buf, pos, b & 0x0F)
+    if 0x90 <= b <= 0x9F:
+        return unpack_array(buf, pos, b & 0x0F)
+    if 0xA0 <= b <= 0xBF:
+        return unpack_str(buf, pos, b & 0x1F)
+    if b == 0xC0:
+        return None, pos
+    if b in (0xC2, 0xC3):
+        return b == 0xC3, pos
+    fixed = {
+        0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q",
+        0xD0: ">b", 0xD1: ">h", 0xD2: ">i", 0xD3: ">q",
+        0xCA: ">f", 0xCB: ">d",
+    }
+    if b in fixed:
+        fmt = fixed[b]
+        size = struct.calcsize(fmt)
+        if pos + size > len(buf):
+            raise MsgPackError("truncated payload")
+        return struct.unpack_from(fmt, buf, pos)[0], pos + size
+    lengths = {0xD9: ">B", 0xDA: ">H", 0xDB: ">I",
+               0xDC: ">H", 0xDD: ">I", 0xDE: ">H", 0xDF: ">I"}
+    if b in lengths:
+        fmt = lengths[b]
+        (count,) = struct.unpack_from(fmt, buf, pos)
+        pos += struct.calcsize(fmt)
+        if b <= 0xDB:
+            return unpack_str(buf, pos, count)
+        if b <= 0xDD:
+            return unpack_array(buf, pos, count)
+        return unpack_map(buf, pos, count)
+    raise MsgPackError("unsupported type byte 0x%02X" % b)
+
+
+def unpack_array(buf, pos, count):
+    items = []
+    for _ in range(count):
+        item, pos = unpack(buf, pos)
+        items.append(item)
+    return items, pos
+
+
+def unpack_map(buf, pos, count):
+    items = {}
+    for _ in range(count):
+        key, pos = unpack(buf, pos)
+        items[key], pos = unpack(buf, pos)
+    return items, pos
+
+
+def unpack_str(buf, pos, length):
+    if pos + length > len(buf):
+        raise MsgPackError("truncated payload")
+    return buf[pos:pos + length].decode("utf-8"), pos + length
+
+
+def decimals_of(number):
+    """Decimal places needed to print multiples of a factor exactly."""
+    text = repr(float(number))
+    if "e" in text:
+        return 6
+    return len(text.split(".")[1].rstrip("0"))
+
+
+class Dictionary:
+    def __init__(self, payload):
+        data = json.loads(payload)
+        self.epoch = data["epoch"]
+        self.base = data.get("base", "")
+        self.signals = []
+        for suffix, factor, offset, unit in data["signals"]:
+            places = max(decimals_of(factor), decimals_of(offset))
+            self.signals.append((suffix, factor, offset, unit, places))
+
+    def topic(self, index):
+        suffix = self.signals[index][0]
+        return "%s/%s" % (self.base, suffix) if self.base else suffix
+
+    def value(self, index, raw):
+        _suffix, factor, offset, _unit, places = self.signals[index]
+        return round(raw * factor + offset, places)
+
+
+def decode_batch(payload, dictionary):
+    """Return (ts_ms, [(topic, value or summary dict)]) for one binary batch."""
+    batch, end = unpack(payload)
+    if end != len(payload):
+        raise MsgPackError("%d trailing bytes" % (len(payload) - end))
+    if not isinstance(batch, list) or len(batch) != 4:
+        raise MsgPackError("not a batch")
+    version, epoch, ts, values = batch
+    if version != BATCH_VERSION:
+        raise MsgPackError("unsupported batch version %d" % version)
+    if dictionary is None or epoch != dictionary.epoch:
+        raise MsgPackError("batch needs dictionary epoch %d" % epoch)
+
+    entries = []
+    for index, raw in sorted(values.items()):
+        if index >= len(dictionary.signals):
+            raise MsgPackError("signal index %d not in dictionary" % index)
+        if isinstance(raw, list):
+            last, low, high, mean, count = raw
+            value = {
+                "last": dictionary.value(index, last),
+                "min": dictionary.value(index, low),
+                "max": dictionary.value(index, high),
+                "mean": dictionary.value(index, mean),
+                "n": count,
+            }
+        else:
+            value = dictionary.value(index, raw)
+        entries.append((dictionary.topic(index), value))
+    return ts, entries
+
+
+def text_payload(value):
+    """Payload the gateway publishes for one signal on its own topic."""
+    if isinstance(value, dict):
+        return '{"last":%.2f,"min":%.2f,"max":%.2f,"mean":%.2f,"n":%d}' % (
+            value["last"], value["min"], value["max"], value["mean"], value["n"])
+    return "%.2f" % value
+
+
+def packet_size(topic, payload):
+    """MQTT 3.1.1 QoS 0 PUBLISH: fixed header, topic, payload."""
+    remaining = 2 + len(topic.encode("utf-8")) + len(payload)
+    length_bytes = 1
+    while remaining >= 128 ** length_bytes:
+        length_bytes += 1
+    return 1 + length_bytes + remaining
+
+
+def read_log(path):
+    """Yield (ts_ms, topic, payload bytes, retain) from a replay publish log."""
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            fields = line.rstrip("\n").split("\t")
+            if len(fields) != 4:
+                continue
+            ts, topic, payload, retain = fields
+            if payload.startswith("hex:"):
+                data = bytes.fromhex(payload[4:])
+            else:
+                data = payload.encode("utf-8")
+            yield int(ts), topic, data, retain == "1"
+
+
+def expand_log(path):
+    """Yield (ts_ms, topic, payload bytes, retain, expanded entries or None)."""
+    dictionary = None
+    for ts, topic, payload, retain in read_log(path):
+        if topic.endswith("/batch/dict"):
+            dictionary = Dictionary(payload)
+            yield ts, topic, payload, retain, None
+        elif topic.endswith("/mp"):
+            _batch_ts, entries = decode_batch(payload, dictionary)
+            yield ts, topic, payload, retain, entries
+        elif "/batch/" in topic:
+            # JSON batch: {"ts":..,"v":{suffix: value}}
+            base = topic[:topic.index("/batch/")]
+            values = json.loads(payload)["v"]
+            entries = [("%s/%s" % (base, suffix), value) for suffix, value in values.items()]
+            yield ts, topic, payload, retain, entries
+        else:
+            yield ts, topic, payload, retain, None
+
+
+def cmd_decode(args):
+    with open(args.dict, encoding="utf-8") as f:
+        dictionary = Dictionary(f.read())
+    with open(args.payload, "rb") as f:
+        payload = f.read()
+    if payload.startswith(b"hex:"):
+        payload = bytes.fromhex(payload[4:].decode().strip())
+    ts, entries = decode_batch(payload, dictionary)
+    for topic, value in entries:
+        print("%d\t%s\t%s" % (ts, topic, text_payload(value)))
+
+
+def cmd_log(args):
+    for ts, topic, payload, _retain, entries in expand_log(args.log):
+        if entries is None:
+            if not topic.endswith("/batch/dict"):
+                print("%d\t%s\t%s" % (ts, topic, payload.decode("utf-8", "replace")))
+            continue
+        for value_topic, value in entries:
+            print("%d\t%s\t%s" % (ts, value_topic, text_payload(value)))
+
+
+def cmd_size(args):
+    sent = {"packets": 0, "bytes": 0}
+    text = {"packets": 0, "bytes": 0}
+    batched_sent = {"packets": 0, "bytes": 0}
+    batched_text = {"packets": 0, "bytes": 0}
+    dictionary_bytes = 0
+    for _ts, topic, payload, _retain, entries in expand_log(args.log):
+        size = packet_size(topic, payload)
+        sent["packets"] += 1
+        sent["bytes"] += size
+        if entries is None:
+            if topic.endswith("/batch/dict"):
+                dictionary_bytes += size
+                continue  # Not needed without binary batches
+            text["packets"] += 1
+            text["bytes"] += size
+            continue
+        batched_sent["packets"] += 1
+        batched_sent["bytes"] += size
+        for value_topic, value in entries:
+            value_size = packet_size(value_topic, text_payload(value).encode())
+            for totals in (text, batched_text):
+                totals["packets"] += 1
+                totals["bytes"] += value_size
+
+    rows = [
+        ("as recorded", sent),
+        ("per-topic text", text),
+        ("batches as recorded", batched_sent),
+        ("batches as text", batched_text),
+    ]
+    print("%-24s %10s %12s" % ("", "packets", "MQTT bytes"))
+    for name, totals in rows:
+        print("%-24s %10d %12d" % (name, totals["packets"], totals["bytes"]))
+    if dictionary_bytes:
+        print("dictionary publishes: %d bytes (included above)" % dictionary_bytes)
+    if text["bytes"]:
+        print("recorded / text: %.1f%%" % (100.0 * sent["bytes"] / text["bytes"]))
+    if batched_text["bytes"]:
+        print("batches / text: %.1f%%" % (100.0 * batched_sent["bytes"] / batched_text["bytes"]))
+
+
+def cmd_bridge(args):
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("bridge needs paho-mqtt (pip install paho-mqtt)")
+
+    state = {"dictionary": None}
+
+    def on_connect(client, _userdata, _flags, _rc):
+        client.subscribe(args.base + "/batch/dict")
+        client.subscribe(args.base + "/batch/+/mp")
+
+    def on_message(client, _userdata, msg):
+        try:
+            if msg.topic.endswith("/batch/dict"):
+                state["dictionary"] = Dictionary(msg.payload)
+                return
+            _ts, entries = decode_batch(msg.payload, state["dictionary"])
+        except (MsgPackError, ValueError, KeyError) as err:
+            print("%s: %s" % (msg.topic, err), file=sys.stderr)
+            return
+        for topic, value in entries:
+            client.publish(topic, text_payload(value), retain=True)
+
+    client = mqtt.Client()
+    if args.username:
+        client.username_pw_set(args.username, args.password)
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.loop_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+    commands.required = True
+
+    decode = commands.add_parser("decode", help="decode one batch payload")
+    decode.add_argument("--dict", required=True, help="dictionary JSON (batch/dict payload)")
+    decode.add_argument("payload", help="raw MessagePack file, or hex:<bytes>")
+    decode.set_defaults(func=cmd_decode)
+
+    log = commands.add_parser("log", help="expand a recorded replay publish log")
+    log.add_argument("log")
+    log.set_defaults(func=cmd_log)
+
+    size = commands.add_parser("size", help="compare recorded bytes with per-topic text")
+    size.add_argument("log")
+    size.set_defaults(func=cmd_size)
+
+    bridge = commands.add_parser("bridge", help="republish batches as per-topic values")
+    bridge.add_argument("--host", default="localhost")
+    bridge.add_argument("--port", type=int, default=1883)
+    bridge.add_argument("--base", default="vehicle/zoe")
+    bridge.add_argument("--username")
+    bridge.add_argument("--password")
+    bridge.set_defaults(func=cmd_bridge)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
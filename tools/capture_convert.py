@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Convert a binary CAN capture (see src/can_capture.h) to candump or ASC.
+
+Copy the /capture directory off the gateway's LittleFS partition, then:
+
+    tools/capture_convert.py capture/ > trace.log
+    tools/capture_convert.py --format asc capture/00000003.bin > trace.asc
+
+Segment files are read in index order. Timestamps are microseconds since
+gateway boot; use --epoch to shift them to wall-clock time.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+BLOCK_SIZE = 512
+HEADER = struct.Struct("<HBBHHIQ")
+MAGIC = 0x435A
+VERSION = 1
+KEY_LITERAL = 0xFF
+ID_EXTENDED = 0x80000000
+ID_BUS2 = 0x40000000
+
+
+def read_varint(buf, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = buf[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def decode_block(block):
+    """Yield (timestamp_us, bus, can_id, extended, data) for one block."""
+    magic, version, _id_count, count, used, _seq, base_ts = HEADER.unpack_from(block)
+    if magic != MAGIC:
+        return
+    if version != VERSION:
+        raise ValueError("unsupported capture version %d" % version)
+
+    dictionary = []
+    ts = base_ts
+    pos = HEADER.size
+    for _ in range(count):
+        if pos >= used:
+            raise ValueError("record runs past used_bytes")
+        delta, pos = read_varint(block, pos)
+        ts += delta
+        key = block[pos]
+        pos += 1
+        if key == KEY_LITERAL:
+            (key_id,) = struct.unpack_from("<I", block, pos)
+            pos += 4
+            dictionary.append(key_id)
+        else:
+            key_id = dictionary[key]
+        dlc = block[pos]
+        pos += 1
+        data = bytes(block[pos:pos + dlc])
+        pos += dlc
+        bus = 2 if key_id & ID_BUS2 else 1
+        extended = bool(key_id & ID_EXTENDED)
+        yield ts, bus, key_id & 0x1FFFFFFF, extended, data
+
+
+def segment_files(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            names = [n for n in os.listdir(path) if n.endswith(".bin")]
+            names.sort(key=lambda n: int(n[:-4]))
+            files.extend(os.path.join(path, n) for n in names)
+        else:
+            files.append(path)
+    return files
+
+
+def read_frames(paths):
+    for path in segment_files(paths):
+        with open(path, "rb") as f:
+            while True:
+                block = f.read(BLOCK_SIZE)
+                if len(block) < BLOCK_SIZE:
+                    break
+                yield from decode_block(block)
+
+
+def format_candump(frame, epoch):
+    ts, bus, can_id, extended, data = frame
+    id_text = "%08X" % can_id if extended else "%03X" % can_id
+    return "(%.6f) can%d %s#%s" % (epoch + ts / 1e6, bus - 1, id_text, data.hex().upper())
+
+
+def format_asc(frame, start_us):
+    ts, bus, can_id, extended, data = frame
+    id_text = ("%Xx" % can_id) if extended else ("%X" % can_id)
+    payload = " ".join("%02X" % b for b in data)
+    return "%11.6f %d  %-15s Rx   d %d %s" % ((ts - start_us) / 1e6, bus, id_text,
+                                              len(data), payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("paths", nargs="+", help="capture directory or segment files")
+    parser.add_argument("--format", choices=("candump", "asc"), default="candump")
+    parser.add_argument("--epoch", type=float, default=0.0,
+                        help="seconds added to candump timestamps")
+    args = parser.parse_args()
+
+    out = sys.stdout
+    frames = read_frames(args.paths)
+    if args.format == "candump":
+        for frame in frames:
+            out.write(format_candump(frame, args.epoch) + "\n")
+        return
+
+    first = next(frames, None)
+    out.write("date Thu Jan 1 00:00:00.000 am 1970\n")
+    out.write("base hex  timestamps absolute\n")
+    out.write("no internal events logged\n")
+    if first is not None:
+        out.write(format_asc(first, first[0]) + "\n")
+        for frame in frames:
+            out.write(format_asc(frame, first[0]) + "\n")
+    out.write("End TriggerBlock\n")
+
+
+if __name__ == "__main__":
+    main()
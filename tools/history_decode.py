@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""Decode Gorilla-compressed signal history published on <base>/history.
+
+Each message is one block of one signal (see src/gorilla_block.h):
+
+    version (1) | signal index (1) | dictionary epoch (2) | count (2) | tick ms (2) |
+    boot id (4) | anchor ms (4) | anchor unix s (4) | bitstream
+
+Header fields are big-endian. Timestamps are in ticks of "tick ms" since the
+device booted; the anchor pairs a frame time with the unix time (0 until the
+modem has network time), so anchored points are printed as UTC dates and
+the others as milliseconds since boot. Version 1 blocks have no boot id or
+anchor. Values are raw CAN integers; the retained signal dictionary on
+<base>/batch/dict (shared with the binary batches) maps the index to its
+topic, factor and offset. Commands:
+
+    tools/history_decode.py decode --dict dict.json block.bin
+    tools/history_decode.py log replay_publish.log
+    tools/history_decode.py size replay_publish.log
+
+"log" prints every point of every block in a replay recording. "size"
+compares each signal's history bytes with the same points published as one
+text message per value.
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+from batch_decode import Dictionary, packet_size, read_log
+
+HISTORY_VERSION = 2
+HEADER_V1 = struct.Struct(">BBHHH")
+HEADER = struct.Struct(">BBHHHIII")
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def read(self, bits):
+        value = 0
+        for _ in range(bits):
+            byte = self.data[self.pos >> 3]
+            value = (value << 1) | ((byte >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return value
+
+    def read_signed(self, bits):
+        value = self.read(bits)
+        return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def to_double(bits):
+    return struct.unpack(">d", struct.pack(">Q", bits))[0]
+
+
+def decode_block(bitstream, count):
+    """Return [(ts, value)] for count points of a Gorilla bitstream."""
+    if count == 0:
+        return []
+    reader = BitReader(bitstream)
+    ts = reader.read(32)
+    bits = reader.read(64)
+    points = [(ts, to_double(bits))]
+    delta = 0
+    leading = trailing = None
+
+    for _ in range(count - 1):
+        if reader.read(1) == 0:
+            dod = 0
+        elif reader.read(1) == 0:
+            dod = reader.read_signed(7)
+        elif reader.read(1) == 0:
+            dod = reader.read_signed(12)
+        elif reader.read(1) == 0:
+            dod = reader.read_signed(20)
+        else:
+            dod = reader.read_signed(32)
+        delta += dod
+        ts = (ts + delta) & 0xFFFFFFFF
+
+        if reader.read(1) == 1:
+            if reader.read(1) == 1:
+                leading = reader.read(5)
+                length = reader.read(6) + 1
+                trailing = 64 - leading - length
+            elif leading is None:
+                raise ValueError("window reuse before any window")
+            length = 64 - leading - trailing
+            bits ^= reader.read(length) << trailing
+        points.append((ts, to_double(bits)))
+    return points
+
+
+def absolute_ms(frame_ms, anchor_ms, anchor_unix):
+    """Unix milliseconds of a frame time, or None without an anchor."""
+    if anchor_unix == 0:
+        return None
+    delta = (frame_ms - anchor_ms) & 0xFFFFFFFF
+    if delta & 0x80000000:
+        delta -= 1 << 32
+    return anchor_unix * 1000 + delta
+
+
+def format_time(ts):
+    """Text for a decoded point time: a UTC date, or frame ms since boot."""
+    frame_ms, unix_ms = ts
+    if unix_ms is None:
+        return "%d" % frame_ms
+    date = datetime.datetime.fromtimestamp(unix_ms / 1000.0, datetime.timezone.utc)
+    return date.strftime("%Y-%m-%dT%H:%M:%S.") + "%03dZ" % (unix_ms % 1000)
+
+
+def decode_message(payload, dictionary):
+    """Return (topic, boot id, [((frame_ms, unix_ms or None), value)]) for one history message."""
+    version = payload[0] if payload else 0
+    if version == 1:
+        _version, index, epoch, count, tick_ms = HEADER_V1.unpack_from(payload)
+        boot_id, anchor_ms, anchor_unix = 0, 0, 0
+        header_size = HEADER_V1.size
+    elif version == HISTORY_VERSION:
+        (_version, index, epoch, count, tick_ms,
+         boot_id, anchor_ms, anchor_unix) = HEADER.unpack_from(payload)
+        header_size = HEADER.size
+    else:
+        raise ValueError("unsupported history version %d" % version)
+    if dictionary is None or epoch != dictionary.epoch:
+        raise ValueError("block needs dictionary epoch %d" % epoch)
+    if index >= len(dictionary.signals):
+        raise ValueError("signal index %d not in dictionary" % index)
+    points = []
+    for ts, raw in decode_block(payload[header_size:], count):
+        frame_ms = (ts * tick_ms) & 0xFFFFFFFF
+        points.append(((frame_ms, absolute_ms(frame_ms, anchor_ms, anchor_unix)),
+                       dictionary.value(index, raw)))
+    return dictionary.topic(index), boot_id, points
+
+
+def history_messages(path):
+    """Yield (value topic, packet size, points) for every history block in a replay log."""
+    dictionary = None
+    for _ts, topic, payload, _retain in read_log(path):
+        if topic.endswith("/batch/dict"):
+            dictionary = Dictionary(payload)
+        elif topic.endswith("/history"):
+            value_topic, _boot_id, points = decode_message(payload, dictionary)
+            yield value_topic, packet_size(topic, payload), points
+
+
+def cmd_decode(args):
+    with open(args.dict, encoding="utf-8") as f:
+        dictionary = Dictionary(f.read())
+    with open(args.payload, "rb") as f:
+        payload = f.read()
+    topic, boot_id, points = decode_message(payload, dictionary)
+    print("boot %08x" % boot_id)
+    for ts, value in points:
+        print("%s\t%s\t%.2f" % (format_time(ts), topic, value))
+
+
+def cmd_log(args):
+    for topic, _size, points in history_messages(args.log):
+        for ts, value in points:
+            print("%s\t%s\t%.2f" % (format_time(ts), topic, value))
+
+
+def cmd_size(args):
+    totals = {}
+    for topic, size, points in history_messages(args.log):
+        entry = totals.setdefault(topic, [0, 0, 0])
+        entry[0] += len(points)
+        entry[1] += size
+        for _ts, value in points:
+            entry[2] += packet_size(topic, ("%.2f" % value).encode())
+
+    print("%-44s %7s %10s %10s %7s" % ("topic", "points", "history", "text", "ratio"))
+    all_points = all_history = all_text = 0
+    for topic in sorted(totals):
+        points, history, text = totals[topic]
+        print("%-44s %7d %10d %10d %6.1fx" % (topic, points, history, text, text / history))
+        all_points += points
+        all_history += history
+        all_text += text
+    if all_history:
+        print("%-44s %7d %10d %10d %6.1fx" % ("total", all_points, all_history, all_text,
+                                             all_text / all_history))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+    commands.required = True
+
+    decode = commands.add_parser("decode", help="decode one history message")
+    decode.add_argument("--dict", required=True, help="dictionary JSON (batch/dict payload)")
+    decode.add_argument("payload", help="raw history message file")
+    decode.set_defaults(func=cmd_decode)
+
+    log = commands.add_parser("log", help="print the history points of a replay recording")
+    log.add_argument("log")
+    log.set_defaults(func=cmd_log)
+
+    size = commands.add_parser("size", help="compare history bytes with per-value text")
+    size.add_argument("log")
+    size.set_defaults(func=cmd_size)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except ValueError as err:
+        sys.exit(str(err))
+
+
+if __name__ == "__main__":
+    main()